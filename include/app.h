@@ -10,20 +10,43 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "event_log.h" //NOLINT
+#include "event_sink.h" //NOLINT
 #include "menu.h" //NOLINT
+#include "simulation_worker.h" //NOLINT
+#include "t_s_manager.h" //NOLINT
+#include "train_time.h" //NOLINT
 
+class QueryServer;
 class Simulator;
-class TrainStationManager;
 
 /** \brief This is the user interface class.
  * It has one public funcion called Run. This is where the program starts for
  * the user. Here is the main menu presented.
  *
+ * The simulation is run by a SimulationWorker. The menus wait for each
+ * command to be done before they read the simulation, and print the log
+ * while they wait. When the input is a terminal a long run can be paused
+ * with Enter.
+ *
+ * With a serve path, a QueryServer answers queries on a Unix domain socket
+ * from Setup until the App is destroyed.
  */
 class App {
   std::shared_ptr<Simulator> simulator;
   std::shared_ptr<TrainStationManager> train_station_manager;
+  std::shared_ptr<SimulationWorker> simulation_worker_;
+  // Declared after the worker, so the server is stopped first.
+  std::shared_ptr<QueryServer> query_server_;
+  std::string serve_path_;
+  int real_time_speedup_;
+  std::vector<DepartureEdit> what_if_edits_;
+  SimTime optimize_window_s_;
+  int optimize_rounds_;
+  std::size_t optimize_jobs_;
+  unsigned optimize_seed_;
   bool simulation_done_;
 
   Menu main_menu;
@@ -53,7 +76,11 @@ class App {
   void nextInterval();
   void nextEvent();
   void finishSimulation();
+  void runInRealTime();
+  /** \brief Runs the rest of the simulation paced by the wall clock. */
+  void runPaced(int speedup);
   void changeDetailLevel();
+  void exportEvents();
   void searchTrainByTrainNumber();
   void searchTrainByVehicleId();
   void changeTrainDetailLevel();
@@ -65,15 +92,32 @@ class App {
   void showAllStatistics();
   void showVehicleDistributionStart();
   void showTotalDelay();
+  void showEnergyUse();
+  void showThroughput();
   void showTrainsStuckAtStation();
   void showDelayedTrains();
   void showTrainsInTime();
   void showTrainLifeCycle();
   void showTrainLifeCycleByVehicleId();
   void changeStatsDetailLevel();
+  void whatIf();
+  void showVehicleFlow();
+  void showDelayRootCauses();
+#ifdef TRAINS_PROFILING
+  void showProfilingStatistics();
+#endif
   void processEventsIfTime();
+  /** \brief Prints where a run stopped and disables the menu items that
+   * change the simulation when it is done. */
+  void showRunResult(const WorkerOutput &done);
+  void startQueryServer();
+  /** \brief Sends the command to the worker and prints the log until the
+   * command is done. Throws exception if the simulation failed. */
+  WorkerOutput runOnWorker(WorkerCommandType type, SimTime time,
+                           int speedup = 1);
+  static bool enterPressed();
   static std::string getStringInput(const std::string &prompt);
-  time_t inputTime();
+  SimTime inputTime();
   int inputInterval();
   static bool keyPressNotEnter();
   void setSimulationDone(bool isDone) { simulation_done_ = isDone; }
@@ -85,6 +129,36 @@ class App {
       const std::string &tm_path);
   ~App();
   void Run();
+
+  /** \brief Runs the whole simulation without any menus. Used for batch runs
+   * where the result is read from the log and the event exports. Profiling
+   * builds also write Trainsim.profile.json. */
+  void RunHeadless();
+
+  /** \brief Writes every logged event to path in the given format. */
+  void AddEventExport(ExportFormat format, const std::string &path);
+  void SetConsoleLog(bool console_log);
+  void SetEventLogRetention(RetentionPolicy policy, std::size_t capacity);
+  /** \brief Serve queries on a Unix domain socket at path. RunHeadless then
+   * keeps serving after the simulation until Enter is pressed. */
+  void SetServePath(const std::string &path);
+  /** \brief RunHeadless runs the simulation in step with the wall clock,
+   * speedup simulated seconds per second. */
+  void SetRealTime(int speedup) { real_time_speedup_ = speedup; }
+  /** \brief Reads the disruptions of the simulation from path, see
+   * TrainStationManager::LoadDisruptions. Called before Run. */
+  void LoadDisruptions(const std::string &path);
+  /** \brief RunHeadless ends with the report of TrainStationManager::WhatIf
+   * for the edits added. */
+  void AddWhatIf(const DepartureEdit &edit);
+  /** \brief The timing of the lifecycle of the trains, see
+   * SimulationParameters. Called before Run. */
+  void SetParameters(const SimulationParameters &parameters);
+  /** \brief RunHeadless ends with the report of a TimetableOptimizer that
+   * moves the trains at most window_s for rounds rounds on jobs threads.
+   * The moves it tries are drawn from seed. */
+  void SetOptimizer(SimTime window_s, int rounds, std::size_t jobs,
+                    unsigned seed);
 };
 
 #endif  // PROJECT_INCLUDE_APP_H_
@@ -0,0 +1,121 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_DATA_LOADER_H_
+#define PROJECT_INCLUDE_DATA_LOADER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "disruption_schedule.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
+class Vehicle;
+
+/** \brief One line of the stations file. Vehicles with an unknown type code
+ * are kept as id and type so the validation can report them. */
+struct StationRecord {
+  int line;
+  std::string name;
+  std::vector<std::shared_ptr<Vehicle>> vehicles;
+  std::vector<std::pair<int, int>> unknown_vehicles;
+};
+
+/** \brief One line of the trains file. The station names are turned into
+ * ids by the TrainStationManager when it builds the TrainLine. */
+struct TrainRecord {
+  int line;
+  int number;
+  std::string departure_station;
+  std::string arrival_station;
+  SimTime departure_time;
+  SimTime arrival_time;
+  int max_speed;
+  std::vector<int> vehicle_types;
+};
+
+/** \brief One line of the map file. */
+struct DistanceRecord {
+  int line;
+  std::string station_1;
+  std::string station_2;
+  int distance;
+};
+
+/** \brief One line of the disruptions file. station_2 is empty for a pool
+ * freeze and max_speed is 0 unless it is a speed restriction. The stations
+ * are checked by the TrainStationManager. */
+struct DisruptionRecord {
+  int line;
+  DisruptionType type;
+  std::string station_1;
+  std::string station_2;
+  SimTime from;
+  SimTime to;
+  int max_speed;
+};
+
+/** \brief This class reads and checks the three input files.
+ * The files are read at the same time. Each file is split into chunks on
+ * line boundaries that are parsed by a pool of threads, and the chunks are
+ * put back together in file order, so the result does not depend on the
+ * number of threads.
+ *
+ * After parsing, the files are checked against each other. Every station of
+ * a train has to exist, every line has to have a distance, station names,
+ * train numbers and vehicle ids have to be unique and type codes have to be
+ * 0-5. The checks run in parallel. After that the TrainStationManager can
+ * index everything by name, number and id without checking again.
+ *
+ * The constructor throws exception if a file can not be opened or parsed,
+ * or if a check fails. The message holds the file and line of every problem.
+ */
+class DataLoader {
+  std::string station_path_;
+  std::string trains_path_;
+  std::string map_path_;
+  std::vector<StationRecord> stations_;
+  std::vector<TrainRecord> trains_;
+  std::vector<DistanceRecord> distances_;
+
+  static std::vector<StationRecord> loadStations(const std::string &path);
+  static std::vector<TrainRecord> loadTrains(const std::string &path);
+  static std::vector<DistanceRecord> loadMap(const std::string &path);
+
+  std::vector<std::string> checkTrainStations() const;
+  std::vector<std::string> checkDistances() const;
+  std::vector<std::string> checkVehicleIds() const;
+  std::vector<std::string> checkStationNamesAndTrainNumbers() const;
+  std::vector<std::string> checkTypeCodes() const;
+  void validate() const;
+
+ public:
+  DataLoader(const std::string &station_path, const std::string &trains_path,
+             const std::string &map_path);
+  ~DataLoader() {}
+
+  const std::vector<StationRecord> &GetStations() const { return stations_; }
+  const std::vector<TrainRecord> &GetTrains() const { return trains_; }
+  const std::vector<DistanceRecord> &GetDistances() const {
+    return distances_;
+  }
+
+  /** \brief Reads a disruptions file, which is not part of the input data.
+   * Each line is one of
+   *
+   *     CLOSE station station from to
+   *     SPEED station station from to max_speed
+   *     FREEZE station from to
+   *
+   * with times as in the trains file. Empty lines and lines that start with
+   * # are skipped. Throws exception if the file can not be opened or a line
+   * can not be parsed. */
+  static std::vector<DisruptionRecord> LoadDisruptions(
+      const std::string &path);
+};
+
+#endif  // PROJECT_INCLUDE_DATA_LOADER_H_
@@ -0,0 +1,85 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_DELAY_ATTRIBUTION_H_
+#define PROJECT_INCLUDE_DELAY_ATTRIBUTION_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+enum class DelayCauseType { LATE_TRAIN, SHORTAGE, FROZEN_POOL };
+
+/** \brief Why a train could not get a vehicle. index is the index of the
+ * late train in the TrainStationManager, or the name id of the station for
+ * a shortage or a frozen pool. */
+struct DelayCause {
+  DelayCauseType type;
+  std::size_t index;
+
+  bool operator==(const DelayCause &other) const {
+    return type == other.type && index == other.index;
+  }
+};
+
+/** \brief A failed assembly of train at time, which delayed it seconds
+ * while it waited for a vehicle of vehicle_type. */
+struct WaitRecord {
+  SimTime time;
+  std::size_t train;
+  int vehicle_type;
+  SimTime seconds;
+  DelayCause cause;
+};
+
+/** \brief seconds of delay with the root cause root. trains is the number of
+ * trains the seconds are spread over, only set by GetRootTotals. */
+struct RootShare {
+  DelayCause root;
+  SimTime seconds;
+  int trains;
+};
+
+/** \brief Attributes the delay of the trains that wait for vehicles to the
+ * causes at the start of the chain.
+ *
+ * Every failed assembly is recorded with its direct cause: the late train
+ * that would have brought the missing vehicle type had it been on time, or
+ * the station if no such train exists or its pool is frozen. A late train
+ * can itself have waited for vehicles, so the wait is passed on to the
+ * root causes of that train, in proportion to how much of its lateness
+ * they explain. The rest of the lateness is its own, from a disruption, and
+ * the train is the root. The root causes of every train are kept during
+ * the run, so nothing has to be worked out from the log afterwards.
+ */
+class DelayAttribution {
+  std::vector<WaitRecord> waits_;
+  /** \brief Indexed by train. The total wait and its root causes, which
+   * add up to it. */
+  std::vector<SimTime> waited_;
+  std::vector<std::vector<RootShare>> roots_;
+
+  static void addShare(std::vector<RootShare> &shares,  // NOLINT
+                       const DelayCause &root, SimTime seconds);
+
+ public:
+  DelayAttribution() {}
+  ~DelayAttribution() {}
+
+  void Start(std::size_t number_of_trains);
+  /** \brief lateness is how late the return of the vehicles of a late train
+   * is at time, and is not used for the other causes. */
+  void AddWait(SimTime time, std::size_t train, int vehicle_type,
+               SimTime seconds, const DelayCause &cause, SimTime lateness);
+
+  const std::vector<WaitRecord> &GetWaits() const { return waits_; }
+  SimTime GetWaited(std::size_t train) const { return waited_[train]; }
+  /** \brief Every root cause with its seconds and the number of trains it
+   * delayed, the largest first. */
+  std::vector<RootShare> GetRootTotals() const;
+};
+
+#endif  // PROJECT_INCLUDE_DELAY_ATTRIBUTION_H_
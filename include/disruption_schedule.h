@@ -0,0 +1,67 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_DISRUPTION_SCHEDULE_H_
+#define PROJECT_INCLUDE_DISRUPTION_SCHEDULE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+enum class DisruptionType { CLOSURE, SPEED_RESTRICTION, POOL_FREEZE };
+
+/** \brief A disruption from the time from until the time to. The stations
+ * are name ids. A closure and a speed restriction are on the route between
+ * the two stations, in both directions. A pool freeze is at station_1 and
+ * station_2 is -1. max_speed is only used by a speed restriction. */
+struct Disruption {
+  DisruptionType type;
+  int station_1;
+  int station_2;
+  SimTime from;
+  SimTime to;
+  int max_speed;
+};
+
+/** \brief The disruptions of a simulation, indexed by route and station.
+ * Routes are given by the same key as the distances of the
+ * TrainStationManager. The lookups only read the disruptions of one route
+ * or station, so they cost nothing for the routes that are not disrupted.
+ */
+class DisruptionSchedule {
+  std::vector<Disruption> disruptions_;
+  std::unordered_map<std::uint64_t, std::vector<std::size_t>> by_route_;
+  std::unordered_map<int, std::vector<std::size_t>> by_station_;
+
+  const std::vector<std::size_t> *onRoute(std::uint64_t route) const;
+
+ public:
+  DisruptionSchedule() {}
+  ~DisruptionSchedule() {}
+
+  /** \brief route is not used for a pool freeze. */
+  void Add(const Disruption &disruption, std::uint64_t route);
+  bool Empty() const { return disruptions_.empty(); }
+  std::size_t Size() const { return disruptions_.size(); }
+  const Disruption &Get(std::size_t index) const {
+    return disruptions_[index];
+  }
+
+  /** \brief The first time at or after time the route is not closed by a
+   * closure that has started by now. A closure is not known before it
+   * starts. Closures that follow each other are passed in one call. */
+  SimTime OpenAt(std::uint64_t route, SimTime time, SimTime now) const;
+  /** \brief The lowest speed limit on the route at time, or 0 if there is
+   * none. */
+  int MaxSpeedAt(std::uint64_t route, SimTime time) const;
+  /** \brief If the vehicle pool of the station, given as name id, is frozen
+   * at time. */
+  bool IsFrozen(int station, SimTime time) const;
+};
+
+#endif  // PROJECT_INCLUDE_DISRUPTION_SCHEDULE_H_
@@ -0,0 +1,69 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_ENERGY_ACCOUNT_H_
+#define PROJECT_INCLUDE_ENERGY_ACCOUNT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+class StringTable;
+class Train;
+
+/** \brief Electricity in kWh and diesel in liters. */
+struct EnergyUse {
+  double electric_kwh;
+  double diesel_liters;
+};
+
+/** \brief This class keeps account of the energy the trains use.
+ * Each trip is added when the train arrives. The energy at the wheels is the
+ * work against the resistance at the average speed of the trip plus the
+ * kinetic energy that is lost when braking at the arrival station, see
+ * RunTimeModel. It is split over the locomotives by power. A locomotive never
+ * uses more than its max power or fuel consumption during the trip.
+ *
+ * The energy is summed per train, per departure station, per locomotive type
+ * and per hour when the trip is added, so the report does not have to go
+ * through the event log.
+ */
+class EnergyAccount {
+  EnergyUse total_;
+  std::map<int, EnergyUse> per_train_;
+  /** \brief Keyed by the name id of the departure station. */
+  std::map<int, EnergyUse> per_station_;
+  /** \brief Energy, trips and locomotive kilometers per locomotive type. */
+  double per_type_energy_[2];
+  int per_type_trips_[2];
+  double per_type_km_[2];
+  /** \brief Energy per simulated hour, trips are spread evenly over the
+   * hours they run. */
+  std::vector<EnergyUse> per_hour_;
+
+  void addToHours(SimTime departure, SimTime arrival, const EnergyUse &use);
+
+ public:
+  EnergyAccount();
+  ~EnergyAccount() {}
+
+  void AddTrip(const Train &train, int distance_m, SimTime departure,
+               SimTime arrival);
+
+  const EnergyUse &GetTotal() const { return total_; }
+  /** \brief Returns false if the train has not arrived yet. */
+  bool GetTrainEnergy(int train_number,
+                      EnergyUse &use_out) const;  // NOLINT
+
+  /** \brief The network totals, per locomotive type, per station and per
+   * hour. With high detail level also per train. The station names are
+   * looked up in station_names. */
+  std::string GetReport(const StringTable &station_names,
+                        bool high_detail_level) const;
+};
+
+#endif  // PROJECT_INCLUDE_ENERGY_ACCOUNT_H_
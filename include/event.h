@@ -6,10 +6,15 @@
 #ifndef PROJECT_INCLUDE_EVENT_H_
 #define PROJECT_INCLUDE_EVENT_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
 #include <vector>
 
+#include "event_queue.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
 class Simulator;
 class Train;
 enum class TrainStatus;
@@ -18,137 +23,194 @@ class TrainStationManager;
 /** \brief Holds the state of a event.
  * Each event that has passed is saved to a list called event log. The event
  * contains a train object pointer. This public class saves the all the states
- * that can vary between different events.
+ * that can vary between different events. It is also the record that is
+ * written by the event sinks.
  */
 class State {
  public:
+  SimTime event_time_;
+  int train_number_;
   TrainStatus train_status_;
-  time_t planed_departure_time_;
-  time_t expected_arrival_time_;
+  SimTime planed_departure_time_;
+  SimTime expected_arrival_time_;
   int average_speed_;
   std::vector<int> connected_vehicles_;
   std::vector<int> demanded_vehicles_;
 };
 
+/** \brief The kind of an event, which is the step of the TrainLifecycle it
+ * resumes at. Events with the same time are run in this order: trains that
+ * finish return their vehicles before other trains at the same time are
+ * assembled, and trains that have waited get vehicles before trains that
+ * try for the first time. A disruption that starts is run before all of
+ * them, so the trains at its start time already see it.
+ */
+enum class EventKind {
+  DISRUPTION,
+  FINISHED,
+  ARRIVED,
+  RUNNING,
+  READY,
+  INCOMPLETE,
+  NOT_ASSEMBLED
+};
+
 /** \brief This is the Event base-class.
  */
 class Event : public std::enable_shared_from_this<Event> {
  protected:
-  State state;
   std::weak_ptr<TrainStationManager> train_station_environment_;
   std::weak_ptr<Simulator> simulator_;
   std::shared_ptr<Train> train_;
-  time_t event_time_;
+  SimTime event_time_;
+  EventKind kind_;
+  std::uint64_t sequence_;
+  EventHandle handle_;
   virtual int getAverageSpeed() = 0;
 
  public:
-  explicit Event(std::shared_ptr<TrainStationManager> train_station_environment,
-                 std::shared_ptr<Simulator> simulator,
-                 std::shared_ptr<Train> train, time_t event_time)
+  Event(std::shared_ptr<TrainStationManager> train_station_environment,
+        std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
+        SimTime event_time, EventKind kind)
       : train_station_environment_(train_station_environment),
         simulator_(simulator),
         train_(train),
-        event_time_(event_time) {}
+        event_time_(event_time),
+        kind_(kind),
+        sequence_(0) {}
   virtual ~Event() {}
 
-  time_t GetEventTime() const { return event_time_; }
+  SimTime GetEventTime() const { return event_time_; }
+  /** \brief Only for the Simulator, which moves the event in the queue, see
+   * Simulator::RescheduleEvent. */
+  void SetEventTime(SimTime event_time) { event_time_ = event_time; }
+  EventKind GetKind() const { return kind_; }
+  /** \brief The order the event was added to the simulator in. It breaks
+   * ties between events with the same time and kind. */
+  std::uint64_t GetSequence() const { return sequence_; }
+  void SetSequence(std::uint64_t sequence) { sequence_ = sequence; }
+  /** \brief The handle the event got when it was last added to the
+   * simulator. */
+  EventHandle GetHandle() const { return handle_; }
+  void SetHandle(EventHandle handle) { handle_ = handle; }
   virtual void Run() = 0;
   TrainStatus GetTrainStatus();
   void Log();
   std::shared_ptr<Train> &GetTrain();
-
-  State GetState() { return state; }
 };
 
-class NotAssembled : public Event {
-  int getAverageSpeed() { return 0; }
+/** \brief The lifecycle of one train.
+ * A train goes through the steps NotAssembled, Incomplete (repeated until
+ * the train gets its vehicles), Ready, Running, Arrived and Finished. The
+ * steps are run by one object per train that works like a coroutine: the
+ * kind of the event is the step to resume at, and when a step is done the
+ * object sets the time and kind of the next step and adds itself to the
+ * event queue again. Nothing is allocated between the steps.
+ *
+ * NotAssembled tries to assemble the train 30 minutes before departure.
+ * Incomplete is used when that fails. It calculates new arrival time based
+ * on the shortest running time of the train, see RunTimeModel, and tries
+ * again every 10 minutes. If the train can not make up for the delay it
+ * arrives late.
+ *
+ * The disruptions of the TrainStationManager are checked at the same steps:
+ * a train is not assembled from a frozen pool, Ready holds the departure
+ * while the route is closed and Running uses the running time at the speed
+ * limit of the route.
+ */
+class TrainLifecycle final : public Event {
+  int getAverageSpeed() override;
+
+  /** \brief The steps. Each returns false when the lifecycle is over, or
+   * sets the kind and time of the step to resume at and returns true. */
+  bool notAssembled(EventKind &next_kind, SimTime &next_time);  // NOLINT
+  bool incomplete(EventKind &next_kind, SimTime &next_time);    // NOLINT
+  bool ready(EventKind &next_kind, SimTime &next_time);         // NOLINT
+  bool running(EventKind &next_kind, SimTime &next_time);       // NOLINT
+  bool arrived(EventKind &next_kind, SimTime &next_time);       // NOLINT
+  bool finished(EventKind &next_kind, SimTime &next_time);      // NOLINT
 
  public:
-  NotAssembled(std::shared_ptr<TrainStationManager> train_station_environment,
-               std::shared_ptr<Simulator> simulator,
-               std::shared_ptr<Train> train, time_t event_time)
-      : Event(train_station_environment, simulator, train, event_time) {}
-  virtual ~NotAssembled() {}
+  /** \brief The lifecycle starts with NotAssembled at event_time. */
+  TrainLifecycle(
+      std::shared_ptr<TrainStationManager> train_station_environment,
+      std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
+      SimTime event_time)
+      : Event(train_station_environment, simulator, train, event_time,
+              EventKind::NOT_ASSEMBLED) {}
+  ~TrainLifecycle() {}
+
+  /** \brief Runs the current step and logs it. */
   void Run() override;
 };
 
-/** \brief This event-class is used when NotAssembled class fail to asseble
- * a train. The class calculates new arrival time based on max speed on
- * train line or vehicle set. One asumption have been made that the train
- * accelerate with 0.2 mps2 until the train reaches max speed and hold this
- * speed is until deceleration begins with the same amount, 0.2, before reaching
- * destination. This might not be the perfectly realistic model but its a model.
+/** \brief The start of a disruption, see DisruptionSchedule. It has no
+ * train. The TrainStationManager re-plans the trains that are already
+ * committed to a closed route, the checks of the TrainLifecycle take care
+ * of the trains that come later.
  */
-class Incomplete : public Event {
-  static int getAccDist_Meter_Second(int max_speed, float acceleration);
-  int getPotentialDuration();
-  int getAverageSpeed() { return 0; }
-  float acceleration;
-  float deceleration;
+class DisruptionStart final : public Event {
+  std::size_t index_;
+  int getAverageSpeed() override { return 0; }
 
  public:
-  Incomplete(std::shared_ptr<TrainStationManager> train_station_environment,
-             std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
-             time_t event_time)
-      : Event(train_station_environment, simulator, train, event_time),
-        acceleration(0.2f),
-        deceleration(0.2f) {}
-  virtual ~Incomplete() {}
-  void Run() override;
-};
+  /** \brief index is the disruption in the schedule of the
+   * TrainStationManager. */
+  DisruptionStart(
+      std::shared_ptr<TrainStationManager> train_station_environment,
+      std::shared_ptr<Simulator> simulator, std::size_t index,
+      SimTime event_time)
+      : Event(train_station_environment, simulator, nullptr, event_time,
+              EventKind::DISRUPTION),
+        index_(index) {}
+  ~DisruptionStart() {}
 
-class Ready : public Event {
-  int getAverageSpeed() { return 0; }
-
- public:
-  Ready(std::shared_ptr<TrainStationManager> train_station_environment,
-        std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
-        time_t event_time)
-      : Event(train_station_environment, simulator, train, event_time) {}
-  virtual ~Ready() {}
   void Run() override;
 };
 
-class Running : public Event {
-  int getAverageSpeed();
+/** \brief Returns a vehicle to the pool of a station. It has no train. A
+ * what-if adds one for every vehicle that a train outside of it returned
+ * in the recorded run, see TrainStationManager::WhatIf. They are run with
+ * the finishing trains.
+ */
+class VehicleReturn final : public Event {
+  int station_;
+  int vehicle_id_;
+  int getAverageSpeed() override { return 0; }
 
  public:
-  Running(std::shared_ptr<TrainStationManager> train_station_environment,
-          std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
-          time_t event_time)
-      : Event(train_station_environment, simulator, train, event_time) {}
-  virtual ~Running() {}
-  void Run() override;
-};
-
-class Arrived : public Event {
-  int getAverageSpeed() { return 0; }
+  /** \brief station is a name id. */
+  VehicleReturn(
+      std::shared_ptr<TrainStationManager> train_station_environment,
+      std::shared_ptr<Simulator> simulator, int station, int vehicle_id,
+      SimTime event_time)
+      : Event(train_station_environment, simulator, nullptr, event_time,
+              EventKind::FINISHED),
+        station_(station),
+        vehicle_id_(vehicle_id) {}
+  ~VehicleReturn() {}
 
- public:
-  Arrived(std::shared_ptr<TrainStationManager> train_station_environment,
-          std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
-          time_t event_time)
-      : Event(train_station_environment, simulator, train, event_time) {}
-  virtual ~Arrived() {}
   void Run() override;
 };
 
-class Finished : public Event {
-  int getAverageSpeed() { return 0; }
+/** \brief Does nothing, it stands in for the events of the trains that a
+ * what-if does not run. The Simulator only runs an event if another event
+ * before the stop time is still queued. In a full run that can be an event
+ * of any train, for example one that keeps trying to assemble, so a
+ * what-if adds one of these at the last event of the trains it leaves out,
+ * see TrainStationManager::RunWhatIf.
+ */
+class EndOfRun final : public Event {
+  int getAverageSpeed() override { return 0; }
 
  public:
-  Finished(std::shared_ptr<TrainStationManager> train_station_environment,
-           std::shared_ptr<Simulator> simulator, std::shared_ptr<Train> train,
-           time_t event_time)
-      : Event(train_station_environment, simulator, train, event_time) {}
-  virtual ~Finished() {}
-  void Run() override;
-};
+  EndOfRun(std::shared_ptr<TrainStationManager> train_station_environment,
+           std::shared_ptr<Simulator> simulator, SimTime event_time)
+      : Event(train_station_environment, simulator, nullptr, event_time,
+              EventKind::NOT_ASSEMBLED) {}
+  ~EndOfRun() {}
 
-class EventCompare {
- public:
-  bool operator()(const std::shared_ptr<Event> &first,
-                  const std::shared_ptr<Event> &second);
+  void Run() override;
 };
 
 #endif  // PROJECT_INCLUDE_EVENT_H_
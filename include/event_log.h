@@ -0,0 +1,88 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_EVENT_LOG_H_
+#define PROJECT_INCLUDE_EVENT_LOG_H_
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "event.h"  //NOLINT
+
+class BinaryEventSink;
+
+/** \brief How much of the event log that is kept.
+ * KEEP_ALL keeps every event in memory.
+ * RING_BUFFER keeps the last events in memory and drops older ones.
+ * SPILL_TO_DISK keeps the last events in memory and writes older ones to a
+ * file in the binary export format. The file is still read by the queries.
+ */
+enum class RetentionPolicy { KEEP_ALL, RING_BUFFER, SPILL_TO_DISK };
+
+/** \brief This is the event log of the simulator.
+ * It holds the State of every event that has passed. The states do not
+ * reference the train, so a dropped or spilled event does not keep any
+ * other object alive.
+ *
+ * A State is not stored as it is, since its two vectors would cost two
+ * allocations per event. The scalar members are kept in an Entry and the
+ * vehicle ids of all events are kept one after the other in a shared
+ * container, so the log grows in blocks. The State is put together again
+ * when the log is read.
+ */
+class EventLog {
+  /** \brief The scalar members of a State and the number of connected and
+   * demanded vehicles, whose ids follow the ids of the previous entry. */
+  struct Entry {
+    SimTime event_time;
+    int train_number;
+    TrainStatus train_status;
+    SimTime planed_departure_time;
+    SimTime expected_arrival_time;
+    int average_speed;
+    int connected_vehicles;
+    int demanded_vehicles;
+  };
+
+  RetentionPolicy policy_;
+  std::size_t capacity_;
+  std::deque<Entry> entries_;
+  std::deque<int> vehicle_ids_;
+  std::string spill_path_;
+  std::shared_ptr<BinaryEventSink> spill_;
+  std::size_t spilled_;
+  std::size_t dropped_;
+
+  void dropOldest();
+  void spill();
+  void forEachInMemory(const std::function<void(const State &)> &action) const;
+  bool forEachSpilled(const std::function<void(const State &)> &action);
+
+ public:
+  EventLog();
+  ~EventLog();
+
+  /** \brief Sets the retention policy. Capacity is the number of events kept
+   * in memory by RING_BUFFER and SPILL_TO_DISK. The spill path is only used by
+   * SPILL_TO_DISK. Throws exception if the spill file can not be created. */
+  void SetRetentionPolicy(RetentionPolicy policy, std::size_t capacity,
+                          const std::string &spill_path);
+  RetentionPolicy GetRetentionPolicy() const { return policy_; }
+
+  void Add(const State &state);
+
+  /** \brief Calls action for every event that is still available, oldest
+   * first. Spilled events are read from the spill file. */
+  void ForEach(const std::function<void(const State &)> &action);
+
+  std::size_t GetNumberInMemory() const { return entries_.size(); }
+  std::size_t GetNumberSpilled() const { return spilled_; }
+  std::size_t GetNumberDropped() const { return dropped_; }
+};
+
+#endif  // PROJECT_INCLUDE_EVENT_LOG_H_
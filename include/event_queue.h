@@ -0,0 +1,99 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_EVENT_QUEUE_H_
+#define PROJECT_INCLUDE_EVENT_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+class Event;
+
+/** \brief Names an event in the EventQueue for as long as it is queued.
+ * The slot is used again by later events, the generation tells them apart,
+ * so an old handle is never mistaken for a new event. A default handle
+ * names no event. */
+struct EventHandle {
+  std::uint32_t slot;
+  std::uint32_t generation;
+
+  EventHandle() : slot(0), generation(0) {}
+  EventHandle(std::uint32_t slot, std::uint32_t generation)
+      : slot(slot), generation(generation) {}
+  bool operator==(const EventHandle &other) const {
+    return slot == other.slot && generation == other.generation;
+  }
+  bool operator!=(const EventHandle &other) const { return !(*this == other); }
+};
+
+/** \brief A binary heap of events with handles.
+ * Events are ordered on time, and events with the same time on their
+ * sequence, the order they were added in. Every queued event has a slot that
+ * knows where the event is in the heap, so Cancel and Reschedule find it in
+ * constant time and fix the heap in O(log n). Nothing is left behind in the
+ * heap by a cancelled event.
+ *
+ * The time and sequence are kept next to the event in the heap, so the
+ * comparisons do not follow the event pointers.
+ */
+class EventQueue {
+  struct Entry {
+    SimTime time;
+    std::uint64_t sequence;
+    std::uint32_t slot;
+    std::shared_ptr<Event> event;
+  };
+
+  struct Slot {
+    std::size_t index;
+    /** \brief Odd while the slot holds an event, even when it is free. */
+    std::uint32_t generation;
+  };
+
+  std::vector<Entry> heap_;
+  std::vector<Slot> slots_;
+  std::vector<std::uint32_t> free_slots_;
+
+  static bool before(const Entry &first, const Entry &second) {
+    if (first.time != second.time) return first.time < second.time;
+    return first.sequence < second.sequence;
+  }
+  void place(std::size_t index, Entry &&entry);
+  void siftUp(std::size_t index);
+  void siftDown(std::size_t index);
+  /** \brief Takes the entry at index out of the heap and frees its slot. */
+  Entry remove(std::size_t index);
+  bool find(EventHandle handle, std::size_t &index_out) const;  // NOLINT
+
+ public:
+  EventQueue() {}
+  ~EventQueue() {}
+
+  /** \brief Queues the event with its time and sequence. */
+  EventHandle Push(const std::shared_ptr<Event> &event);
+  bool Empty() const { return heap_.empty(); }
+  std::size_t Size() const { return heap_.size(); }
+  /** \brief The first event. The queue must not be empty. */
+  const std::shared_ptr<Event> &Top() const { return heap_.front().event; }
+  SimTime TopTime() const { return heap_.front().time; }
+  /** \brief Takes out the first event, its handle is no longer valid. */
+  std::shared_ptr<Event> Pop();
+
+  /** \brief If the handle names a queued event. */
+  bool Contains(EventHandle handle) const;
+  /** \brief Takes the event out of the queue. Returns false if the handle
+   * does not name a queued event. */
+  bool Cancel(EventHandle handle);
+  /** \brief Gives the event a new time and sequence and moves it in the
+   * heap. The event keeps its handle. Returns false if the handle does not
+   * name a queued event. */
+  bool Reschedule(EventHandle handle, SimTime time, std::uint64_t sequence);
+};
+
+#endif  // PROJECT_INCLUDE_EVENT_QUEUE_H_
@@ -0,0 +1,85 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_EVENT_SINK_H_
+#define PROJECT_INCLUDE_EVENT_SINK_H_
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "text_buffer.h"  //NOLINT
+
+class State;
+
+/** \brief The formats the events can be exported in. */
+enum class ExportFormat { CSV, JSON_LINES, BINARY };
+
+/** \brief This is the base class for the machine readable event export.
+ * Every event that is written to the log is also handed to the event sinks
+ * of the simulator. Each record is written to the file as soon as it is
+ * received, so the export does not grow with the number of events.
+ */
+class EventSink {
+ protected:
+  std::ofstream file_;
+  TextBuffer line_;
+
+ public:
+  explicit EventSink(const std::string &path, bool binary);
+  virtual ~EventSink() {}
+  virtual void Write(const State &state) = 0;
+  void Flush() { file_.flush(); }
+
+  /** \brief Creates a sink for the format. Throws exception if the file can
+   * not be created. */
+  static std::shared_ptr<EventSink> Create(ExportFormat format,
+                                           const std::string &path);
+  /** \brief Parses "csv", "jsonl" or "bin". Returns false if the name is not
+   * a known format. */
+  static bool ParseFormat(const std::string &name,
+                          ExportFormat &format_out);  // NOLINT
+};
+
+/** \brief One line per event with a header line. Times are in seconds since
+ * the scenario epoch and vehicle lists are separated by ';'. */
+class CsvEventSink : public EventSink {
+ public:
+  explicit CsvEventSink(const std::string &path);
+  void Write(const State &state) override;
+};
+
+/** \brief One JSON object per line. */
+class JsonLinesEventSink : public EventSink {
+ public:
+  explicit JsonLinesEventSink(const std::string &path)
+      : EventSink(path, false) {}
+  void Write(const State &state) override;
+};
+
+/** \brief A compact binary format. The file starts with the 8 byte magic
+ * "TRNEVT1" followed by a zero byte. Each record is a little endian uint32
+ * length followed by that many bytes:
+ * int64 event time, int32 train number, uint8 status, int64 planed
+ * departure, int64 expected arrival, int32 average speed, uint32 number of
+ * connected vehicles, int32 vehicle ids, uint32 number of demanded vehicles,
+ * uint8 vehicle types.
+ */
+class BinaryEventSink : public EventSink {
+ public:
+  static const char kMagic[8];
+  explicit BinaryEventSink(const std::string &path);
+  void Write(const State &state) override;
+
+  /** \brief Reads the record at offset in data and moves offset past it.
+   * Returns false at the end of data or if the record is broken. The vectors
+   * of state_out are reused. */
+  static bool Read(const char *data, std::size_t size,
+                   std::size_t &offset,  // NOLINT
+                   State &state_out);    // NOLINT
+};
+
+#endif  // PROJECT_INCLUDE_EVENT_SINK_H_
@@ -0,0 +1,68 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_PACED_CLOCK_H_
+#define PROJECT_INCLUDE_PACED_CLOCK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+/** \brief Maps simulation time to the monotonic clock for a paced run.
+ * The simulation time start_time is at the wall time the clock is created,
+ * and one wall second is speedup simulated seconds. Wall times are
+ * nanoseconds of CLOCK_MONOTONIC, so they do not jump with the system time.
+ *
+ * The ticks of the TimerWheel of a paced run are milliseconds since the
+ * clock was created.
+ */
+class PacedClock {
+  SimTime start_time_;
+  int speedup_;
+  std::int64_t start_ns_;
+
+ public:
+  static const std::int64_t kTickNs = 1000000;
+
+  PacedClock(SimTime start_time, int speedup);
+  ~PacedClock() {}
+
+  static std::int64_t Now();
+  /** \brief Sleeps with clock_nanosleep until the absolute wall time ns.
+   * Returns at once if it has passed. */
+  static void SleepUntil(std::int64_t ns);
+
+  int GetSpeedup() const { return speedup_; }
+  /** \brief The wall time an event at time should run. */
+  std::int64_t WallTimeOf(SimTime time) const;
+  /** \brief The simulation time at wall time ns. */
+  SimTime SimTimeAt(std::int64_t ns) const;
+  /** \brief The last tick at or before wall time ns. */
+  std::uint64_t TickAt(std::int64_t ns) const;
+  std::int64_t WallTimeOfTick(std::uint64_t tick) const;
+};
+
+/** \brief How late a paced run was. One sample is taken for every event
+ * time, the wall time the events ran minus the wall time they should have
+ * run at. */
+class LagStats {
+  std::vector<std::int64_t> lags_ns_;
+
+ public:
+  /** \brief Event times later than this are counted as late. */
+  static const std::int64_t kLateNs = 10 * PacedClock::kTickNs;
+
+  LagStats() {}
+  ~LagStats() {}
+
+  void Record(std::int64_t lag_ns) { lags_ns_.push_back(lag_ns); }
+  /** \brief Count, p50, p99 and max of the lag, the number of late event
+   * times and how far behind in simulated time the run was at most. */
+  std::string GetReport(int speedup) const;
+};
+
+#endif  // PROJECT_INCLUDE_PACED_CLOCK_H_
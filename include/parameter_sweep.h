@@ -0,0 +1,87 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_PARAMETER_SWEEP_H_
+#define PROJECT_INCLUDE_PARAMETER_SWEEP_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "simulation_parameters.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
+/** \brief The values a parameter takes in a sweep, steps values evenly
+ * spread from low to high. The names are the ones of
+ * SimulationParameters::Set. */
+struct ParameterRange {
+  std::string name;
+  double low;
+  double high;
+  int steps;
+};
+
+/** \brief The result of a whole run with parameters. */
+struct SweepResult {
+  SimulationParameters parameters;
+  SimTime total_delay;
+  int stuck_trains;
+  int on_time_trains;
+  int trains;
+};
+
+/** \brief Runs the whole simulation once for every combination of
+ * parameters and compares the results.
+ *
+ * The combinations are a grid of all values of the ranges, or a Latin
+ * hypercube that samples each range once per stratum. The parameters that
+ * have no range keep the value of base. Every run has its own Simulator and
+ * TrainStationManager, loaded from the files, so the runs share nothing and
+ * are handed out to a pool of threads one at a time.
+ */
+class ParameterSweep {
+  std::string station_path_;
+  std::string trains_path_;
+  std::string map_path_;
+  std::string disruptions_path_;
+  SimulationParameters base_;
+  std::vector<ParameterRange> ranges_;
+
+  SimulationParameters withValues(const std::vector<double> &values) const;
+  SweepResult runOne(const SimulationParameters &parameters) const;
+
+ public:
+  ParameterSweep(const std::string &station_path,
+                 const std::string &trains_path, const std::string &map_path,
+                 const SimulationParameters &base);
+  ~ParameterSweep() {}
+
+  /** \brief Every run reads the disruptions from path. */
+  void SetDisruptions(const std::string &path) { disruptions_path_ = path; }
+  /** \brief Reads the ranges from NAME=LOW:HIGH:STEPS separated by commas.
+   * STEPS can be left out for a grid of 3 values. Throws exception if the
+   * text is not valid. */
+  void SetRanges(const std::string &spec);
+
+  std::vector<SimulationParameters> Grid() const;
+  /** \brief samples combinations. Each range is split into samples strata
+   * and every stratum is used by exactly one combination. */
+  std::vector<SimulationParameters> LatinHypercube(int samples,
+                                                   unsigned seed) const;
+
+  /** \brief Runs every combination on jobs threads, 0 for one per core.
+   * The results are in the order of combinations. Rethrows the exception
+   * of the first run that failed. */
+  std::vector<SweepResult> Run(
+      const std::vector<SimulationParameters> &combinations,
+      std::size_t jobs) const;
+
+  /** \brief A table with a line per result: the parameters, the total
+   * delay, the trains stuck at a station and the share of the trains that
+   * arrived in time. */
+  static std::string FormatTable(const std::vector<SweepResult> &results);
+};
+
+#endif  // PROJECT_INCLUDE_PARAMETER_SWEEP_H_
@@ -0,0 +1,114 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_PROFILER_H_
+#define PROJECT_INCLUDE_PROFILER_H_
+
+/** \brief Profiling of the simulation hot path.
+ * The profiler is only built when TRAINS_PROFILING is defined, see the cmake
+ * option with the same name. Otherwise PROFILE_SCOPE expands to nothing and
+ * none of the classes below exist.
+ */
+#ifdef TRAINS_PROFILING
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+class TextBuffer;
+
+/** \brief The parts of the simulation that are timed. One for each event
+ * type, the time spent in Event::Log and the whole of RunNextEvent. The
+ * event sections do not include the Log of the event. */
+enum class ProfileSection {
+  NOT_ASSEMBLED,
+  INCOMPLETE,
+  READY,
+  RUNNING,
+  ARRIVED,
+  FINISHED,
+  DISRUPTION,
+  LOG,
+  RUN_NEXT_EVENT,
+  COUNT
+};
+
+/** \brief Collects counts and wall time per section.
+ * Durations are kept in a histogram with eight buckets per power of two, so
+ * percentiles are within about ten percent without storing every sample.
+ * The event queue depth is sampled once every ten simulated minutes.
+ */
+class Profiler {
+  static const int kSubBuckets = 8;
+  static const int kBuckets = 48 * kSubBuckets;
+  static const SimTime kDepthSampleInterval = 10 * 60;
+
+  struct SectionStats {
+    std::uint64_t count;
+    std::uint64_t total_ns;
+    std::uint64_t max_ns;
+    std::uint64_t histogram[kBuckets];
+  };
+
+  SectionStats sections_[static_cast<int>(ProfileSection::COUNT)];
+  std::vector<std::pair<SimTime, std::size_t>> queue_depth_;
+  std::size_t max_queue_depth_;
+
+  static int bucketOf(std::uint64_t ns);
+  static std::uint64_t bucketUpperBound(int bucket);
+  std::uint64_t percentile(const SectionStats &stats, double fraction) const;
+
+ public:
+  Profiler();
+  ~Profiler() {}
+
+  void Record(ProfileSection section, std::uint64_t ns);
+  void SampleQueueDepth(SimTime time, std::size_t depth);
+
+  static const char *SectionName(ProfileSection section);
+
+  /** \brief A table with one row per section and the queue depth samples. */
+  std::string GetReport() const;
+  /** \brief The same data as GetReport as one JSON object. */
+  void AppendJson(TextBuffer &out) const;  // NOLINT
+};
+
+/** \brief Times the enclosing scope and records it in the profiler. */
+class ProfileScope {
+  Profiler &profiler_;
+  ProfileSection section_;
+  std::chrono::steady_clock::time_point start_;
+
+ public:
+  ProfileScope(Profiler &profiler, ProfileSection section)  // NOLINT
+      : profiler_(profiler),
+        section_(section),
+        start_(std::chrono::steady_clock::now()) {}
+  ~ProfileScope() {
+    profiler_.Record(section_,
+                     static_cast<std::uint64_t>(
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start_)
+                             .count()));
+  }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(profiler, section) \
+  ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)((profiler), (section))
+
+#else
+
+#define PROFILE_SCOPE(profiler, section)
+
+#endif  // TRAINS_PROFILING
+
+#endif  // PROJECT_INCLUDE_PROFILER_H_
@@ -0,0 +1,108 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_QUERY_SERVER_H_
+#define PROJECT_INCLUDE_QUERY_SERVER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class SimulationWorker;
+class Simulator;
+class TrainStationManager;
+struct SimulationSnapshot;
+
+/** \brief This class answers queries on a Unix domain socket while the
+ * simulation runs or after it is done.
+ * One thread serves all connections with epoll. A request is one line with a
+ * command and its arguments separated by spaces. The answer is a line with
+ * OK or ERR and the length of the body in bytes, followed by the body:
+ *
+ *     TRAIN 17 high
+ *     OK 342
+ *     <342 bytes>
+ *
+ * Commands, the last argument "high" gives high detail level:
+ *
+ *     STATUS                   time and delays of the simulation
+ *     TIMETABLE [page]         50 trains of the time table per page
+ *     TRAIN number [high]      a train by train number
+ *     VEHICLE_TRAIN id [high]  the train a vehicle is connected to
+ *     VEHICLE id               a vehicle and where it is
+ *     STATION name [high]      a station and its trains
+ *     LIFECYCLE number [high]  the events of a train
+ *     VEHICLE_LIFECYCLE id [high]
+ *                              the events of the train of a vehicle
+ *     STATS [high]             delays, energy use and throughput
+ *
+ * The trains, stations and vehicles are read from the published
+ * SimulationSnapshot on the server thread. The lifecycles and the statistics
+ * need the event log and the accounts, so they are sent to the
+ * SimulationWorker and answered between two events. A connection may send
+ * several requests without waiting, the answers come in the same order.
+ *
+ * The constructor throws exception if the socket can not be created.
+ */
+class QueryServer {
+  struct Connection {
+    int fd;
+    std::string input;
+    std::string output;
+    std::size_t written;
+    /** \brief A query of this connection is at the worker. The input after
+     * it waits for the answer, so the answers keep their order. */
+    bool waiting;
+    bool want_write;
+  };
+
+  std::string path_;
+  std::shared_ptr<Simulator> simulator_;
+  std::shared_ptr<TrainStationManager> train_station_manager_;
+  std::shared_ptr<SimulationWorker> simulation_worker_;
+  int listen_fd_;
+  int epoll_fd_;
+  int stop_fd_;
+  std::uint64_t next_id_;
+  std::unordered_map<std::uint64_t, Connection> connections_;
+  /** \brief The time table of timetable_snapshot_, with the offset of every
+   * line. It is made again when a new snapshot is published. */
+  std::shared_ptr<const SimulationSnapshot> timetable_snapshot_;
+  std::string timetable_;
+  std::vector<std::size_t> timetable_lines_;
+  std::thread thread_;
+
+  void run();
+  void acceptConnections();
+  void readFrom(std::uint64_t id);
+  void handleInput(std::uint64_t id, Connection &connection);  // NOLINT
+  void handleRequest(std::uint64_t id, Connection &connection,  // NOLINT
+                     const std::string &line);
+  void sendToWorker(std::uint64_t id, Connection &connection,  // NOLINT
+                    std::function<std::string()> answer);
+  void handleAnswers();
+  void flush(std::uint64_t id, Connection &connection);  // NOLINT
+  void closeConnection(std::uint64_t id);
+  std::string timetablePage(int page);
+  static void appendResponse(Connection &connection, bool ok,  // NOLINT
+                             const std::string &body);
+
+ public:
+  QueryServer(const std::string &path, std::shared_ptr<Simulator> simulator,
+              std::shared_ptr<TrainStationManager> train_station_manager,
+              std::shared_ptr<SimulationWorker> simulation_worker);
+  /** \brief Stops the thread, closes all connections and removes the
+   * socket file. */
+  ~QueryServer();
+  QueryServer(const QueryServer &) = delete;
+  QueryServer &operator=(const QueryServer &) = delete;
+};
+
+#endif  // PROJECT_INCLUDE_QUERY_SERVER_H_
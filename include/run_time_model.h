@@ -0,0 +1,79 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_RUN_TIME_MODEL_H_
+#define PROJECT_INCLUDE_RUN_TIME_MODEL_H_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+class Vehicle;
+
+/** \brief The distance and the minimum running time of a train line. */
+struct RunTime {
+  int distance_m;
+  int run_time_s;
+};
+
+/** \brief This class calculates how long a train needs between two stations.
+ * The consist class of a train is the number of vehicles of each type it
+ * demands. Since the vehicles are not known before the train is assembled,
+ * each type is given the average attributes of its type in the whole fleet.
+ * Locomotives pull with their power, limited by adhesion at low speed. The
+ * train is slowed by a Davis resistance, a + b * v per ton plus c * v^2, and
+ * brakes with a constant deceleration before the arrival station. Freight
+ * cars are assumed to be loaded. The acceleration can be capped, as a
+ * driver would to spare the vehicles.
+ *
+ * The running time is calculated once per line and consist class when the
+ * time table is loaded. The events then only look it up.
+ */
+class RunTimeModel {
+  static const int kNumberOfTypes = 6;
+
+  /** \brief Summed attributes of the fleet, indexed by vehicle type. For
+   * locomotives it is the power in kW, for carriages the payload in tons. */
+  double attribute_sum_[kNumberOfTypes];
+  int count_[kNumberOfTypes];
+  double max_acceleration_;
+  std::vector<RunTime> table_;
+  std::map<std::vector<int>, std::size_t> index_;
+
+  double averageAttribute(int type) const;
+  int calculateRunTime(int distance_m, int max_speed_kmh,
+                       const std::vector<int> &vehicles_per_type) const;
+
+ public:
+  static const double kDieselKwhPerLiter;
+  static const double kRotatingMassFactor;
+
+  RunTimeModel();
+  ~RunTimeModel() {}
+
+  /** \brief Adds a vehicle to the fleet averages. All vehicles have to be
+   * added before the first line. */
+  void AddToFleet(const Vehicle &vehicle);
+  /** \brief Caps the acceleration in m/s^2, 0 for no cap. Forgets the lines
+   * calculated so far, so they have to be added again. */
+  void SetMaxAcceleration(double max_acceleration);
+
+  /** \brief Returns the index of the running time for the line. Lines with
+   * the same distance, max speed and consist class share the index. */
+  std::size_t AddLine(int distance_m, int max_speed_kmh,
+                      const std::vector<int> &demanded_vehicles);
+
+  const RunTime &Get(std::size_t index) const { return table_[index]; }
+
+  /** \brief Attributes of a single vehicle in the model. The payload is zero
+   * for locomotives and the power is zero for carriages. */
+  static double PayloadTons(const Vehicle &vehicle);
+  static double PowerKw(const Vehicle &vehicle);
+  static double MassTons(const Vehicle &vehicle);
+  /** \brief Resistance in N of a train at speed in m/s. */
+  static double ResistanceN(double mass_tons, int vehicles, double speed);
+};
+
+#endif  // PROJECT_INCLUDE_RUN_TIME_MODEL_H_
@@ -0,0 +1,47 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_SIMULATION_PARAMETERS_H_
+#define PROJECT_INCLUDE_SIMULATION_PARAMETERS_H_
+
+#include <string>
+
+/** \brief The operational timing of a run. The defaults are the timing of
+ * the time table: a train is assembled 30 minutes before it departs, is
+ * ready 20 minutes later and departs 10 minutes after that. A failed
+ * assembly is tried again every 10 minutes, each time moving the departure
+ * as much, and the vehicles are returned 20 minutes after arrival.
+ *
+ * The first assembly is ready_after_s + depart_after_s before departure, so
+ * a train that is assembled at once departs on time. max_acceleration caps
+ * the acceleration of the running time model in m/s^2, 0 leaves it to the
+ * traction of the locomotives.
+ */
+struct SimulationParameters {
+  int ready_after_s;
+  int depart_after_s;
+  int retry_interval_s;
+  int turnaround_s;
+  double max_acceleration;
+
+  SimulationParameters()
+      : ready_after_s(20 * 60),
+        depart_after_s(10 * 60),
+        retry_interval_s(10 * 60),
+        turnaround_s(20 * 60),
+        max_acceleration(0.0) {}
+
+  int GetAssembleBefore() const { return ready_after_s + depart_after_s; }
+
+  /** \brief Sets a parameter by name: ready, depart, retry and turnaround in
+   * minutes, acceleration in m/s^2. Returns false for an unknown name or a
+   * value out of range. */
+  bool Set(const std::string &name, double value);
+  /** \brief Reads NAME=VALUE, see Set. Throws exception if it is not
+   * valid. */
+  void SetFromText(const std::string &assignment);
+};
+
+#endif  // PROJECT_INCLUDE_SIMULATION_PARAMETERS_H_
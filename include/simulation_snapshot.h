@@ -0,0 +1,54 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_SIMULATION_SNAPSHOT_H_
+#define PROJECT_INCLUDE_SIMULATION_SNAPSHOT_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "train.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
+/** \brief The part of a Train that changes during the simulation. The
+ * vehicles are a range in SimulationSnapshot::vehicle_ids and the vehicles
+ * the train still waits for a range in SimulationSnapshot::demanded_vehicles.
+ */
+struct TrainSnapshot {
+  TrainStatus train_status;
+  SimTime planed_departure_time;
+  SimTime expected_arrival_time;
+  std::size_t first_vehicle;
+  std::size_t vehicle_count;
+  std::size_t first_demanded;
+  std::size_t demanded_count;
+};
+
+/** \brief A copy of the state the menus show, taken between two events.
+ * A snapshot is not changed while it is published by the
+ * TrainStationManager. A reader keeps the shared_ptr it got for as long as
+ * it needs it, so the simulation never waits for a reader.
+ *
+ * Only what changes is copied, the train lines and vehicles are looked up in
+ * the TrainStationManager, which does not change them after loading. All
+ * ranges are kept in a few flat vectors, so a snapshot that is used again
+ * is filled without allocating.
+ */
+struct SimulationSnapshot {
+  SimTime current_time;
+  SimTime total_delay;
+  SimTime total_departure_delay;
+  /** \brief Indexed as the trains of the TrainStationManager. */
+  std::vector<TrainSnapshot> trains;
+  std::vector<int> vehicle_ids;
+  std::vector<int> demanded_vehicles;
+  /** \brief The vehicles parked at station n are parked_vehicle_ids from
+   * station_first_vehicle[n] to station_first_vehicle[n + 1], where n is
+   * the name id of the station. */
+  std::vector<std::size_t> station_first_vehicle;
+  std::vector<int> parked_vehicle_ids;
+};
+
+#endif  // PROJECT_INCLUDE_SIMULATION_SNAPSHOT_H_
@@ -0,0 +1,152 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_SIMULATION_WORKER_H_
+#define PROJECT_INCLUDE_SIMULATION_WORKER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "spsc_queue.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
+class Simulator;
+class TrainStationManager;
+
+/** \brief RUN_TO runs the events before time, or all events if time is at or
+ * after the stop time. RUN_PACED does the same in step with the wall clock,
+ * speedup simulated seconds per second. STEP runs the next event. PAUSE stops
+ * a RUN_TO or RUN_PACED that is running and STOP ends the thread. */
+enum class WorkerCommandType { RUN_TO, RUN_PACED, STEP, PAUSE, STOP };
+
+struct WorkerCommand {
+  WorkerCommandType type;
+  SimTime time;
+  int speedup;
+};
+
+/** \brief TEXT is console log output, and the lag report at the end of a
+ * RUN_PACED. RUN_TO, RUN_PACED and STEP end with DONE, or with
+ * FAILED if the simulation threw exception. PAUSE and STOP have no output of
+ * their own, a PAUSE that comes when nothing runs is ignored. */
+enum class WorkerOutputType { TEXT, DONE, FAILED };
+
+struct WorkerOutput {
+  WorkerOutputType type;
+  /** \brief The log text of TEXT and the message of FAILED. */
+  std::string text;
+  /** \brief The current time of the simulator when the command ended. */
+  SimTime current_time;
+  /** \brief For RUN_TO and RUN_PACED, if there are events left after the
+   * run. For STEP, if there was an event to run. */
+  bool events_left;
+  /** \brief The run was stopped by PAUSE before it reached its time. */
+  bool paused;
+};
+
+/** \brief A question that needs the event log or the accounts, which only
+ * the worker may read while the simulation runs. answer is called by the
+ * worker between two events and may throw exception. */
+struct WorkerQuery {
+  std::uint64_t id;
+  std::function<std::string()> answer;
+};
+
+/** \brief The answer to the WorkerQuery with the same id. text is the
+ * exception message if ok is false. */
+struct WorkerAnswer {
+  std::uint64_t id;
+  bool ok;
+  std::string text;
+};
+
+/** \brief This class runs the Simulator on its own thread.
+ * The user interface sends commands and receives the console log and the
+ * result of each command through two lock free single producer, single
+ * consumer queues. The worker sleeps on a condition variable when it has no
+ * command, so an idle worker does not use the cpu.
+ *
+ * The console log is collected by the worker and sent in chunks, so the
+ * user interface prints it at its own pace while a large network is run at
+ * full speed. The worker looks for PAUSE between events.
+ *
+ * A paced run sleeps until the wall time of each event time and then runs
+ * the events of that time, see runPaced.
+ *
+ * The worker publishes a snapshot of the trains and stations at the end of
+ * every command and about every 100 ms during a run, see
+ * TrainStationManager::PublishSnapshot. Other than the snapshot, the user
+ * interface may only use the Simulator and the TrainStationManager between
+ * DONE and the next command. The queues order the memory of the two
+ * threads, so the state the worker left is seen by the user interface and
+ * the other way around.
+ *
+ * A second pair of queues takes queries from one other thread, the
+ * QueryServer. They are answered between events, also while a command runs,
+ * and the answers are signaled on an eventfd the server can wait for.
+ */
+class SimulationWorker {
+  std::shared_ptr<Simulator> simulator_;
+  std::shared_ptr<TrainStationManager> train_station_manager_;
+  SpscQueue<WorkerCommand> commands_;
+  SpscQueue<WorkerOutput> outputs_;
+  SpscQueue<WorkerQuery> queries_;
+  SpscQueue<WorkerAnswer> answers_;
+  /** \brief An eventfd that is signaled when there are answers. */
+  int answer_fd_;
+  TextBuffer console_output_;
+  bool stopping_;
+  std::mutex wake_mutex_;
+  std::condition_variable command_ready_;
+  std::condition_variable output_ready_;
+  std::thread thread_;
+
+  void run();
+  /** \brief Returns false if the run was stopped by a command. */
+  bool runTo(SimTime time);
+  /** \brief Runs to time like runTo, each event time at its wall time. The
+   * wake ups are kept on a TimerWheel: the next event time, the snapshot
+   * and a poll for commands and queries. Returns false if the run was
+   * stopped by a command. */
+  bool runPaced(SimTime time, int speedup);
+  /** \brief Takes a pending command, which stops a run, and sets stopping_
+   * for STOP. Returns false if there is none. */
+  bool stopRequested();
+  void step();
+  void sendConsoleOutput();
+  void send(WorkerOutput &&output);
+  void answerQueries();
+
+ public:
+  SimulationWorker(
+      std::shared_ptr<Simulator> simulator,
+      std::shared_ptr<TrainStationManager> train_station_manager);
+  /** \brief Stops the thread and waits for it. */
+  ~SimulationWorker();
+  SimulationWorker(const SimulationWorker &) = delete;
+  SimulationWorker &operator=(const SimulationWorker &) = delete;
+
+  void Send(WorkerCommandType type, SimTime time, int speedup = 1);
+  /** \brief Returns false if there is no output. */
+  bool TryReceive(WorkerOutput &output_out);  // NOLINT
+  /** \brief Waits for output for at most timeout_ms milliseconds. */
+  void WaitForOutput(int timeout_ms);
+
+  /** \brief This file descriptor is readable when there are answers. Read
+   * it to reset it before taking the answers. */
+  int GetAnswerFd() const { return answer_fd_; }
+  /** \brief Returns false if the queue is full. */
+  bool SendQuery(WorkerQuery &&query);
+  /** \brief Returns false if there is no answer. */
+  bool TryReceiveAnswer(WorkerAnswer &answer_out);  // NOLINT
+};
+
+#endif  // PROJECT_INCLUDE_SIMULATION_WORKER_H_
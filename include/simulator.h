@@ -6,100 +6,185 @@
 #ifndef PROJECT_INCLUDE_SIMULATOR_H_
 #define PROJECT_INCLUDE_SIMULATOR_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
 #include <iosfwd>
-#include <list>
 #include <memory>
-#include <queue>
 #include <string>
 #include <vector>
 
+#include "energy_account.h"  //NOLINT
 #include "event.h"  //NOLINT
+#include "event_log.h"  //NOLINT
+#include "event_queue.h"  //NOLINT
+#include "event_sink.h"  //NOLINT
+#include "profiler.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+#include "throughput_account.h"  //NOLINT
+#include "train_time.h"  //NOLINT
 
 /** \brief This class is performing the simulation.
  * It holds all time stamps and also the event queue and the event log.
  */
 class Simulator {
-  time_t start_simulation_time_;
-  time_t current_time_;
-  time_t stop_simulation_time_;
-  time_t stop_time_;
+  SimTime start_simulation_time_;
+  SimTime current_time_;
+  SimTime stop_simulation_time_;
+  SimTime stop_time_;
   int discrete_interval_;
   bool high_detail_level_;
-  time_t total_delay;
-  time_t total_departure_delay;
-  std::priority_queue<std::shared_ptr<Event>,
-                      std::vector<std::shared_ptr<Event>>, EventCompare>
-      event_queue_;
-  std::list<std::shared_ptr<Event>> event_log_;
+  SimTime total_delay;
+  SimTime total_departure_delay;
+  EnergyAccount energy_account_;
+  ThroughputAccount throughput_account_;
+  EventQueue event_queue_;
+  /** \brief All events with the time of the first event in the queue, taken
+   * out of the queue together and grouped by kind, see EventKind. batch_next_
+   * is the index of the next event to run. */
+  std::vector<std::shared_ptr<Event>> batch_;
+  std::size_t batch_next_;
+  std::uint64_t next_sequence_;
+  EventLog event_log_;
+  std::ofstream log_file_;
+  TextBuffer log_line_;
+  State log_state_;
+  bool console_log_;
+  bool log_to_file_;
+  TextBuffer *console_output_;
+  std::vector<std::shared_ptr<EventSink>> event_sinks_;
+#ifdef TRAINS_PROFILING
+  Profiler profiler_;
+#endif
 
   void setupTime();
+  /** \brief Moves the next events from the queue to the batch when the
+   * batch has been run. Returns false if there are no events left. */
+  bool fillBatch();
+  /** \brief The index in batch_ of the event that has not run yet with the
+   * handle, or batch_.size(). */
+  std::size_t findInBatch(EventHandle handle) const;
 
  public:
-  Simulator()
+  Simulator() : Simulator(true) {}
+  /** \brief Without log_to_file, Trainsim.log is neither removed nor
+   * written. Used for the runs of a what-if next to the real simulation,
+   * see TrainStationManager::WhatIf. */
+  explicit Simulator(bool log_to_file)
       : total_delay(0),
         total_departure_delay(0),
         high_detail_level_(0),
+        console_log_(true),
+        log_to_file_(log_to_file),
+        console_output_(nullptr),
         discrete_interval_(10),
         current_time_(0),
         stop_time_(0),
         start_simulation_time_(0),
-        stop_simulation_time_(0) {
+        stop_simulation_time_(0),
+        batch_next_(0),
+        next_sequence_(0) {
     setupTime();
   }
   ~Simulator() {}
 
-  void AddEvent(const std::shared_ptr<Event> &event);
-  void AddToEventLog(const std::shared_ptr<Event> &event);
+  /** \brief Queues the event at its time. The handle names the event until
+   * it is run or cancelled. */
+  EventHandle AddEvent(const std::shared_ptr<Event> &event);
+  /** \brief Takes a queued event out, so it is never run. Returns false if
+   * the event has been run or cancelled. */
+  bool CancelEvent(EventHandle handle);
+  /** \brief Moves a queued event to time. It runs after the events already
+   * queued at that time, as if it was added now. Returns false if the event
+   * has been run or cancelled. */
+  bool RescheduleEvent(EventHandle handle, SimTime time);
+  void AddToEventLog(const State &state) { event_log_.Add(state); }
 
   /** Returns the time of the next comming event. */
-  time_t GetTime() const;
+  SimTime GetTime() const;
 
-  time_t GetCurrentTime() const { return current_time_; }
+  SimTime GetCurrentTime() const { return current_time_; }
+
+  bool HasEvents() const;
 
   /** This function pops event until event time >= current time. */
   bool RunEventsUntilTime();
 
-  /** This function pops one event. */
+  /** \brief Runs the next event if RunEventsUntilTime would run it. Returns
+   * false if there is no such event. */
+  bool RunEventIfTime();
+
+  /** This function pops one event. Events with the same time are run
+   * grouped by kind, and in the order they were added within a kind. */
   bool RunNextEvent();
 
   /** This function increment the total delay counter. */
-  void AddToDelay(time_t sec) { total_delay += sec; }
+  void AddToDelay(SimTime sec) { total_delay += sec; }
 
   /** This function increment the total departure delay counter. */
-  void AddToDepartureDelay(time_t sec) { total_departure_delay += sec; }
-  time_t GetTotalDelay() { return total_delay; }
-  time_t GetTotalDepartureDelay() { return total_departure_delay; }
+  void AddToDepartureDelay(SimTime sec) { total_departure_delay += sec; }
+  SimTime GetTotalDelay() { return total_delay; }
+  SimTime GetTotalDepartureDelay() { return total_departure_delay; }
+  EnergyAccount &GetEnergyAccount() { return energy_account_; }
+  ThroughputAccount &GetThroughputAccount() { return throughput_account_; }
   bool IsHighDetailLevel() { return high_detail_level_; }
   void SetHighDetailLevel(bool high_detail_level) {
     high_detail_level_ = high_detail_level;
   }
-  time_t GetStopSimulationTime() const { return stop_simulation_time_; }
-  time_t GetStartSimulationTime() const { return start_simulation_time_; }
-  time_t GetStopTime() const { return stop_time_; }
-  void SetCurrentTime(time_t current_time) { current_time_ = current_time; }
-  void SetStartSimulationTime(time_t start_simulation_time) {
+  SimTime GetStopSimulationTime() const { return stop_simulation_time_; }
+  SimTime GetStartSimulationTime() const { return start_simulation_time_; }
+  SimTime GetStopTime() const { return stop_time_; }
+  void SetCurrentTime(SimTime current_time) { current_time_ = current_time; }
+  void SetStartSimulationTime(SimTime start_simulation_time) {
     start_simulation_time_ = start_simulation_time;
   }
-  void SetStopSimulationTime(time_t stop_simulation_time) {
+  void SetStopSimulationTime(SimTime stop_simulation_time) {
     stop_simulation_time_ = stop_simulation_time;
   }
 
-  void SetStopTime(time_t stop_time) { stop_time_ = stop_time; }
+  void SetStopTime(SimTime stop_time) { stop_time_ = stop_time; }
   void SetDiscreteInterval(int discrete_interval) {
     discrete_interval_ = discrete_interval;
   }
   int GetDiscreteInterval() const { return discrete_interval_; }
 
-  std::list<std::shared_ptr<Event>> GetEventLog() { return event_log_; }
+  EventLog &GetEventLog() { return event_log_; }
+
+  /** \brief Limits how many events the event log keeps in memory, see
+   * RetentionPolicy. Spilled events are written to Trainsim.spill. */
+  void SetEventLogRetention(RetentionPolicy policy, std::size_t capacity);
+
+  /** \brief Returns the cleared buffer used for building the next log line.
+   * The line is written to the log file and the console by CommitLogLine. The
+   * buffer and the log file are reused, so logging does not allocate. */
+  TextBuffer &BeginLogLine();
+  void CommitLogLine();
+  /** \brief The State of the event that is logged, filled by Event::Log and
+   * passed to the event log and the event sinks. It is reused like the log
+   * line, so its vectors keep their capacity from one event to the next. */
+  State &GetLogState() { return log_state_; }
+
+  /** \brief Turns printing of the log to the console on or off. The log file
+   * is always written. */
+  void SetConsoleLog(bool console_log) { console_log_ = console_log; }
+
+  /** \brief When set, the console log is appended to console_output instead
+   * of written to std::cout. Used when the simulation runs on a worker
+   * thread, see SimulationWorker. */
+  void SetConsoleOutput(TextBuffer *console_output) {
+    console_output_ = console_output;
+  }
+
+  /** \brief Event sinks receive every event that is written to the log. */
+  void AddEventSink(const std::shared_ptr<EventSink> &event_sink) {
+    event_sinks_.emplace_back(event_sink);
+  }
+  void ExportEvent(const State &state);
+  void FlushLog();
 
-  /** \brief This function returns the life cycle of a train by iterating over
-   * the event log. */
-  bool GetTrainLifeCycleByTrainNumber(int train_number,
-                                      std::string &details_out,  // NOLINT
-                                      bool high_detail_level);
-  bool GetTrainLifeCycleByVehicleId(int vehicle_id,
-                                    std::string &details_out,  // NOLINT
-                                    bool high_detail_level);
+#ifdef TRAINS_PROFILING
+  Profiler &GetProfiler() { return profiler_; }
+#endif
 };
 
 #endif  // PROJECT_INCLUDE_SIMULATOR_H_
@@ -0,0 +1,75 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_SPSC_QUEUE_H_
+#define PROJECT_INCLUDE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/** \brief A bounded queue between exactly one producer thread and one
+ * consumer thread. It does not lock: the producer only writes tail_ and the
+ * consumer only writes head_, and each publishes its slot with a release
+ * store that the other side reads with acquire.
+ *
+ * The capacity is rounded up to a power of two. TryPush returns false when
+ * the queue is full and leaves the value untouched, TryPop returns false
+ * when it is empty.
+ */
+template <typename T>
+class SpscQueue {
+  static const std::size_t kCacheLine = 64;
+  typedef std::atomic<std::size_t> Index;
+
+  std::vector<T> slots_;
+  std::size_t mask_;
+  // The two indexes are a cache line apart from each other and from the
+  // members before them, so the threads do not invalidate each other's
+  // line on every push and pop. It is padding and not alignas, since
+  // operator new in C++11 does not align the queue, or the object that
+  // holds it, to more than alignof(std::max_align_t).
+  char pad_before_head_[kCacheLine];
+  Index head_;
+  char pad_after_head_[kCacheLine - sizeof(Index)];
+  Index tail_;
+  char pad_after_tail_[kCacheLine - sizeof(Index)];
+
+ public:
+  explicit SpscQueue(std::size_t capacity) : head_(0), tail_(0) {
+    std::size_t size = 1;
+    while (size < capacity) size <<= 1;
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  bool TryPush(T &&value) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T &value_out) {  // NOLINT
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    value_out = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+};
+
+#endif  // PROJECT_INCLUDE_SPSC_QUEUE_H_
@@ -7,9 +7,9 @@
 #define PROJECT_INCLUDE_STATION_H_
 
 #include <iosfwd>
-#include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 class Train;
 class Train;
@@ -21,7 +21,7 @@ class Vehicle;
 class Station {
   int id_;
   std::string name_;
-  std::list<std::shared_ptr<Vehicle>> vehicle_pool_;
+  std::vector<std::shared_ptr<Vehicle>> vehicle_pool_;
 
  public:
   Station(int id, std::string name);
@@ -33,6 +33,9 @@ class Station {
                         std::shared_ptr<Vehicle> &out_vehicle);        // NOLINT
   bool GetVehicleById(int id, std::shared_ptr<Vehicle> &out_vehicle);  // NOLINT
   int GetNumberOfVehicles();
+  /** \brief Appends the ids of the vehicles in the pool to ids_out, in pool
+   * order. */
+  void AppendVehicleIds(std::vector<int> &ids_out) const;  // NOLINT
 };
 
 bool operator==(std::shared_ptr<Station> &lhs, //NOLINT
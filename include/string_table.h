@@ -0,0 +1,35 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_STRING_TABLE_H_
+#define PROJECT_INCLUDE_STRING_TABLE_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \brief This class interns strings.
+ * Every distinct string gets an id, counted from 0 in the order the strings
+ * are added. The rest of the program stores and compares the ids and only
+ * looks up the text when it is written out.
+ */
+class StringTable {
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, int> ids_;
+
+ public:
+  StringTable() {}
+  ~StringTable() {}
+
+  /** \brief Returns the id of text, adding it if it is new. */
+  int Intern(const std::string &text);
+  /** \brief Returns false if text has not been added. */
+  bool Find(const std::string &text, int &id_out) const;  // NOLINT
+  const std::string &Get(int id) const { return strings_[id]; }
+  std::size_t Size() const { return strings_.size(); }
+};
+
+#endif  // PROJECT_INCLUDE_STRING_TABLE_H_
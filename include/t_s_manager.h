@@ -6,28 +6,115 @@
 #ifndef PROJECT_INCLUDE_T_S_MANAGER_H_
 #define PROJECT_INCLUDE_T_S_MANAGER_H_
 
-#include <list>
+#include <cstdint>
 #include <utility>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-class Distance;
+#include "delay_attribution.h"  //NOLINT
+#include "disruption_schedule.h"  //NOLINT
+#include "run_time_model.h"  //NOLINT
+#include "simulation_parameters.h"  //NOLINT
+#include "string_table.h"  //NOLINT
+#include "train_map.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+#include "vehicle_flow_graph.h"  //NOLINT
+
+struct DistanceRecord;
+struct SimulationSnapshot;
+struct StationRecord;
+struct TrainRecord;
+class Event;
+class State;
 class Simulator;
 class Train;
+class TrainStationManager;
 class Station;
+class TextBuffer;
 class Vehicle;
 
-/** \brief This is holding the data used in the simulation. It holds a list
- * of all stations, trains and distances between stations. It also holds a
- * weak pointer to the simulator object.
+/** \brief A train of a what-if that departs at another time. The arrival
+ * is moved as much as the departure. */
+struct DepartureEdit {
+  int train_number;
+  SimTime departure_time;
+};
+
+/** \brief A what-if run by TrainStationManager::RunWhatIf. changed has the
+ * index of the train of every edit, and the trains of scenario are the
+ * ones with the indices in cone. If the run was stopped at the cost limit,
+ * complete is false, total_delay is the delay so far and cost is only a
+ * lower bound. The trains that have not arrived are then not known. */
+struct WhatIfRun {
+  std::vector<std::size_t> changed;
+  std::vector<std::size_t> cone;
+  std::shared_ptr<TrainStationManager> scenario;
+  SimTime total_delay;
+  int not_arrived_trains;
+  SimTime cost;
+  bool complete;
+};
+
+/** \brief This is holding the data used in the simulation. It holds all
+ * stations, trains and distances between stations in vectors that are filled
+ * once when the data is loaded. It also holds a weak pointer to the simulator
+ * object.
  *
+ * The trains and the station pools are changed by the events. The menus read
+ * them from a SimulationSnapshot instead, which is published by
+ * PublishSnapshot between events. SeeTimeTable, GetTrainDetailsByTrainNumber,
+ * GetTrainDetailsByVehicleId, GetStationDetails and FindVehicle only read the
+ * snapshot and the data that does not change after loading, so they can be
+ * called from any thread while the simulation runs.
  */
 class TrainStationManager
     : public std::enable_shared_from_this<TrainStationManager> {
-  std::list<std::shared_ptr<Station>> stations_;
-  std::list<std::shared_ptr<Train>> trains_;
-  std::list<std::shared_ptr<Distance>> distances_;
+  std::vector<std::shared_ptr<Station>> stations_;
+  std::vector<std::shared_ptr<Train>> trains_;
+  std::vector<Distance> distances_;
+  /** \brief Every station name is interned here when the data is loaded.
+   * Trains and distances hold the ids of the names. The station names are
+   * added first, so the station with id n has name id n - 1 and is found at
+   * that index in stations_. */
+  StringTable station_names_;
+  /** \brief Indices built when the data is loaded. distance_by_route_ is
+   * indexed by the two name ids, see routeKey(). */
+  std::unordered_map<std::uint64_t, int> distance_by_route_;
+  std::unordered_map<int, std::size_t> train_index_by_number_;
+  std::unordered_map<int, std::shared_ptr<Vehicle>> vehicle_by_id_;
   std::weak_ptr<Simulator> simulator_;
+  RunTimeModel run_time_model_;
+  SimulationParameters parameters_;
+  DisruptionSchedule disruptions_;
+  /** \brief The indices in trains_ of the trains on every route that has a
+   * closure, built when the disruptions are loaded. */
+  std::unordered_map<std::uint64_t, std::vector<std::size_t>>
+      trains_by_route_;
+  /** \brief The lifecycle events of the trains in trains_by_route_, with
+   * the same index as in trains_. The others are null. */
+  std::vector<std::shared_ptr<Event>> lifecycles_;
+  /** \brief Where the vehicles of the run came from, recorded by
+   * TryAssemble and DisAssemble. */
+  VehicleFlowGraph vehicle_flow_;
+  /** \brief The causes of the waits for vehicles, recorded by AddWait. */
+  DelayAttribution delay_attribution_;
+  /** \brief The trains arriving at each station in the order of the time
+   * table, and the first of them that is not finished yet as far as AddWait
+   * has looked. */
+  std::vector<std::vector<std::size_t>> arriving_;
+  std::vector<std::size_t> first_unfinished_;
+  /** \brief Only read and replaced with std::atomic_load and
+   * std::atomic_store. These are not lock free for a shared_ptr: libstdc++
+   * guards them with a mutex from a small global pool, held only while the
+   * pointer is copied. The trains of the snapshot have the same index as in
+   * trains_. published_snapshot_ is the same snapshot as snapshot_ and
+   * retired_snapshot_ the one before it. The retired snapshot is filled
+   * again by the next PublishSnapshot if no reader holds it any more. */
+  std::shared_ptr<const SimulationSnapshot> snapshot_;
+  std::shared_ptr<SimulationSnapshot> published_snapshot_;
+  std::shared_ptr<SimulationSnapshot> retired_snapshot_;
   bool high_log_level_vehicle_;
   bool high_log_level_station_;
   bool high_log_level_train_;
@@ -36,44 +123,121 @@ class TrainStationManager
   /** \brief List of stations and how many vehicles i holds before the
    * simulation
    */
-  std::list<std::pair<std::shared_ptr<Station>, int>>
+  std::vector<std::pair<std::shared_ptr<Station>, int>>
       vehicle_distribution_start;
 
-  /** \brief Loads station-/train-/distances- list with data from file specified
-   * in the path parameter.. This function throws exception if file is not
-   * found. The catch for this excepting is in the main.cpp file. */
-  void loadStations(const std::string &path);
-  void loadTrains(const std::string &path);
-  void loadMap(const std::string &path);
+  /** \brief Fills the station-/train-/distances- list with the records read
+   * by the DataLoader. The DataLoader throws exception if a file is not found
+   * or not valid. The catch for this excepting is in the main.cpp file. */
+  void addStations(const std::vector<StationRecord> &records);
+  void addTrains(const std::vector<TrainRecord> &records);
+  void addDistances(const std::vector<DistanceRecord> &records);
 
   /** This function is populating the event queue with events. This is
-   * basically the time table - 30 min. */
+   * basically the time table - 30 min, see SimulationParameters, and the
+   * start of every disruption. */
   void loadEvents();
   void setVehicleDistributionFromStart();
 
+  /** Calculates the running time of every train, see RunTimeModel. */
+  void setRunTimes();
+
+  /** Extends the simulation stop time so that time tables spanning several
+   * days are simulated to the end. */
+  void setSimulationHorizon();
+  /** The stop time that lets a train arriving at last_arrival finish. */
+  static SimTime stopTimeFor(SimTime last_arrival);
+
+  /** The key of the route between two stations in either direction. */
+  static std::uint64_t routeKey(int station_1, int station_2);
+  static std::uint64_t routeKey(const Train &train);
+
+  /** Moves a committed train off a closure, see ApplyDisruption. Returns
+   * false if the train is not affected. */
+  bool replan(std::size_t index, const Disruption &closure);
+  /** Fills trains_by_route_ for the routes with a closure. */
+  void indexClosedRoutes();
+  std::size_t trainIndex(const Train &train) const;
+  /** Writes what the cause is, e.g. "train 17 was late". */
+  void appendDelayCause(TextBuffer &out,  // NOLINT
+                        const DelayCause &cause) const;
+  /** Fills arriving_ and first_unfinished_. */
+  void indexArrivals();
+  /** The late train that would have brought a vehicle of vehicle_type to
+   * station before time, or a shortage at the station. */
+  DelayCause findLateSupplier(int station, int vehicle_type, SimTime time,
+                              std::size_t waiting_train,
+                              SimTime &lateness_out);  // NOLINT
+
+  /** Builds a train with the train line of trains_[index] and the state it
+   * had in the snapshot. */
+  Train snapshotTrain(const SimulationSnapshot &snapshot,
+                      std::size_t index) const;
+
+  /** Looks up a vehicle by id. If location is not null, the station pools
+   * and trains of the snapshot are searched for where the vehicle is. */
+  bool findVehicle(int id, std::shared_ptr<Vehicle> &vehicle_out,  // NOLINT
+                   std::string *location);
+  void appendLifeCycleEvent(TextBuffer &out,  // NOLINT
+                            const State &state, bool high_detail_level);
+
  public:
   TrainStationManager(std::shared_ptr<Simulator> simulator,
                       const std::string &station_path,
                       const std::string &trains_path,
                       const std::string &map_path);
+  /** \brief The scenario of a what-if. It has the stations, distances,
+   * running times and disruptions of base, empty pools and a copy of the
+   * trains of base with the given indices, moved by the edits. The pools
+   * are filled by WhatIf. */
+  TrainStationManager(std::shared_ptr<Simulator> simulator,
+                      const TrainStationManager &base,
+                      const std::vector<std::size_t> &trains,
+                      const std::vector<DepartureEdit> &edits);
   ~TrainStationManager() {}
 
+  /** \brief Reads a disruptions file, see DataLoader::LoadDisruptions, and
+   * checks it against the stations and distances. Called before Setup.
+   * Throws exception with the file and line of every problem. */
+  void LoadDisruptions(const std::string &path);
+
+  /** \brief The timing of the lifecycle of the trains, read by the events.
+   * Set before Setup. */
+  const SimulationParameters &GetParameters() const { return parameters_; }
+  void SetParameters(const SimulationParameters &parameters);
+
   /** \brief This function is called after instansiation of this
    * TrainStationManager-object. This is because the funcion uses
    * share_from_this() to pass an instace of itself along to the events. And
    * this can not be made before instansiation is completed. */
-  void Setup() { loadEvents(); }
+  void Setup();
+
+  /** \brief Copies the state of the trains, the station pools and the
+   * delays to a snapshot and makes it the one GetSnapshot returns. Called by
+   * the thread that runs the simulation, between events. */
+  void PublishSnapshot();
+  /** \brief The last published snapshot. The reader takes a short lock to
+   * copy the pointer, but never waits for a PublishSnapshot to fill one,
+   * and keeps the snapshot for as long as it holds the pointer. */
+  std::shared_ptr<const SimulationSnapshot> GetSnapshot() const;
 
   std::string SeeTimeTable();
 
-  /** \brief 30 min before planed departure this function is called.
+  /** \brief 30 min before planed departure this function is called, see
+   * SimulationParameters.
    * The function try to connect all demanded vehicles to the train using
    * the vehicle pool available on the station. */
-  bool TryAssemble(int id);
+  bool TryAssemble(Train &train, SimTime time);  // NOLINT
   /** \brief After arrival this function is called.
    * The function disconnect all vehicles and return them to the station
    * vehicle pool.. */
-  void DisAssemble(int id);
+  void DisAssemble(Train &train, SimTime time);  // NOLINT
+  /** \brief Adds a vehicle to the pool of a station, given as name id. */
+  void ReturnVehicle(int station, int vehicle_id);
+  /** \brief Called when TryAssemble failed and delayed the train seconds.
+   * Records the missing vehicle types and what caused each of them to be
+   * missing, see DelayAttribution. */
+  void AddWait(const Train &train, SimTime time, SimTime seconds);
 
   /** \brief These funcions returns a station-/train-pointer. If name is spelled
    * wrong or if station/train do not exist it throws exception and depending on
@@ -81,11 +245,43 @@ class TrainStationManager
    * calling function or by the main.cpp. */
   std::shared_ptr<Station> GetStationByName(const std::string &name);
   std::shared_ptr<Train> GetTrainByTrainNumber(int number);
-  std::string GetTrainDetailsByTrainNumber(int train_number);
-  std::string GetTrainDetailsByVehicleId(int vehicle_id);
+  std::string GetTrainDetailsByTrainNumber(int train_number,
+                                           bool high_detail_level);
+  std::string GetTrainDetailsByVehicleId(int vehicle_id,
+                                         bool high_detail_level);
+
+  /** \brief Returns the distance between to stations, given as name ids. */
+  int GetDistanceFrom(int station_1, int station_2) const;
 
-  /** \brief Returns the distance between to stations. */
-  int GetDistanceFrom(const std::string &station1, const std::string &station2);
+  const StringTable &GetStationNames() const { return station_names_; }
+
+  /** \brief Returns the distance in meters and the shortest running time of
+   * the train, calculated when the time table was loaded. */
+  const RunTime &GetRunTime(const Train &train) const;
+
+  /** \brief Sets run_time_s_out to the shortest running time of the train
+   * if it departs at departure under a speed limit lower than its own.
+   * Returns false if the route has no such limit at that time. */
+  bool GetRestrictedRunTime(const Train &train, SimTime departure,
+                            int &run_time_s_out);  // NOLINT
+  /** \brief The first time at or after departure the train can leave on
+   * its route, which is departure unless a closure that has started by now
+   * closes the route. */
+  SimTime HoldDeparture(const Train &train, SimTime departure,
+                        SimTime now) const;
+  /** \brief The expected arrival of the train if it departs at departure.
+   * It keeps the planned duration unless the train can not run that fast,
+   * like the arrival of an incomplete train. A speed limit is added when
+   * the train departs. */
+  SimTime PlanArrival(const Train &train, SimTime departure) const;
+  /** \brief Run by DisruptionStart when a disruption starts. A closure
+   * re-plans the trains on the route that already are ready or running: a
+   * ready train that would depart while the route is closed is held until
+   * it opens, and a running train is delayed by the length of the closure.
+   * Only the trains of the route are looked at. Trains that get ready
+   * later, and the other disruptions, are found by the checks of the
+   * TrainLifecycle. */
+  void ApplyDisruption(std::size_t index, SimTime time);
 
   bool IsHighLogLevelTrain() const;
   void SetHighLogLevelTrain(bool high_log_level_train);
@@ -103,13 +299,57 @@ class TrainStationManager
   std::string GetTrainsStuckAtStation();
   std::string GetTrainsThatArrivedInTime();
   std::string GetDelayedTrains();
+  /** \brief The number of trains GetTrainsStuckAtStation and
+   * GetTrainsThatArrivedInTime list. */
+  int CountTrainsStuckAtStation() const;
+  int CountTrainsThatArrivedInTime() const;
+  std::size_t GetNumberOfTrains() const { return trains_.size(); }
+  /** \brief The trains in the order of the time table. Only read while
+   * the simulation does not run. */
+  const std::vector<std::shared_ptr<Train>> &GetTrains() const {
+    return trains_;
+  }
+  /** \brief The lifecycle is read from the event log, which is changed by
+   * every event, so these are only called by the thread that runs the
+   * simulation or while it does not run. */
   bool GetTrainLifeCycleByTrainNumber(int train_number,
+                                      bool high_detail_level,
                                       std::string &details_out);  // NOLINT
-  bool GetTrainLifeCycleByVehicleId(int vehicle_id,
+  bool GetTrainLifeCycleByVehicleId(int vehicle_id, bool high_detail_level,
                                     std::string &details_out);  // NOLINT
 
   std::string GetStationDetails(const std::string &name,
                                 bool high_detail_level);
+
+  /** \brief Lists the trains the vehicles of the train came from and the
+   * trains that got its vehicles after it, see VehicleFlowGraph. */
+  bool GetVehicleFlowByTrainNumber(int train_number,
+                                   std::string &details_out);  // NOLINT
+
+  /** \brief The root causes of the waits for vehicles, the largest first,
+   * see DelayAttribution. */
+  std::string GetDelayRootCauses();
+
+  /** \brief Runs the simulation again with the edits, starting from the
+   * finished run. Only the trains in the cone of the edits are simulated,
+   * see VehicleFlowGraph::Cone. Their stations start with the pools the
+   * record has at the time the cone reaches them, and the vehicles the
+   * other trains returned after that are returned by VehicleReturn events.
+   * The result of every other train is the one of the finished run. If an
+   * edited train arrives after the stop time the run is extended, as the
+   * time table would extend it, and the unfinished trains run again too.
+   *
+   * Returns the trains that got another result and the total delay before
+   * and after. Throws exception if a train does not exist. Only called
+   * when the simulation is done. */
+  std::string WhatIf(const std::vector<DepartureEdit> &edits);
+  /** \brief The run of WhatIf with the total delay after it. The cost of
+   * the run is the total delay plus not_arrived_penalty for every train
+   * that has not arrived at the stop time, stuck or not, and the run is
+   * stopped once the cost is above cost_limit. The finished run is only
+   * read, so several of these can run at the same time. */
+  WhatIfRun RunWhatIf(const std::vector<DepartureEdit> &edits,
+                      SimTime not_arrived_penalty, SimTime cost_limit) const;
 };
 
 #endif  // PROJECT_INCLUDE_T_S_MANAGER_H_
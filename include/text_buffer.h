@@ -0,0 +1,103 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_TEXT_BUFFER_H_
+#define PROJECT_INCLUDE_TEXT_BUFFER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "train_time.h"  //NOLINT
+
+/** \brief A reusable text buffer used instead of std::ostringstream.
+ * Everything is appended to the end of the buffer. Clear() keeps the
+ * allocated memory, so a buffer that is reused for every log line only
+ * allocates until it has grown to the longest line.
+ */
+class TextBuffer {
+  std::string data_;
+
+ public:
+  explicit TextBuffer(std::size_t capacity = 256) { data_.reserve(capacity); }
+  ~TextBuffer() {}
+
+  void Clear() { data_.clear(); }
+  bool Empty() const { return data_.empty(); }
+  std::size_t Size() const { return data_.size(); }
+  const char *Data() const { return data_.data(); }
+  const std::string &Str() const { return data_; }
+
+  TextBuffer &Append(const char *text, std::size_t length) {
+    data_.append(text, length);
+    return *this;
+  }
+
+  /** \brief Overwrites length characters from position pos. Used for
+   * filling in a length field when the rest of a record is written. */
+  void Replace(std::size_t pos, const char *text, std::size_t length) {
+    data_.replace(pos, length, text, length);
+  }
+
+  TextBuffer &operator<<(const char *text) {
+    data_.append(text);
+    return *this;
+  }
+
+  TextBuffer &operator<<(const std::string &text) {
+    data_.append(text);
+    return *this;
+  }
+
+  TextBuffer &operator<<(char c) {
+    data_.push_back(c);
+    return *this;
+  }
+
+  TextBuffer &operator<<(int value) { return AppendInt(value); }
+  TextBuffer &operator<<(long value) { return AppendInt(value); }  // NOLINT
+  TextBuffer &operator<<(long long value) {  // NOLINT
+    return AppendInt(value);
+  }
+
+  TextBuffer &AppendInt(long long value) {  // NOLINT
+    char digits[24];
+    int count = 0;
+    unsigned long long magnitude =  // NOLINT
+        value < 0 ? 0ULL - static_cast<unsigned long long>(value)  // NOLINT
+                  : static_cast<unsigned long long>(value);        // NOLINT
+    do {
+      digits[count++] = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) data_.push_back('-');
+    while (count > 0) data_.push_back(digits[--count]);
+    return *this;
+  }
+
+  /** \brief Appends a simulation time as "hh:mm" or "d+hh:mm". */
+  TextBuffer &AppendTime(SimTime time_stamp) {
+    char buffer[32];
+    data_.append(buffer, TrainTime::FormatSimTime(time_stamp, buffer));
+    return *this;
+  }
+
+  /** \brief Appends a duration in seconds as "hh:mm". */
+  TextBuffer &AppendDuration(int seconds) {
+    char buffer[32];
+    data_.append(buffer, TrainTime::FormatDuration(seconds, buffer));
+    return *this;
+  }
+
+  /** \brief Pads with spaces until the field that started at position start
+   * is at least width characters wide. Same as std::left and std::setw. */
+  TextBuffer &PadFrom(std::size_t start, std::size_t width) {
+    if (data_.size() < start + width) {
+      data_.append(start + width - data_.size(), ' ');
+    }
+    return *this;
+  }
+};
+
+#endif  // PROJECT_INCLUDE_TEXT_BUFFER_H_
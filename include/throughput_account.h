@@ -0,0 +1,57 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_THROUGHPUT_ACCOUNT_H_
+#define PROJECT_INCLUDE_THROUGHPUT_ACCOUNT_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+class StringTable;
+class Train;
+
+/** \brief Capacity moved a distance: seats, beds, tons of open car capacity
+ * and cubic meters of covered car capacity times kilometers. */
+struct Throughput {
+  double seat_km;
+  double bed_km;
+  double ton_km;
+  double cubic_meter_km;
+};
+
+/** \brief This class sums the capacity the trains deliver.
+ * The capacity of a train is read from its Consist, which is kept up to date
+ * when the train is assembled, so a trip does not go through the Vehicle
+ * objects.
+ *
+ * The throughput is summed per train and per corridor when the train
+ * arrives. A corridor is the two stations of a line in either direction,
+ * kept as the name ids of the stations with the lower id first.
+ */
+class ThroughputAccount {
+  Throughput total_;
+  std::map<int, Throughput> per_train_;
+  std::map<std::pair<int, int>, Throughput> per_corridor_;
+
+ public:
+  ThroughputAccount();
+  ~ThroughputAccount() {}
+
+  void AddTrip(const Train &train, int distance_m);
+
+  const Throughput &GetTotal() const { return total_; }
+  /** \brief Returns false if the train has not arrived yet. */
+  bool GetTrainThroughput(int train_number,
+                          Throughput &throughput_out) const;  // NOLINT
+
+  /** \brief The network totals and the throughput per corridor. With high
+   * detail level also per train. The station names are looked up in
+   * station_names. */
+  std::string GetReport(const StringTable &station_names,
+                        bool high_detail_level) const;
+};
+
+#endif  // PROJECT_INCLUDE_THROUGHPUT_ACCOUNT_H_
@@ -0,0 +1,67 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_TIMER_WHEEL_H_
+#define PROJECT_INCLUDE_TIMER_WHEEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** \brief A hierarchical timer wheel with four levels of 64 slots.
+ * Time is counted in ticks. A timer is kept on the lowest level where its
+ * expiry and the current tick only differ in the bits of that level, so
+ * level 0 holds the next 64 ticks, level 1 the next 4096 and so on. When the
+ * wheel reaches the start of a slot on a higher level, the timers of that
+ * slot are moved down. Timers further away than 2^24 ticks wait in an
+ * overflow list that is looked at every 2^24 ticks.
+ *
+ * Scheduling is constant time. Advance skips empty slots with one bit mask
+ * per level, so a long wait costs a few steps and not one per tick.
+ */
+class TimerWheel {
+  static const int kLevels = 4;
+  static const int kSlotBits = 6;
+  static const int kSlots = 1 << kSlotBits;
+
+  struct Timer {
+    int id;
+    std::uint64_t expiry;
+  };
+
+  std::vector<Timer> slots_[kLevels][kSlots];
+  /** \brief Bit n is set when slot n of the level has timers. */
+  std::uint64_t occupied_[kLevels];
+  std::vector<Timer> overflow_;
+  /** \brief Timers that expire at or before now_. */
+  std::vector<Timer> due_;
+  std::vector<Timer> moving_;
+  std::uint64_t now_;
+  std::size_t size_;
+
+  void insert(const Timer &timer);
+  void cascade(int level);
+
+ public:
+  explicit TimerWheel(std::uint64_t now = 0);
+  ~TimerWheel() {}
+
+  /** \brief The timer expires at tick, or at the next Advance if tick has
+   * passed. The same id may be scheduled more than once. */
+  void Schedule(int id, std::uint64_t tick);
+  bool Empty() const { return size_ == 0; }
+  std::uint64_t GetNow() const { return now_; }
+
+  /** \brief The earliest tick a timer can expire at. Exact for the next 64
+   * ticks, otherwise the start of the first slot with timers, where Advance
+   * moves them down. UINT64_MAX if the wheel is empty. */
+  std::uint64_t NextExpiry() const;
+
+  /** \brief Moves the wheel to tick and appends the ids of the timers that
+   * expired, in the order of their expiry. */
+  void Advance(std::uint64_t tick, std::vector<int> &expired_out);  // NOLINT
+};
+
+#endif  // PROJECT_INCLUDE_TIMER_WHEEL_H_
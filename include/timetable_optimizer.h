@@ -0,0 +1,84 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_TIMETABLE_OPTIMIZER_H_
+#define PROJECT_INCLUDE_TIMETABLE_OPTIMIZER_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "t_s_manager.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
+/** \brief Searches for departure times that give a lower total delay.
+ *
+ * A candidate time table moves some trains at most the window from the
+ * time table, in whole steps. Its cost is the total delay plus a penalty
+ * for every train that did not arrive, whether it was stuck at a station
+ * or moved past the end of the run. A candidate is evaluated with
+ * TrainStationManager::RunWhatIf on the finished run, so only the trains
+ * the moves can reach are simulated.
+ *
+ * The search is a local search from the time table: every round moves one
+ * train of the best candidate so far in a number of ways, evaluates them on
+ * a pool of threads and keeps the best if it is better. A run is stopped as
+ * soon as it is known to cost more than the best candidate, see RunWhatIf.
+ * The costs are cached by candidate, so a candidate that comes up again is
+ * not run again.
+ */
+class TimetableOptimizer {
+  /** \brief The departure of every moved train, by train number. */
+  typedef std::map<int, SimTime> Candidate;
+  /** \brief complete is false if the run was stopped, then cost is only
+   * known to be above the cost of the best candidate at the time. */
+  struct Evaluation {
+    SimTime cost;
+    bool complete;
+  };
+
+  std::shared_ptr<TrainStationManager> base_;
+  SimTime window_s_;
+  std::size_t jobs_;
+  std::vector<int> train_numbers_;
+  std::vector<SimTime> departures_;
+  std::map<Candidate, Evaluation> cache_;
+  std::mt19937 random_;
+  int runs_;
+  int stopped_runs_;
+  int cache_hits_;
+
+  static std::vector<DepartureEdit> toEdits(const Candidate &candidate);
+  /** \brief The best candidate moved by one train, or nothing if the move
+   * gives the best candidate again. */
+  bool neighbour(const Candidate &best, Candidate &candidate_out);  // NOLINT
+  /** \brief Runs the candidates that are not cached yet on jobs_ threads
+   * and caches them. Runs above cost_limit are stopped. */
+  void evaluate(const std::vector<Candidate> &candidates, SimTime cost_limit);
+
+ public:
+  /** \brief The cost of a train that did not arrive, which adds no
+   * delay. */
+  static const SimTime kStuckPenalty;
+  /** \brief The departures are moved in steps of this. */
+  static const SimTime kStep;
+  /** \brief How many ways the best candidate is moved every round. */
+  static const int kCandidatesPerRound;
+
+  /** \brief base is a finished run. The trains move at most window_s from
+   * the time table. jobs is the number of threads, 0 for one per core. */
+  TimetableOptimizer(std::shared_ptr<TrainStationManager> base,
+                     SimTime window_s, std::size_t jobs, unsigned seed);
+  ~TimetableOptimizer() {}
+
+  /** \brief Runs rounds rounds and returns the moves of the best candidate
+   * found, how it was found and the report of WhatIf for it. */
+  std::string Optimize(int rounds);
+};
+
+#endif  // PROJECT_INCLUDE_TIMETABLE_OPTIMIZER_H_
@@ -6,17 +6,21 @@
 #ifndef PROJECT_INCLUDE_TRAIN_H_
 #define PROJECT_INCLUDE_TRAIN_H_
 
+#include <cstddef>
 #include <iosfwd>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "string_table.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+
 class Station;
 class Station;
 class App;
 class Vehicle;
 class Event;
+class TextBuffer;
 
 /** \brief This is an enum class used for train status.
  */
@@ -30,41 +34,75 @@ enum class TrainStatus {
   FINISHED
 };
 
+const char *TrainStatusName(TrainStatus train_status);
 std::ostream &operator<<(std::ostream &os, const TrainStatus &train_status);
 
 /** \brief This class holds static information of each train line.
  * All class members are set from the constructor and accesseble through
- * getters.
+ * getters. The stations are held as ids in the StringTable of station names,
+ * the names are only looked up when they are written out.
  */
 class TrainLine {
   const int id_;
-  std::string departure_station_;
-  std::string arrival_station_;
-  const time_t departure_time_;
-  const time_t arrival_time_;
+  int departure_station_;
+  int arrival_station_;
+  const StringTable *station_names_;
+  const SimTime departure_time_;
+  const SimTime arrival_time_;
   const std::vector<int> demanded_vehicles_;
   const int max_speed_;
 
  public:
   TrainLine(int max_speed, int id, const std::vector<int> &demanded_vehicles,
-            std::string departure_station, std::string arrival_station,
-            time_t departure_time, time_t arrival_time)
+            int departure_station, int arrival_station,
+            SimTime departure_time, SimTime arrival_time,
+            const StringTable *station_names)
       : max_speed_(max_speed),
         id_(id),
         demanded_vehicles_(demanded_vehicles),
         departure_station_(departure_station),
         arrival_station_(arrival_station),
+        station_names_(station_names),
         departure_time_(departure_time),
         arrival_time_(arrival_time) {}
   ~TrainLine() {}
 
   int GetTrainNumber() const { return id_; }
   int GetMaxSpeed() const { return max_speed_; }
-  std::vector<int> GetDemandedVehicles() const { return demanded_vehicles_; }
-  std::string GetDepartureStation() { return departure_station_; }
-  std::string GetArrivalStation() { return arrival_station_; }
-  time_t GetDepartureTime() const { return departure_time_; }
-  time_t GetArrivalTime() const { return arrival_time_; }
+  const std::vector<int> &GetDemandedVehicles() const {
+    return demanded_vehicles_;
+  }
+  int GetDepartureStationId() const { return departure_station_; }
+  int GetArrivalStationId() const { return arrival_station_; }
+  const std::string &GetDepartureStation() const {
+    return station_names_->Get(departure_station_);
+  }
+  const std::string &GetArrivalStation() const {
+    return station_names_->Get(arrival_station_);
+  }
+  SimTime GetDepartureTime() const { return departure_time_; }
+  SimTime GetArrivalTime() const { return arrival_time_; }
+};
+
+/** \brief Attributes of the vehicles connected to a train.
+ * They are updated when a vehicle is added or removed, so the events and the
+ * accounts read them without going through the vehicles.
+ */
+struct Consist {
+  static const int kNumberOfTypes = 6;
+
+  /** \brief The lowest max speed of the locomotives, -1 without locomotive. */
+  int min_locomotive_speed = -1;
+  int vehicles_per_type[kNumberOfTypes] = {};
+  /** \brief The ids of the vehicles in the order they were connected. */
+  std::vector<int> vehicle_ids;
+  int seats = 0;
+  int beds = 0;
+  int ton_capacity = 0;
+  int cubic_meter_capacity = 0;
+  /** \brief Mass and power, see RunTimeModel. */
+  double mass_tons = 0.0;
+  double power_kw = 0.0;
 };
 
 /** \brief This class represents a specific train and holds an instance of
@@ -76,45 +114,55 @@ class Train {
   TrainLine train_line_;
   TrainStatus train_status_;
   std::vector<int> demanded_vehicles_;
-  std::list<std::shared_ptr<Vehicle>> vehicles_;
-  time_t planed_departure_time_;
-  time_t expected_arrival_time_;
+  std::vector<std::shared_ptr<Vehicle>> vehicles_;
+  Consist consist_;
+  SimTime planed_departure_time_;
+  SimTime expected_arrival_time_;
+  std::size_t run_time_index_;
+  SimTime last_event_time_;
 
  public:
   explicit Train(const TrainLine &train_template)
       : train_line_(train_template),
         train_status_(TrainStatus::NOT_ASSEMBLED),
         vehicles_(0),
+        run_time_index_(0),
         planed_departure_time_(train_template.GetDepartureTime()),
         expected_arrival_time_(train_line_.GetArrivalTime()),
-        demanded_vehicles_(train_template.GetDemandedVehicles()) {}
+        demanded_vehicles_(train_template.GetDemandedVehicles()),
+        last_event_time_(-1) {}
   ~Train() {}
 
+  const TrainLine &GetTrainLine() const { return train_line_; }
   int GetTrainNumber() const { return train_line_.GetTrainNumber(); }
   TrainStatus GetTrainStatus() const { return train_status_; }
   void SetTrainStatus(TrainStatus train_status) {
     train_status_ = train_status;
   }
 
-  std::string GetDepartureStation() {
+  const std::string &GetDepartureStation() const {
     return train_line_.GetDepartureStation();
   }
-  std::string GetArrivalStation() { return train_line_.GetArrivalStation(); }
+  const std::string &GetArrivalStation() const {
+    return train_line_.GetArrivalStation();
+  }
 
-  time_t GetOriginalDepartureTime() const {
+  SimTime GetOriginalDepartureTime() const {
     return train_line_.GetDepartureTime();
   }
-  time_t GetOriginalArrivalTime() const { return train_line_.GetArrivalTime(); }
+  SimTime GetOriginalArrivalTime() const {
+    return train_line_.GetArrivalTime();
+  }
 
   /** \brief This function returns expected time of departure. This returns
    * the actual time of departure when all vehiclas are connected successfully.
    */
-  time_t GetPlanedDepartureTime() const { return planed_departure_time_; }
+  SimTime GetPlanedDepartureTime() const { return planed_departure_time_; }
 
   /** \brief This function returns the expected time of arrival. */
-  time_t GetExpectedArrivalTime() const { return expected_arrival_time_; }
+  SimTime GetExpectedArrivalTime() const { return expected_arrival_time_; }
 
-  void SetPlanedDepartureTime(time_t planed_departure_time) {
+  void SetPlanedDepartureTime(SimTime planed_departure_time) {
     planed_departure_time_ = planed_departure_time;
   }
 
@@ -122,7 +170,7 @@ class Train {
    * This function is awoken from within Event-class when the time of arrival
    * has been calcualted if train is delayed from station.
    */
-  void SetExpectedArrivalTime(time_t expected_arrival_time) {
+  void SetExpectedArrivalTime(SimTime expected_arrival_time) {
     expected_arrival_time_ = expected_arrival_time;
   }
 
@@ -130,33 +178,69 @@ class Train {
   int GetTrainMaxSpeed() { return train_line_.GetMaxSpeed(); }
 
   /** \brief Returns the max speed a specific vehicle combination can handle. */
-  int GetVehicleMaxSpeed();
+  int GetVehicleMaxSpeed() const { return consist_.min_locomotive_speed; }
 
-  /** \brief This function returns a list of which vehicle types that is needed
-   * for becoming complete.
-   */
-  std::string ListDemandedVehicles();
-  /** \brief This function returns a list of which vehicle types that was needed
-   * for becoming complete, at a specific time in history.
-   */
-  static std::string ListDemandedVehiclesFromState(
-      std::vector<int> demanded_vehicles);
-  std::string ListConnectedVehicles();
+  /** \brief Ids of the departure and arrival stations in the StringTable of
+   * station names. */
+  int GetDepartureStationId() const {
+    return train_line_.GetDepartureStationId();
+  }
+  int GetArrivalStationId() const { return train_line_.GetArrivalStationId(); }
+
+  /** \brief Index of the running time of this train in the RunTimeModel. It
+   * is set when the time table is loaded. */
+  std::size_t GetRunTimeIndex() const { return run_time_index_; }
+  void SetRunTimeIndex(std::size_t run_time_index) {
+    run_time_index_ = run_time_index;
+  }
+
+  /** \brief The time of the last event of the train before the stop time
+   * that the Simulator took from its queue, whether it was run or not. -1
+   * before the first. */
+  SimTime GetLastEventTime() const { return last_event_time_; }
+  void SetLastEventTime(SimTime time) { last_event_time_ = time; }
 
-  std::string GetTimeTableData();
-  std::string GetDataToLog(bool high_log_level);
-  std::string GetDataToLogLow();
-  std::string GetTrainDetails(bool high_detail);
+  /** \brief These functions append the text used in the time table, the log
+   * and the menus to out. Nothing is allocated once out has grown large
+   * enough, so the same buffer can be reused for every line.
+   */
+  void AppendTimeTableData(TextBuffer &out) const;                    // NOLINT
+  void AppendDataToLog(TextBuffer &out, bool high_log_level) const;  // NOLINT
+  void AppendDataToLogLow(TextBuffer &out) const;                     // NOLINT
+  /** \brief Same as above but with the state saved at a specific time in
+   * history. */
+  void AppendDataToLogLow(TextBuffer &out,  // NOLINT
+                          SimTime planed_departure_time,
+                          SimTime expected_arrival_time,
+                          TrainStatus train_status) const;
+  void AppendTrainDetails(TextBuffer &out, bool high_detail) const;  // NOLINT
+  void AppendConnectedVehicles(TextBuffer &out) const;               // NOLINT
+  /** \brief Appends a list of which vehicle types that is needed for
+   * becoming complete. */
+  static void AppendDemandedVehicles(const std::vector<int> &demanded_vehicles,
+                                     TextBuffer &out);  // NOLINT
+  std::string GetTrainDetails(bool high_detail) const;
 
-  /** \brief This funcion is used when assembling a train */
+  /** \brief This funcion is used when assembling a train. It adds the
+   * vehicle to the Consist. */
   void AddVehicle(std::shared_ptr<Vehicle> &vehicle);  // NOLINT
 
-  /** \brief This funcion is used when dissassembling a train */
+  /** \brief This funcion is used when dissassembling a train. It removes the
+   * first connected vehicle from the Consist. */
   bool PopVehicle(std::shared_ptr<Vehicle> &vehicle_out);  // NOLINT
 
   bool GetVehicleById(int id, std::shared_ptr<Vehicle> &out_vehicle);  // NOLINT
   std::vector<int> &GetDemandedVehicles() { return demanded_vehicles_; }
-  std::vector<int> GetConnectedVehicles();
+  const std::vector<int> &GetDemandedVehicles() const {
+    return demanded_vehicles_;
+  }
+  const std::vector<int> &GetConnectedVehicles() const {
+    return consist_.vehicle_ids;
+  }
+  const Consist &GetConsist() const { return consist_; }
+  const std::vector<std::shared_ptr<Vehicle>> &GetVehicles() const {
+    return vehicles_;
+  }
 
   std::string GetLocation();
 };
@@ -170,6 +254,9 @@ class SortOnDepartureTime {
     return first.lock()->GetPlanedDepartureTime() >
            second.lock()->GetPlanedDepartureTime();
   }
+  bool operator()(const Train *first, const Train *second) {
+    return first->GetPlanedDepartureTime() > second->GetPlanedDepartureTime();
+  }
 };
 
 #endif  // PROJECT_INCLUDE_TRAIN_H_
@@ -8,24 +8,23 @@
 
 #include <iosfwd>
 #include <memory>
-#include <string>
 #include <vector>
 
-/** \brief This class holds two train stations and the distance between them. 
+/** \brief This class holds two train stations and the distance between them.
+ * The stations are ids in the StringTable of station names.
  */
 class Distance {
  private:
-  std::string station_1_;
-  std::string station_2_;
+  int station_1_;
+  int station_2_;
   int distance_;
 
  public:
-  Distance(const std::string &station_1, const std::string &station_2,
-           int distance)
+  Distance(int station_1, int station_2, int distance)
       : station_1_(station_1), station_2_(station_2), distance_(distance) {}
   virtual ~Distance() {}
-  std::string GetStation1() { return station_1_; }
-  std::string GetStation2() { return station_2_; }
+  int GetStation1() const { return station_1_; }
+  int GetStation2() const { return station_2_; }
   int GetDistance() const { return distance_; }
   void SetDistance(int distance) { Distance::distance_ = distance; }
 };
@@ -6,41 +6,122 @@
 #ifndef PROJECT_INCLUDE_TRAIN_TIME_H_
 #define PROJECT_INCLUDE_TRAIN_TIME_H_
 
-#include <math.h>
-
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <cstdint>
 #include <string>
 
+/** \brief The simulation clock. Whole seconds since the scenario epoch, which
+ * is 00:00 on the first day of the time table. It does not depend on the wall
+ * clock or the time zone so the same input always gives the same output.
+ */
+typedef std::int64_t SimTime;
+
 /** \brief This is a class for converting time format to readable string.
 * The constructor is private so it can not be instantiated normal way.
+* Times on the first day are written as "hh:mm", later days are written with
+* the day index in front, "d+hh:mm".
 */
 class TrainTime {
  public:
-  static std::string Time_tToString(time_t time_stamp) {
-    time_t t = time_stamp + (60 * 60);  // Daylight saving hack
-    std::tm t_struct{};
-    gmtime_r(&t,&t_struct);
-    std::ostringstream oss;
-    oss << std::setw(2) << std::setfill('0') << t_struct.tm_hour << ":"
-        << std::setw(2) << std::setfill('0') << t_struct.tm_min;
-    return oss.str();
+  static const SimTime kSecondsPerDay = 24 * 60 * 60;
+
+  static std::string SimTimeToString(SimTime time_stamp) {
+    char buffer[32];
+    return std::string(buffer, FormatSimTime(time_stamp, buffer));
   }
+
   static std::string SecondsToPretty(int seconds) {
-    int sec = seconds % 60;
+    char buffer[32];
+    return std::string(buffer, FormatDuration(seconds, buffer));
+  }
+
+  /** \brief Writes a duration in seconds as "hh:mm" to buffer, which must hold
+   * at least 32 characters, and returns the number of characters written. */
+  static int FormatDuration(int seconds, char *buffer) {
+    int length = 0;
+    if (seconds < 0) {
+      buffer[length++] = '-';
+      seconds = -seconds;
+    }
     int min = (seconds / 60) % 60;
     int hour = seconds / 3600;
-    std::ostringstream oss;
-    oss << std::setw((static_cast<int>(log10(hour)) + 1 < 2)
-                         ? 2
-                         : static_cast<int>(log10(hour)) + 1)
-        << std::setfill('0') << hour << ":" << std::setw(2) << std::setfill('0')
-        << min;
-    return oss.str();
+    length += formatInt(hour, 2, buffer + length);
+    buffer[length++] = ':';
+    length += formatInt(min, 2, buffer + length);
+    return length;
+  }
+
+  /** \brief Writes the time stamp to buffer, which must hold at least 32
+   * characters, and returns the number of characters written. */
+  static int FormatSimTime(SimTime time_stamp, char *buffer) {
+    SimTime day = time_stamp / kSecondsPerDay;
+    SimTime second_of_day = time_stamp % kSecondsPerDay;
+    if (second_of_day < 0) {
+      second_of_day += kSecondsPerDay;
+      day--;
+    }
+    int length = 0;
+    if (day != 0) {
+      if (day < 0) {
+        buffer[length++] = '-';
+        day = -day;
+      }
+      length += formatInt(day, 1, buffer + length);
+      buffer[length++] = '+';
+    }
+    length += formatInt(second_of_day / 3600, 2, buffer + length);
+    buffer[length++] = ':';
+    length += formatInt((second_of_day / 60) % 60, 2, buffer + length);
+    return length;
+  }
+
+  /** \brief Parses "hh:mm" or "d+hh:mm" into a simulation time. Returns false
+   * if the text is not a valid time. */
+  static bool ParseSimTime(const std::string &text,
+                           SimTime &out_time) {  // NOLINT
+    SimTime day = 0;
+    std::string::size_type pos = 0;
+    std::string::size_type plus = text.find('+');
+    if (plus != std::string::npos) {
+      if (!parseDigits(text, 0, plus, day)) return false;
+      pos = plus + 1;
+    }
+    std::string::size_type colon = text.find(':', pos);
+    SimTime hour, min;
+    if (colon == std::string::npos || !parseDigits(text, pos, colon, hour) ||
+        !parseDigits(text, colon + 1, text.size(), min) || hour > 23 ||
+        min > 59) {
+      return false;
+    }
+    out_time = day * kSecondsPerDay + hour * 3600 + min * 60;
+    return true;
   }
 
  private:
   TrainTime() = default;
+
+  /** Writes value with at least min_width digits, zero padded. */
+  static int formatInt(SimTime value, int min_width, char *buffer) {
+    char digits[24];
+    int count = 0;
+    do {
+      digits[count++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value > 0);
+    int length = 0;
+    for (; length < min_width - count; length++) buffer[length] = '0';
+    while (count > 0) buffer[length++] = digits[--count];
+    return length;
+  }
+
+  static bool parseDigits(const std::string &text, std::string::size_type from,
+                          std::string::size_type to, SimTime &out) {  // NOLINT
+    if (from >= to || to - from > 6) return false;
+    out = 0;
+    for (std::string::size_type i = from; i < to; i++) {
+      if (text[i] < '0' || text[i] > '9') return false;
+      out = out * 10 + (text[i] - '0');
+    }
+    return true;
+  }
 };
 #endif  // PROJECT_INCLUDE_TRAIN_TIME_H_
@@ -10,8 +10,14 @@
 #include <memory>
 #include <string>
 
+class TextBuffer;
+
+/** \brief The name of a vehicle type 0-5, as in the demanded vehicles. */
+const char *VehicleTypeName(int type);
+
 /** \brief This is the Vehicle base class.
- * This class has two virtual functions GetType and GetDetatils.
+ * This class has two virtual functions GetType and AppendDetails. GetDetails
+ * returns the same text as AppendDetails as a string.
  */
 class Vehicle {
   int id_;
@@ -22,8 +28,9 @@ class Vehicle {
   int GetId() const { return id_; }
   void SetId(int id) { id_ = id; }
   virtual const int GetType() const = 0;
-  virtual std::string GetDetails() = 0;
-  std::string GetDetailsLow();
+  virtual void AppendDetails(TextBuffer &out) const = 0;  // NOLINT
+  std::string GetDetails() const;
+  std::string GetDetailsLow() const;
 };
 
 class Locomotive : public Vehicle {
@@ -34,7 +41,7 @@ class Locomotive : public Vehicle {
   virtual ~Locomotive() {}
   int GetMaxSpeed() const { return max_speed_; }
   const int GetType() const override = 0;
-  std::string GetDetails() override = 0;
+  void AppendDetails(TextBuffer &out) const override = 0;  // NOLINT
 };
 
 class Diesel : public Locomotive {
@@ -49,7 +56,7 @@ class Diesel : public Locomotive {
   virtual ~Diesel() {}
   int GetFuelConsumption() const { return fuel_consumption_; }
   const int GetType() const override { return TYPE; }
-  std::string GetDetails() override;
+  void AppendDetails(TextBuffer &out) const override;  // NOLINT
 };
 
 class Electrical : public Locomotive {
@@ -62,7 +69,7 @@ class Electrical : public Locomotive {
   virtual ~Electrical() {}
   int GetMaxPower() const { return maxPower; }
   const int GetType() const override { return TYPE; }
-  std::string GetDetails() override;
+  void AppendDetails(TextBuffer &out) const override;  // NOLINT
 };
 
 class Carriage : public Vehicle {
@@ -70,7 +77,7 @@ class Carriage : public Vehicle {
   explicit Carriage(int id) : Vehicle(id) {}
   virtual ~Carriage() {}
   const int GetType() const override = 0;
-  std::string GetDetails() override = 0;
+  void AppendDetails(TextBuffer &out) const override = 0;  // NOLINT
 };
 
 class PassengerCar : public Carriage {
@@ -78,7 +85,7 @@ class PassengerCar : public Carriage {
   explicit PassengerCar(int id) : Carriage(id) {}
   virtual ~PassengerCar() {}
   const int GetType() const override = 0;
-  std::string GetDetails() override = 0;
+  void AppendDetails(TextBuffer &out) const override = 0;  // NOLINT
 };
 
 class CoachCar : public PassengerCar {
@@ -99,7 +106,7 @@ class CoachCar : public PassengerCar {
   }
   bool IsHasInternet() const { return has_internet_; }
   const int GetType() const override { return TYPE; }
-  std::string GetDetails() override;
+  void AppendDetails(TextBuffer &out) const override;  // NOLINT
 };
 
 class SleepingCar : public PassengerCar {
@@ -112,7 +119,7 @@ class SleepingCar : public PassengerCar {
   virtual ~SleepingCar() {}
   int GetNumberOfBeds() const { return number_of_beds_; }
   const int GetType() const override { return TYPE; }
-  std::string GetDetails() override;
+  void AppendDetails(TextBuffer &out) const override;  // NOLINT
 };
 
 class FreightCar : public Carriage {
@@ -120,7 +127,7 @@ class FreightCar : public Carriage {
   explicit FreightCar(int id) : Carriage(id) {}
   virtual ~FreightCar() {}
   const int GetType() const override = 0;
-  std::string GetDetails() override = 0;
+  void AppendDetails(TextBuffer &out) const override = 0;  // NOLINT
 };
 
 class OpenCar : public FreightCar {
@@ -138,7 +145,7 @@ class OpenCar : public FreightCar {
   int GetWeightCapacity() const { return weight_capacity_; }
   int GetFloorArea() const { return floor_area_; }
   const int GetType() const override { return TYPE; }
-  std::string GetDetails() override;
+  void AppendDetails(TextBuffer &out) const override;  // NOLINT
 };
 
 class CoveredCar : public FreightCar {
@@ -151,7 +158,7 @@ class CoveredCar : public FreightCar {
   virtual ~CoveredCar() {}
   int GetVolumeCapacity() const { return volume_capacity_; }
   const int GetType() const override { return TYPE; }
-  std::string GetDetails() override;
+  void AppendDetails(TextBuffer &out) const override;  // NOLINT
 };
 
 #endif  // PROJECT_INCLUDE_VEHICLE_H_
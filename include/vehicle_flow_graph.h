@@ -0,0 +1,116 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#ifndef PROJECT_INCLUDE_VEHICLE_FLOW_GRAPH_H_
+#define PROJECT_INCLUDE_VEHICLE_FLOW_GRAPH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "train_time.h"  //NOLINT
+
+/** \brief A vehicle taken from or returned to the pool of a station. train
+ * is the index of the train in the TrainStationManager. */
+struct PoolChange {
+  SimTime time;
+  std::size_t train;
+  int vehicle_id;
+  bool taken;
+};
+
+/** \brief The train to took vehicles vehicles that the train from had
+ * returned. from is VehicleFlowGraph::kStartPool for the start pools. */
+struct FlowEdge {
+  std::size_t from;
+  std::size_t to;
+  int vehicles;
+};
+
+/** \brief What a train can change in the pools. The stations are name ids.
+ * first_attempt is the first time the train tries to assemble and
+ * earliest_return the earliest time it can return its vehicles. */
+struct TrainWindow {
+  int departure_station;
+  int arrival_station;
+  SimTime first_attempt;
+  SimTime earliest_return;
+};
+
+/** \brief Records how the vehicles flow between the trains of a run.
+ * Every vehicle taken from or returned to a station pool is recorded in
+ * order, together with the pools at the start. The train that returned a
+ * vehicle fed the train that takes it next, which gives a graph of which
+ * trains depend on which.
+ *
+ * A train only depends on the pool of its departure station while it tries
+ * to assemble. If a train is changed, the trains that can get another
+ * result are the ones that assemble at a station the change reaches, at or
+ * after the time it reaches it, and everything those trains reach in turn,
+ * see Cone. The pools of the rest of the run are known from the record.
+ */
+class VehicleFlowGraph {
+  /** \brief The pools at the start and the changes after that, indexed by
+   * station name id. */
+  std::vector<std::vector<int>> start_pools_;
+  std::vector<std::vector<PoolChange>> changes_;
+  /** \brief Indexed by train. */
+  std::vector<SimTime> assembled_at_;
+  /** \brief In the order the vehicles were taken, so the edges into a train
+   * are next to each other. Kept flat since a run has few edges per train. */
+  std::vector<FlowEdge> edges_;
+  /** \brief The train that returned each vehicle last, indexed by vehicle
+   * id. */
+  std::vector<std::size_t> returned_by_;
+
+ public:
+  /** \brief The time of a train that never assembled. */
+  static const SimTime kNever;
+  /** \brief Used in place of a train for the vehicles of the start pools. */
+  static const std::size_t kStartPool;
+
+  VehicleFlowGraph() {}
+  ~VehicleFlowGraph() {}
+
+  /** \brief Clears the record. start_pools holds the vehicle ids of every
+   * pool before the first event. */
+  void Start(std::vector<std::vector<int>> start_pools,
+             std::size_t number_of_trains);
+  void AddTaken(SimTime time, int station, std::size_t train, int vehicle_id);
+  void AddReturned(SimTime time, int station, std::size_t train,
+                   int vehicle_id);
+  void SetAssembled(std::size_t train, SimTime time) {
+    assembled_at_[train] = time;
+  }
+
+  /** \brief The edges into the train, one per train the vehicles came
+   * from. */
+  std::vector<FlowEdge> GetFedBy(std::size_t train) const;
+  /** \brief The edges out of the train, in the order the vehicles were
+   * taken. */
+  std::vector<FlowEdge> GetFeeds(std::size_t train) const;
+  const std::vector<PoolChange> &GetChanges(int station) const {
+    return changes_[station];
+  }
+  /** \brief The vehicle ids in the pool of the station after the changes
+   * before time, in pool order. */
+  std::vector<int> PoolBefore(int station, SimTime time) const;
+
+  /** \brief The trains that can get another result if the trains in changed
+   * are changed, in index order. windows holds every train, with the
+   * windows of the changed trains covering both the recorded run and the
+   * change. affected_from_out is set to the first time each station can
+   * differ from the record, or kNever.
+   *
+   * A station is reached at the first attempt of a train in the cone that
+   * departs from it and at the earliest return of a train that arrives at
+   * it. Every train that assembled there at or after that time, or never
+   * did, is in the cone. */
+  std::vector<std::size_t> Cone(
+      const std::vector<TrainWindow> &windows,
+      const std::vector<std::size_t> &changed,
+      std::vector<SimTime> &affected_from_out) const;  // NOLINT
+};
+
+#endif  // PROJECT_INCLUDE_VEHICLE_FLOW_GRAPH_H_
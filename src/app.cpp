@@ -5,16 +5,23 @@
 
 #include "app.h"  //NOLINT
 
-#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 #include "menu.h"         //NOLINT
+#include "profiler.h"     //NOLINT
+#include "query_server.h" //NOLINT
 #include "simulator.h"    //NOLINT
 #include "station.h"      //NOLINT
 #include "t_s_manager.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+#include "timetable_optimizer.h"  //NOLINT
 #include "train.h"        //NOLINT
 #include "train_map.h"    //NOLINT
 #include "train_time.h"   //NOLINT
@@ -22,7 +29,12 @@
 
 App::App(const std::string &ts_path, const std::string &t_path,
          const std::string &tm_path)
-    : simulation_done_(false),
+    : real_time_speedup_(0),
+      optimize_window_s_(0),
+      optimize_rounds_(0),
+      optimize_jobs_(0),
+      optimize_seed_(1),
+      simulation_done_(false),
       main_menu(Menu("Train simulator menu", true)),
       simulation_menu(Menu("Simulation controller", false)),
       train_menu(Menu("Train menu", false)),
@@ -32,6 +44,8 @@ App::App(const std::string &ts_path, const std::string &t_path,
       simulator(std::make_shared<Simulator>()) {
   train_station_manager = std::make_shared<TrainStationManager>(
       simulator, ts_path, t_path, tm_path);
+  simulation_worker_ = std::make_shared<SimulationWorker>(
+      simulator, train_station_manager);
   removeOldLog();
   initMenus();
 }
@@ -58,6 +72,8 @@ void App::initMenus() {
   MenuItem sim6("Finish simulation", true, [this]() { finishSimulation(); });
   MenuItem sim7("Change detail level", true, [this]() { changeDetailLevel(); });
   MenuItem sim8("Statistics menu", false, [this]() { statisticsMenu(); });
+  MenuItem sim9("Export events", true, [this]() { exportEvents(); });
+  MenuItem sim10("Run in real time", true, [this]() { runInRealTime(); });
   simulation_menu.AddMenuItem(sim1);
   simulation_menu.AddMenuItem(sim2);
   simulation_menu.AddMenuItem(sim3);
@@ -66,6 +82,8 @@ void App::initMenus() {
   simulation_menu.AddMenuItem(sim6);
   simulation_menu.AddMenuItem(sim7);
   simulation_menu.AddMenuItem(sim8);
+  simulation_menu.AddMenuItem(sim9);
+  simulation_menu.AddMenuItem(sim10);
 
   MenuItem tm1("Search by train number", true,
                [this]() { searchTrainByTrainNumber(); });
@@ -99,16 +117,18 @@ void App::initMenus() {
   MenuItem sm3("Trains that arrived in time", true,
                [this]() { showTrainsInTime(); });
   MenuItem sm4("See total delay", true, [this]() { showTotalDelay(); });
-  MenuItem sm5("List of delayed trains", true,
+  MenuItem sm5("See energy use", true, [this]() { showEnergyUse(); });
+  MenuItem sm6("See throughput", true, [this]() { showThroughput(); });
+  MenuItem sm7("List of delayed trains", true,
                [this]() { showDelayedTrains(); });
-  MenuItem sm6("List of trains that never left station", true,
+  MenuItem sm8("List of trains that never left station", true,
                [this]() { showTrainsStuckAtStation(); });
-  MenuItem sm7("A trains lifecycle, train number", true,
+  MenuItem sm9("A trains lifecycle, train number", true,
                [this]() { showTrainLifeCycle(); });
-  MenuItem sm8("A trains lifecycle, vehicle id", true,
-               [this]() { showTrainLifeCycleByVehicleId(); });
-  MenuItem sm9("Change detail level", true,
-               [this]() { changeStatsDetailLevel(); });
+  MenuItem sm10("A trains lifecycle, vehicle id", true,
+                [this]() { showTrainLifeCycleByVehicleId(); });
+  MenuItem sm11("Change detail level", true,
+                [this]() { changeStatsDetailLevel(); });
   statistics_menu.AddMenuItem(sm1);
   statistics_menu.AddMenuItem(sm2);
   statistics_menu.AddMenuItem(sm3);
@@ -118,17 +138,104 @@ void App::initMenus() {
   statistics_menu.AddMenuItem(sm7);
   statistics_menu.AddMenuItem(sm8);
   statistics_menu.AddMenuItem(sm9);
+  statistics_menu.AddMenuItem(sm10);
+  MenuItem sm12("What if a train departs at another time", true,
+                [this]() { whatIf(); });
+  MenuItem sm13("Vehicle flow of a train", true,
+                [this]() { showVehicleFlow(); });
+  MenuItem sm14("Root causes of the waits for vehicles", true,
+                [this]() { showDelayRootCauses(); });
+  statistics_menu.AddMenuItem(sm11);
+  statistics_menu.AddMenuItem(sm12);
+  statistics_menu.AddMenuItem(sm13);
+  statistics_menu.AddMenuItem(sm14);
+#ifdef TRAINS_PROFILING
+  MenuItem sm15("Profiling statistics", true,
+                [this]() { showProfilingStatistics(); });
+  statistics_menu.AddMenuItem(sm15);
+#endif
 }
 
 void App::Run() {
   // Has to be done post instantiation. "share_from_this()"
   train_station_manager->Setup();
+  startQueryServer();
 
   do {
     main_menu.PrintMenu();
   } while (main_menu.DoChoice());
 }
 
+void App::RunHeadless() {
+  train_station_manager->Setup();
+  startQueryServer();
+  if (real_time_speedup_ > 0) {
+    runPaced(real_time_speedup_);
+  } else {
+    finishSimulation();
+  }
+#ifdef TRAINS_PROFILING
+  TextBuffer json(8192);
+  simulator->GetProfiler().AppendJson(json);
+  std::ofstream profile_file("Trainsim.profile.json");
+  profile_file.write(json.Data(), json.Size());
+#endif
+  if (!what_if_edits_.empty()) {
+    std::cout << train_station_manager->WhatIf(what_if_edits_);
+  }
+  if (optimize_rounds_ > 0) {
+    TimetableOptimizer optimizer(train_station_manager, optimize_window_s_,
+                                 optimize_jobs_, optimize_seed_);
+    std::cout << optimizer.Optimize(optimize_rounds_);
+  }
+  if (query_server_) {
+    std::cout << "Serving on " << serve_path_ << ", press Enter to stop"
+              << std::endl;
+    std::string line;
+    std::getline(std::cin, line);
+  }
+}
+
+void App::AddEventExport(ExportFormat format, const std::string &path) {
+  simulator->AddEventSink(EventSink::Create(format, path));
+}
+
+void App::SetConsoleLog(bool console_log) {
+  simulator->SetConsoleLog(console_log);
+}
+
+void App::SetEventLogRetention(RetentionPolicy policy, std::size_t capacity) {
+  simulator->SetEventLogRetention(policy, capacity);
+}
+
+void App::SetServePath(const std::string &path) { serve_path_ = path; }
+
+void App::LoadDisruptions(const std::string &path) {
+  train_station_manager->LoadDisruptions(path);
+}
+
+void App::AddWhatIf(const DepartureEdit &edit) {
+  what_if_edits_.push_back(edit);
+}
+
+void App::SetParameters(const SimulationParameters &parameters) {
+  train_station_manager->SetParameters(parameters);
+}
+
+void App::SetOptimizer(SimTime window_s, int rounds, std::size_t jobs,
+                       unsigned seed) {
+  optimize_window_s_ = window_s;
+  optimize_rounds_ = rounds;
+  optimize_jobs_ = jobs;
+  optimize_seed_ = seed;
+}
+
+void App::startQueryServer() {
+  if (serve_path_.empty()) return;
+  query_server_ = std::make_shared<QueryServer>(
+      serve_path_, simulator, train_station_manager, simulation_worker_);
+}
+
 void App::simulationMenu() {
   do {
     simulation_menu.PrintMenu();
@@ -164,7 +271,7 @@ void App::seeTimeTable() {
 }
 
 void App::changeStartTime() {
-  time_t temp;
+  SimTime temp;
   do {
     temp = inputTime();
     if (temp > simulator->GetStopTime()) {
@@ -177,7 +284,7 @@ void App::changeStartTime() {
 }
 
 void App::changeStopTime() {
-  time_t temp;
+  SimTime temp;
   do {
     temp = inputTime();
   } while (temp < simulator->GetCurrentTime());
@@ -194,15 +301,14 @@ void App::nextInterval() {
     if (keyPressNotEnter()) break;
     simulator->SetCurrentTime(
         simulator->GetCurrentTime() +
-        static_cast<time_t>(simulator->GetDiscreteInterval()) *
-            static_cast<time_t>(60));
+        static_cast<SimTime>(simulator->GetDiscreteInterval()) *
+            static_cast<SimTime>(60));
   } while (true);
   simulation_menu.SetMenuItemEnabled("Statistics menu", true);
 }
 
 void App::nextEvent() {
-  simulator->SetCurrentTime(simulator->GetTime());
-  if (!simulator->RunNextEvent()) {
+  if (!runOnWorker(WorkerCommandType::STEP, 0).events_left) {
     setSimulationDone(true);
     simulation_menu.SetMenuItemEnabled("Statistics menu", true);
   }
@@ -210,20 +316,51 @@ void App::nextEvent() {
 }
 
 void App::finishSimulation() {
+  if (isatty(STDIN_FILENO)) std::cout << "Press Enter to pause\n";
   simulator->SetCurrentTime(simulator->GetStopSimulationTime());
   processEventsIfTime();
 }
 
+void App::runInRealTime() {
+  runPaced(Menu::GetMenuChoice(
+      "Speedup, simulated seconds per second [1-3600]:", 1, 3600));
+}
+
+void App::runPaced(int speedup) {
+  if (isatty(STDIN_FILENO)) std::cout << "Press Enter to pause\n";
+  showRunResult(runOnWorker(WorkerCommandType::RUN_PACED,
+                            simulator->GetStopSimulationTime(), speedup));
+}
+
 void App::changeDetailLevel() {
   simulator->SetHighDetailLevel(
       Menu::GetMenuChoice("Detail level, High [1], Low [0]:", 0, 1));
 }
 
+void App::exportEvents() {
+  int choice = Menu::GetMenuChoice(
+      "Format, CSV [1], JSON Lines [2], Binary [3], Cancel [0]:", 0, 3);
+  if (choice == 0) return;
+  const ExportFormat formats[] = {ExportFormat::CSV, ExportFormat::JSON_LINES,
+                                  ExportFormat::BINARY};
+  const char *default_paths[] = {"Trainsim.csv", "Trainsim.jsonl",
+                                 "Trainsim.bin"};
+  std::string path = getStringInput(std::string("File name [") +
+                                    default_paths[choice - 1] + "]:");
+  if (path.empty()) path = default_paths[choice - 1];
+  try {
+    AddEventExport(formats[choice - 1], path);
+  } catch (const std::exception &e) {
+    std::cout << e.what() << "\n";
+  }
+}
+
 void App::searchTrainByTrainNumber() {
   int input = Menu::GetMenuChoice("Train number:", 1, 1000);
   try {
     std::string details =
-        train_station_manager->GetTrainDetailsByTrainNumber(input);
+        train_station_manager->GetTrainDetailsByTrainNumber(
+            input, train_station_manager->IsHighLogLevelTrain());
     std::cout << details << "\n";
   } catch (const std::exception &e) {
     std::cout << e.what() << "\n";
@@ -234,7 +371,8 @@ void App::searchTrainByVehicleId() {
   int input = Menu::GetMenuChoice("Train number:", 1, 1000);
   try {
     std::string details =
-        train_station_manager->GetTrainDetailsByVehicleId(input);
+        train_station_manager->GetTrainDetailsByVehicleId(
+            input, train_station_manager->IsHighLogLevelTrain());
     std::cout << details << "\n";
   } catch (const std::exception &e) {
     std::cout << e.what() << "\n";
@@ -300,10 +438,22 @@ void App::showAllStatistics() {
             << TrainTime::SecondsToPretty(
                    static_cast<int>(simulator->GetTotalDepartureDelay()))
             << "\n\n"
+            << "Energy use:\n"
+            << simulator->GetEnergyAccount().GetReport(
+                   train_station_manager->GetStationNames(),
+                   train_station_manager->IsHighLogLevelStats())
+            << "\n"
+            << "Throughput:\n"
+            << simulator->GetThroughputAccount().GetReport(
+                   train_station_manager->GetStationNames(),
+                   train_station_manager->IsHighLogLevelStats())
+            << "\n"
             << "List of trains that never left station:\n"
             << train_station_manager->GetTrainsStuckAtStation() << "\n"
             << "List of delayed trains:\n"
-            << train_station_manager->GetDelayedTrains() << "\n";
+            << train_station_manager->GetDelayedTrains() << "\n"
+            << "Root causes of the waits for vehicles:\n"
+            << train_station_manager->GetDelayRootCauses() << "\n";
 }
 
 void App::showVehicleDistributionStart() {
@@ -322,6 +472,22 @@ void App::showTotalDelay() {
             << "\n";
 }
 
+void App::showEnergyUse() {
+  std::cout << "Energy use:\n"
+            << simulator->GetEnergyAccount().GetReport(
+                   train_station_manager->GetStationNames(),
+                   train_station_manager->IsHighLogLevelStats())
+            << "\n";
+}
+
+void App::showThroughput() {
+  std::cout << "Throughput:\n"
+            << simulator->GetThroughputAccount().GetReport(
+                   train_station_manager->GetStationNames(),
+                   train_station_manager->IsHighLogLevelStats())
+            << "\n";
+}
+
 void App::showTrainsStuckAtStation() {
   std::cout << "List of trains that never left station:\n"
             << train_station_manager->GetTrainsStuckAtStation() << "\n";
@@ -341,7 +507,7 @@ void App::showTrainLifeCycle() {
   std::string output;
   int input = Menu::GetMenuChoice("Train number:", 1, 1000);
   if (train_station_manager->GetTrainLifeCycleByTrainNumber(
-          input, output)) {
+          input, train_station_manager->IsHighLogLevelStats(), output)) {
     std::cout << output;
   } else {
     std::cout << "There is no train with this number.\n";
@@ -352,7 +518,7 @@ void App::showTrainLifeCycleByVehicleId() {
   std::string output;
   int input = Menu::GetMenuChoice("Vehicle id:", 1, 1000);
   if (train_station_manager->GetTrainLifeCycleByVehicleId(
-          input, output)) {
+          input, train_station_manager->IsHighLogLevelStats(), output)) {
     std::cout << output;
   } else {
     std::cout << "There is no train with this number.\n";
@@ -364,8 +530,60 @@ void App::changeStatsDetailLevel() {
   train_station_manager->SetHighLogLevelStats(input);
 }
 
+void App::whatIf() {
+  if (!isSimulationDone()) {
+    std::cout << "The simulation has to be finished first.\n";
+    return;
+  }
+  int number = Menu::GetMenuChoice("Train number:", 1, 1000);
+  SimTime departure;
+  do {
+    std::cout << "New departure time, hh:mm or d+hh:mm\n:";
+    std::string input;
+    std::cin >> input;
+    bool valid = !std::cin.fail() && TrainTime::ParseSimTime(input, departure);
+    std::cin.clear();
+    std::cin.ignore(std::cin.rdbuf()->in_avail());
+    if (valid) break;
+  } while (true);
+  try {
+    std::cout << train_station_manager->WhatIf(
+        {DepartureEdit{number, departure}});
+  } catch (const std::exception &e) {
+    std::cout << e.what() << "\n";
+  }
+}
+
+void App::showVehicleFlow() {
+  std::string output;
+  int input = Menu::GetMenuChoice("Train number:", 1, 1000);
+  if (train_station_manager->GetVehicleFlowByTrainNumber(input, output)) {
+    std::cout << output;
+  } else {
+    std::cout << "There is no train with this number.\n";
+  }
+}
+
+void App::showDelayRootCauses() {
+  std::cout << "Root causes of the waits for vehicles:\n"
+            << train_station_manager->GetDelayRootCauses() << "\n";
+}
+
+#ifdef TRAINS_PROFILING
+void App::showProfilingStatistics() {
+  std::cout << simulator->GetProfiler().GetReport() << "\n";
+}
+#endif
+
 void App::processEventsIfTime() {
-  if (!simulator->RunEventsUntilTime()) {
+  showRunResult(
+      runOnWorker(WorkerCommandType::RUN_TO, simulator->GetCurrentTime()));
+}
+
+void App::showRunResult(const WorkerOutput &done) {
+  if (done.paused) {
+    std::cout << "Paused at ";
+  } else if (!done.events_left) {
     setSimulationDone(true);
     simulation_menu.SetMenuItemEnabled("Statistics menu", true);
     simulation_menu.SetMenuItemEnabled("Change start time", false);
@@ -375,11 +593,49 @@ void App::processEventsIfTime() {
     simulation_menu.SetMenuItemEnabled("Next event", false);
     simulation_menu.SetMenuItemEnabled("Finish simulation", false);
     simulation_menu.SetMenuItemEnabled("Change detail level", false);
+    simulation_menu.SetMenuItemEnabled("Export events", false);
+    simulation_menu.SetMenuItemEnabled("Run in real time", false);
   }
-  std::cout << TrainTime::Time_tToString(simulator->GetCurrentTime())
+  std::cout << TrainTime::SimTimeToString(simulator->GetCurrentTime())
             << " # Current time\n";
 }
 
+WorkerOutput App::runOnWorker(WorkerCommandType type, SimTime time,
+                              int speedup) {
+  simulation_worker_->Send(type, time, speedup);
+  bool pause_sent = false;
+  WorkerOutput output;
+  while (true) {
+    if (!simulation_worker_->TryReceive(output)) {
+      if (!pause_sent && type != WorkerCommandType::STEP && enterPressed()) {
+        simulation_worker_->Send(WorkerCommandType::PAUSE, 0);
+        pause_sent = true;
+      }
+      simulation_worker_->WaitForOutput(50);
+      continue;
+    }
+    switch (output.type) {
+      case WorkerOutputType::TEXT:
+        std::cout.write(output.text.data(), output.text.size());
+        break;
+      case WorkerOutputType::DONE:
+        return output;
+      case WorkerOutputType::FAILED:
+        throw std::runtime_error(output.text);
+    }
+  }
+}
+
+bool App::enterPressed() {
+  // Only a terminal is watched, input from a file or a pipe is menu choices.
+  if (!isatty(STDIN_FILENO)) return false;
+  pollfd input = {STDIN_FILENO, POLLIN, 0};
+  if (poll(&input, 1, 0) <= 0) return false;
+  std::string line;
+  std::getline(std::cin, line);
+  return true;
+}
+
 bool App::keyPressNotEnter() {
   std::cout << "Press Enter to continue or Q/q for Menu\n";
   std::string choice;
@@ -394,27 +650,19 @@ std::string App::getStringInput(const std::string &prompt) {
   return line;
 }
 
-time_t App::inputTime() {
-  std::tm time_struct{};
-  time_t time1;
+SimTime App::inputTime() {
+  SimTime time1;
 
   do {
-    std::cout << "Input new time, hh:mm\n:";
+    std::cout << "Input new time, hh:mm or d+hh:mm\n:";
     auto clear = []() {
       std::cin.clear();
       std::cin.ignore(std::cin.rdbuf()->in_avail());
     };
-    std::cin >> std::get_time(&time_struct, "%H:%M");
-
-    time_t today = time(nullptr);
-    std::tm todayStruct{};
-    gmtime_r(&today, &todayStruct);
-    todayStruct.tm_hour = time_struct.tm_hour;
-    todayStruct.tm_min = time_struct.tm_min;
-    todayStruct.tm_sec = 0;
-
-    time1 = mktime(&todayStruct);
-    if (!std::cin.fail() && time1 >= simulator->GetCurrentTime() &&
+    std::string input;
+    std::cin >> input;
+    if (!std::cin.fail() && TrainTime::ParseSimTime(input, time1) &&
+        time1 >= simulator->GetCurrentTime() &&
         time1 <= simulator->GetStopTime()) {
       clear();
       return time1;
@@ -0,0 +1,446 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "data_loader.h"  //NOLINT
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "train_time.h"  //NOLINT
+#include "vehicle.h"  //NOLINT
+
+// Files smaller than this are parsed by the calling thread.
+static const std::size_t kMinChunkSize = 64 * 1024;
+// At most this many problems are listed in the exception.
+static const std::size_t kMaxProblems = 20;
+
+/** \brief A part of a file that starts and ends on a line boundary. */
+struct Chunk {
+  const char *begin;
+  const char *end;
+  int first_line;
+};
+
+static std::string location(const std::string &path, int line) {
+  return path + ":" + std::to_string(line) + ": ";
+}
+
+static std::size_t numberOfThreads() {
+  unsigned threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+static std::string readFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open file " + path);
+  }
+  std::string text;
+  file.seekg(0, std::ios::end);
+  text.resize(static_cast<std::size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  file.read(&text[0], static_cast<std::streamsize>(text.size()));
+  return text;
+}
+
+static std::vector<Chunk> splitLines(const std::string &text) {
+  std::size_t number_of_chunks = std::max<std::size_t>(
+      1, std::min(numberOfThreads() * 4, text.size() / kMinChunkSize));
+  std::size_t chunk_size = text.size() / number_of_chunks + 1;
+  const char *begin = text.data();
+  const char *end = text.data() + text.size();
+  int line = 1;
+  std::vector<Chunk> chunks;
+  while (begin < end) {
+    const char *stop =
+        begin + std::min(chunk_size, static_cast<std::size_t>(end - begin));
+    stop = std::find(stop, end, '\n');
+    if (stop != end) ++stop;
+    chunks.push_back({begin, stop, line});
+    line += static_cast<int>(std::count(begin, stop, '\n'));
+    begin = stop;
+  }
+  return chunks;
+}
+
+/** \brief Reads the file and calls parse_line for every line. The chunks of
+ * the file are handed out to the threads one at a time, and the records of
+ * each chunk are kept apart until all threads are done. If parsing throws,
+ * the exception of the first chunk in the file is rethrown. */
+template <typename Record, typename ParseLine>
+static std::vector<Record> parseFile(const std::string &path,
+                                     ParseLine parse_line) {
+  std::string text = readFile(path);
+  std::vector<Chunk> chunks = splitLines(text);
+  std::vector<std::vector<Record>> results(chunks.size());
+  std::vector<std::exception_ptr> errors(chunks.size());
+  std::atomic<std::size_t> next_chunk(0);
+
+  auto worker = [&]() {
+    for (std::size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+      try {
+        int line = chunks[i].first_line;
+        const char *begin = chunks[i].begin;
+        while (begin < chunks[i].end) {
+          const char *end = std::find(begin, chunks[i].end, '\n');
+          std::string text_line(begin, end);
+          if (!text_line.empty() && text_line.back() == '\r') {
+            text_line.pop_back();
+          }
+          parse_line(text_line, path, line, results[i]);
+          begin = end == chunks[i].end ? end : end + 1;
+          line++;
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  std::size_t threads = std::min(numberOfThreads(), chunks.size());
+  for (std::size_t i = 1; i < threads; i++) pool.emplace_back(worker);
+  worker();
+  std::for_each(pool.begin(), pool.end(),
+                [](std::thread &thread) { thread.join(); });
+
+  std::vector<Record> records;
+  for (std::size_t i = 0; i < chunks.size(); i++) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+    std::move(results[i].begin(), results[i].end(),
+              std::back_inserter(records));
+  }
+  return records;
+}
+
+static void parseStationLine(const std::string &text, const std::string &path,
+                             int line,
+                             std::vector<StationRecord> &out) {  // NOLINT
+  std::istringstream iss(text);
+  StationRecord record;
+  if (!(iss >> record.name)) return;
+  record.line = line;
+  std::size_t open = text.find('(');
+  while (open != std::string::npos) {
+    std::size_t close = text.find(')', open);
+    if (close == std::string::npos) {
+      throw std::runtime_error(location(path, line) +
+                               "missing ')' in station " + record.name);
+    }
+    std::istringstream isss(text.substr(open + 1, close - open - 1));
+    int id, type, param_0, param_1 = 0;
+    if (!(isss >> id >> type >> param_0) ||
+        ((type == 0 || type == 2 || type == 4 || type == 5) &&
+         !(isss >> param_1))) {
+      throw std::runtime_error(location(path, line) + "malformed vehicle '" +
+                               text.substr(open, close - open + 1) + "'");
+    }
+    if (type == 0) {
+      record.vehicles.emplace_back(
+          std::make_shared<CoachCar>(id, param_0, param_1));
+    } else if (type == 1) {
+      record.vehicles.emplace_back(std::make_shared<SleepingCar>(id, param_0));
+    } else if (type == 2) {
+      record.vehicles.emplace_back(
+          std::make_shared<OpenCar>(id, param_0, param_1));
+    } else if (type == 3) {
+      record.vehicles.emplace_back(std::make_shared<CoveredCar>(id, param_0));
+    } else if (type == 4) {
+      record.vehicles.emplace_back(
+          std::make_shared<Electrical>(id, param_0, param_1));
+    } else if (type == 5) {
+      record.vehicles.emplace_back(
+          std::make_shared<Diesel>(id, param_0, param_1));
+    } else {
+      record.unknown_vehicles.emplace_back(id, type);
+    }
+    open = text.find('(', close);
+  }
+  out.emplace_back(std::move(record));
+}
+
+static void parseTrainLine(const std::string &text, const std::string &path,
+                           int line,
+                           std::vector<TrainRecord> &out) {  // NOLINT
+  std::istringstream iss(text);
+  std::string dep_st, arr_st, dep_time, arr_time;
+  int id, max_speed;
+  if (!(iss >> id)) {
+    if (iss.eof()) return;
+    throw std::runtime_error(location(path, line) + "malformed train");
+  }
+  if (!(iss >> dep_st >> arr_st >> dep_time >> arr_time >> max_speed)) {
+    throw std::runtime_error(location(path, line) + "malformed train " +
+                             std::to_string(id));
+  }
+  SimTime departure_time, arrival_time;
+  if (!TrainTime::ParseSimTime(dep_time, departure_time) ||
+      !TrainTime::ParseSimTime(arr_time, arrival_time)) {
+    throw std::runtime_error(location(path, line) +
+                             "invalid time for train " + std::to_string(id));
+  }
+  // A train that arrives before it departs runs past midnight.
+  while (arrival_time < departure_time) {
+    arrival_time += TrainTime::kSecondsPerDay;
+  }
+  std::vector<int> vehicle_types;
+  int type;
+  while (iss >> type) vehicle_types.emplace_back(type);
+  if (!iss.eof()) {
+    throw std::runtime_error(location(path, line) +
+                             "malformed vehicle type for train " +
+                             std::to_string(id));
+  }
+  out.push_back({line, id, dep_st, arr_st, departure_time, arrival_time,
+                 max_speed, vehicle_types});
+}
+
+static void parseMapLine(const std::string &text, const std::string &path,
+                         int line,
+                         std::vector<DistanceRecord> &out) {  // NOLINT
+  std::istringstream iss(text);
+  DistanceRecord record;
+  if (!(iss >> record.station_1)) return;
+  if (!(iss >> record.station_2 >> record.distance)) {
+    throw std::runtime_error(location(path, line) + "malformed distance");
+  }
+  record.line = line;
+  out.emplace_back(std::move(record));
+}
+
+static void parseDisruptionLine(
+    const std::string &text, const std::string &path, int line,
+    std::vector<DisruptionRecord> &out) {  // NOLINT
+  std::istringstream iss(text);
+  std::string keyword;
+  if (!(iss >> keyword) || keyword[0] == '#') return;
+  DisruptionRecord record = {line, DisruptionType::CLOSURE, "", "", 0, 0, 0};
+  bool parsed;
+  if (keyword == "CLOSE" || keyword == "SPEED") {
+    parsed = static_cast<bool>(iss >> record.station_1 >> record.station_2);
+  } else if (keyword == "FREEZE") {
+    record.type = DisruptionType::POOL_FREEZE;
+    parsed = static_cast<bool>(iss >> record.station_1);
+  } else {
+    throw std::runtime_error(location(path, line) + "unknown disruption " +
+                             keyword);
+  }
+  std::string from, to;
+  parsed = parsed && (iss >> from >> to);
+  if (keyword == "SPEED") {
+    record.type = DisruptionType::SPEED_RESTRICTION;
+    parsed = parsed && (iss >> record.max_speed);
+  }
+  if (!parsed) {
+    throw std::runtime_error(location(path, line) + "malformed " + keyword);
+  }
+  if (!TrainTime::ParseSimTime(from, record.from) ||
+      !TrainTime::ParseSimTime(to, record.to)) {
+    throw std::runtime_error(location(path, line) + "invalid time for " +
+                             keyword);
+  }
+  out.emplace_back(std::move(record));
+}
+
+DataLoader::DataLoader(const std::string &station_path,
+                       const std::string &trains_path,
+                       const std::string &map_path)
+    : station_path_(station_path),
+      trains_path_(trains_path),
+      map_path_(map_path) {
+  auto stations =
+      std::async(std::launch::async, &DataLoader::loadStations, station_path);
+  auto trains =
+      std::async(std::launch::async, &DataLoader::loadTrains, trains_path);
+  distances_ = loadMap(map_path);
+  stations_ = stations.get();
+  trains_ = trains.get();
+  validate();
+}
+
+std::vector<StationRecord> DataLoader::loadStations(const std::string &path) {
+  return parseFile<StationRecord>(path, parseStationLine);
+}
+
+std::vector<TrainRecord> DataLoader::loadTrains(const std::string &path) {
+  return parseFile<TrainRecord>(path, parseTrainLine);
+}
+
+std::vector<DistanceRecord> DataLoader::loadMap(const std::string &path) {
+  return parseFile<DistanceRecord>(path, parseMapLine);
+}
+
+std::vector<DisruptionRecord> DataLoader::LoadDisruptions(
+    const std::string &path) {
+  return parseFile<DisruptionRecord>(path, parseDisruptionLine);
+}
+
+std::vector<std::string> DataLoader::checkTrainStations() const {
+  std::unordered_set<std::string> names;
+  std::for_each(stations_.begin(), stations_.end(),
+                [&names](const StationRecord &station) {
+                  names.insert(station.name);
+                });
+  std::vector<std::string> problems;
+  std::for_each(
+      trains_.begin(), trains_.end(), [&](const TrainRecord &train) {
+        if (names.count(train.departure_station) == 0) {
+          problems.emplace_back(location(trains_path_, train.line) + "train " +
+                                std::to_string(train.number) +
+                                " departs from unknown station " +
+                                train.departure_station);
+        }
+        if (names.count(train.arrival_station) == 0) {
+          problems.emplace_back(location(trains_path_, train.line) + "train " +
+                                std::to_string(train.number) +
+                                " arrives at unknown station " +
+                                train.arrival_station);
+        }
+      });
+  return problems;
+}
+
+std::vector<std::string> DataLoader::checkDistances() const {
+  std::set<std::pair<std::string, std::string>> routes;
+  std::for_each(distances_.begin(), distances_.end(),
+                [&routes](const DistanceRecord &distance) {
+                  routes.insert(std::minmax(distance.station_1,
+                                            distance.station_2));
+                });
+  std::vector<std::string> problems;
+  std::for_each(
+      trains_.begin(), trains_.end(), [&](const TrainRecord &train) {
+        if (routes.count(std::minmax(train.departure_station,
+                                     train.arrival_station)) == 0) {
+          problems.emplace_back(
+              location(trains_path_, train.line) + "train " +
+              std::to_string(train.number) + " has no distance from " +
+              train.departure_station + " to " + train.arrival_station +
+              " in " + map_path_);
+        }
+      });
+  return problems;
+}
+
+std::vector<std::string> DataLoader::checkVehicleIds() const {
+  std::unordered_map<int, int> first_line;
+  std::vector<std::string> problems;
+  std::for_each(
+      stations_.begin(), stations_.end(), [&](const StationRecord &station) {
+        std::for_each(
+            station.vehicles.begin(), station.vehicles.end(),
+            [&](const std::shared_ptr<Vehicle> &vehicle) {
+              auto inserted =
+                  first_line.emplace(vehicle->GetId(), station.line);
+              if (!inserted.second) {
+                problems.emplace_back(
+                    location(station_path_, station.line) + "vehicle id " +
+                    std::to_string(vehicle->GetId()) +
+                    " is already used on line " +
+                    std::to_string(inserted.first->second));
+              }
+            });
+      });
+  return problems;
+}
+
+std::vector<std::string> DataLoader::checkStationNamesAndTrainNumbers() const {
+  std::unordered_map<std::string, int> station_line;
+  std::unordered_map<int, int> train_line;
+  std::vector<std::string> problems;
+  std::for_each(
+      stations_.begin(), stations_.end(), [&](const StationRecord &station) {
+        auto inserted = station_line.emplace(station.name, station.line);
+        if (!inserted.second) {
+          problems.emplace_back(location(station_path_, station.line) +
+                                "station " + station.name +
+                                " is already defined on line " +
+                                std::to_string(inserted.first->second));
+        }
+      });
+  std::for_each(
+      trains_.begin(), trains_.end(), [&](const TrainRecord &train) {
+        auto inserted = train_line.emplace(train.number, train.line);
+        if (!inserted.second) {
+          problems.emplace_back(location(trains_path_, train.line) +
+                                "train number " + std::to_string(train.number) +
+                                " is already used on line " +
+                                std::to_string(inserted.first->second));
+        }
+      });
+  return problems;
+}
+
+std::vector<std::string> DataLoader::checkTypeCodes() const {
+  std::vector<std::string> problems;
+  std::for_each(
+      stations_.begin(), stations_.end(), [&](const StationRecord &station) {
+        std::for_each(station.unknown_vehicles.begin(),
+                      station.unknown_vehicles.end(),
+                      [&](const std::pair<int, int> &vehicle) {
+                        problems.emplace_back(
+                            location(station_path_, station.line) +
+                            "vehicle " + std::to_string(vehicle.first) +
+                            " has unknown type " +
+                            std::to_string(vehicle.second));
+                      });
+      });
+  std::for_each(
+      trains_.begin(), trains_.end(), [&](const TrainRecord &train) {
+        std::for_each(train.vehicle_types.begin(), train.vehicle_types.end(),
+                      [&](int type) {
+                        if (type < 0 || type > 5) {
+                          problems.emplace_back(
+                              location(trains_path_, train.line) + "train " +
+                              std::to_string(train.number) +
+                              " demands unknown vehicle type " +
+                              std::to_string(type));
+                        }
+                      });
+      });
+  return problems;
+}
+
+void DataLoader::validate() const {
+  std::vector<std::future<std::vector<std::string>>> checks;
+  checks.emplace_back(std::async(std::launch::async,
+                                 &DataLoader::checkTrainStations, this));
+  checks.emplace_back(
+      std::async(std::launch::async, &DataLoader::checkDistances, this));
+  checks.emplace_back(
+      std::async(std::launch::async, &DataLoader::checkVehicleIds, this));
+  checks.emplace_back(
+      std::async(std::launch::async,
+                 &DataLoader::checkStationNamesAndTrainNumbers, this));
+  std::vector<std::string> problems = checkTypeCodes();
+  // The problems are listed in the order of the checks.
+  std::vector<std::string> all_problems;
+  std::for_each(checks.begin(), checks.end(),
+                [&all_problems](std::future<std::vector<std::string>> &check) {
+                  std::vector<std::string> found = check.get();
+                  all_problems.insert(all_problems.end(), found.begin(),
+                                      found.end());
+                });
+  all_problems.insert(all_problems.end(), problems.begin(), problems.end());
+  if (all_problems.empty()) return;
+
+  std::string message = "Invalid input data:";
+  for (std::size_t i = 0; i < all_problems.size() && i < kMaxProblems; i++) {
+    message += "\n" + all_problems[i];
+  }
+  if (all_problems.size() > kMaxProblems) {
+    message += "\n... and " +
+               std::to_string(all_problems.size() - kMaxProblems) + " more";
+  }
+  throw std::runtime_error(message);
+}
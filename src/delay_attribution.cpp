@@ -0,0 +1,78 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "delay_attribution.h"  //NOLINT
+
+#include <algorithm>
+
+void DelayAttribution::Start(std::size_t number_of_trains) {
+  waits_.clear();
+  waited_.assign(number_of_trains, 0);
+  roots_.assign(number_of_trains, std::vector<RootShare>());
+}
+
+void DelayAttribution::addShare(std::vector<RootShare> &shares,
+                                const DelayCause &root, SimTime seconds) {
+  if (seconds == 0) return;
+  auto share = std::find_if(
+      shares.begin(), shares.end(),
+      [&root](const RootShare &other) { return other.root == root; });
+  if (share == shares.end()) {
+    shares.push_back(RootShare{root, seconds, 0});
+  } else {
+    share->seconds += seconds;
+  }
+}
+
+void DelayAttribution::AddWait(SimTime time, std::size_t train,
+                               int vehicle_type, SimTime seconds,
+                               const DelayCause &cause, SimTime lateness) {
+  waits_.push_back(WaitRecord{time, train, vehicle_type, seconds, cause});
+  waited_[train] += seconds;
+  std::vector<RootShare> &shares = roots_[train];
+  if (cause.type != DelayCauseType::LATE_TRAIN) {
+    addShare(shares, cause, seconds);
+    return;
+  }
+  // The wait of the late train explains waited of its lateness. Each of its
+  // roots gets its part of that, and the train the rest.
+  SimTime waited = waited_[cause.index];
+  SimTime explained = std::max(waited, lateness);
+  SimTime passed_on = 0;
+  const std::vector<RootShare> &upstream = roots_[cause.index];
+  for (const RootShare &root : upstream) {
+    SimTime share = seconds * root.seconds / explained;
+    addShare(shares, root.root, share);
+    passed_on += share;
+  }
+  if (waited < lateness || upstream.empty()) {
+    addShare(shares, cause, seconds - passed_on);
+  } else {
+    addShare(shares, upstream.front().root, seconds - passed_on);
+  }
+}
+
+std::vector<RootShare> DelayAttribution::GetRootTotals() const {
+  std::vector<RootShare> totals;
+  for (const std::vector<RootShare> &shares : roots_) {
+    for (const RootShare &share : shares) {
+      auto total = std::find_if(totals.begin(), totals.end(),
+                                [&share](const RootShare &other) {
+                                  return other.root == share.root;
+                                });
+      if (total == totals.end()) {
+        totals.push_back(RootShare{share.root, share.seconds, 1});
+      } else {
+        total->seconds += share.seconds;
+        total->trains++;
+      }
+    }
+  }
+  std::stable_sort(totals.begin(), totals.end(),
+                   [](const RootShare &first, const RootShare &second) {
+                     return first.seconds > second.seconds;
+                   });
+  return totals;
+}
@@ -0,0 +1,71 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "disruption_schedule.h"  //NOLINT
+
+static bool isActive(const Disruption &disruption, SimTime time) {
+  return disruption.from <= time && time < disruption.to;
+}
+
+void DisruptionSchedule::Add(const Disruption &disruption,
+                             std::uint64_t route) {
+  if (disruption.type == DisruptionType::POOL_FREEZE) {
+    by_station_[disruption.station_1].push_back(disruptions_.size());
+  } else {
+    by_route_[route].push_back(disruptions_.size());
+  }
+  disruptions_.push_back(disruption);
+}
+
+const std::vector<std::size_t> *DisruptionSchedule::onRoute(
+    std::uint64_t route) const {
+  auto it = by_route_.find(route);
+  return it == by_route_.end() ? nullptr : &it->second;
+}
+
+SimTime DisruptionSchedule::OpenAt(std::uint64_t route, SimTime time,
+                                   SimTime now) const {
+  const std::vector<std::size_t> *indices = onRoute(route);
+  if (indices == nullptr) return time;
+  // Every pass that moves the time past a closure starts over, since an
+  // earlier closure in the list may begin where that one ended.
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (std::size_t index : *indices) {
+      const Disruption &disruption = disruptions_[index];
+      if (disruption.type == DisruptionType::CLOSURE &&
+          disruption.from <= now && isActive(disruption, time)) {
+        time = disruption.to;
+        moved = true;
+      }
+    }
+  }
+  return time;
+}
+
+int DisruptionSchedule::MaxSpeedAt(std::uint64_t route, SimTime time) const {
+  const std::vector<std::size_t> *indices = onRoute(route);
+  if (indices == nullptr) return 0;
+  int max_speed = 0;
+  for (std::size_t index : *indices) {
+    const Disruption &disruption = disruptions_[index];
+    if (disruption.type == DisruptionType::SPEED_RESTRICTION &&
+        isActive(disruption, time) &&
+        (max_speed == 0 || disruption.max_speed < max_speed)) {
+      max_speed = disruption.max_speed;
+    }
+  }
+  return max_speed;
+}
+
+bool DisruptionSchedule::IsFrozen(int station, SimTime time) const {
+  auto it = by_station_.find(station);
+  if (it == by_station_.end()) return false;
+  for (std::size_t index : it->second) {
+    if (isActive(disruptions_[index], time)) return true;
+  }
+  return false;
+}
@@ -0,0 +1,166 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "energy_account.h"  //NOLINT
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+#include "run_time_model.h"  //NOLINT
+#include "string_table.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+#include "train.h"  //NOLINT
+#include "vehicle.h"  //NOLINT
+
+// Share of the electricity from the overhead line that reaches the wheels.
+static const double kElectricEfficiency = 0.85;
+static const double kJoulePerKwh = 3.6e6;
+static const SimTime kSecondsPerHour = 60 * 60;
+
+EnergyAccount::EnergyAccount() : total_({0.0, 0.0}) {
+  std::fill(per_type_energy_, per_type_energy_ + 2, 0.0);
+  std::fill(per_type_trips_, per_type_trips_ + 2, 0);
+  std::fill(per_type_km_, per_type_km_ + 2, 0.0);
+}
+
+void EnergyAccount::AddTrip(const Train &train, int distance_m,
+                            SimTime departure, SimTime arrival) {
+  double duration_s = static_cast<double>(arrival - departure);
+  if (distance_m <= 0 || duration_s <= 0.0) return;
+
+  const Consist &consist = train.GetConsist();
+  double mass_tons = consist.mass_tons;
+  double power_kw = consist.power_kw;
+  int vehicles = static_cast<int>(consist.vehicle_ids.size());
+  if (power_kw <= 0.0) return;
+
+  double speed = distance_m / duration_s;
+  double wheel_kwh =
+      (distance_m * RunTimeModel::ResistanceN(mass_tons, vehicles, speed) +
+       0.5 * mass_tons * 1000.0 * RunTimeModel::kRotatingMassFactor * speed *
+           speed) /
+      kJoulePerKwh;
+  double hours = duration_s / kSecondsPerHour;
+
+  EnergyUse use = {0.0, 0.0};
+  std::for_each(
+      train.GetVehicles().begin(), train.GetVehicles().end(),
+      [&](const std::shared_ptr<Vehicle> &vehicle) {
+        double loco_kw = RunTimeModel::PowerKw(*vehicle);
+        if (loco_kw <= 0.0) return;
+        double loco_wheel_kwh =
+            std::min(wheel_kwh * loco_kw / power_kw, loco_kw * hours);
+        int index = vehicle->GetType() == 4 ? 0 : 1;
+        if (index == 0) {
+          double kwh = loco_wheel_kwh / kElectricEfficiency;
+          use.electric_kwh += kwh;
+          per_type_energy_[0] += kwh;
+        } else {
+          double liters = loco_wheel_kwh / RunTimeModel::kDieselKwhPerLiter;
+          use.diesel_liters += liters;
+          per_type_energy_[1] += liters;
+        }
+        per_type_trips_[index]++;
+        per_type_km_[index] += distance_m / 1000.0;
+      });
+
+  total_.electric_kwh += use.electric_kwh;
+  total_.diesel_liters += use.diesel_liters;
+  EnergyUse &train_use = per_train_[train.GetTrainNumber()];
+  train_use.electric_kwh += use.electric_kwh;
+  train_use.diesel_liters += use.diesel_liters;
+  EnergyUse &station_use = per_station_[train.GetDepartureStationId()];
+  station_use.electric_kwh += use.electric_kwh;
+  station_use.diesel_liters += use.diesel_liters;
+  addToHours(departure, arrival, use);
+}
+
+void EnergyAccount::addToHours(SimTime departure, SimTime arrival,
+                               const EnergyUse &use) {
+  if (departure < 0) departure = 0;
+  std::size_t last_hour = static_cast<std::size_t>(arrival / kSecondsPerHour);
+  if (per_hour_.size() <= last_hour) {
+    per_hour_.resize(last_hour + 1, EnergyUse{0.0, 0.0});
+  }
+  double duration = static_cast<double>(arrival - departure);
+  for (SimTime from = departure; from < arrival;) {
+    SimTime hour = from / kSecondsPerHour;
+    SimTime to = std::min(arrival, (hour + 1) * kSecondsPerHour);
+    double share = (to - from) / duration;
+    per_hour_[hour].electric_kwh += use.electric_kwh * share;
+    per_hour_[hour].diesel_liters += use.diesel_liters * share;
+    from = to;
+  }
+}
+
+bool EnergyAccount::GetTrainEnergy(int train_number,
+                                   EnergyUse &use_out) const {
+  auto it = per_train_.find(train_number);
+  if (it == per_train_.end()) return false;
+  use_out = it->second;
+  return true;
+}
+
+static void appendUse(TextBuffer &out, const EnergyUse &use) {
+  out << static_cast<long long>(std::llround(use.electric_kwh))  // NOLINT
+      << " kWh, "
+      << static_cast<long long>(std::llround(use.diesel_liters))  // NOLINT
+      << " l diesel\n";
+}
+
+std::string EnergyAccount::GetReport(const StringTable &station_names,
+                                     bool high_detail_level) const {
+  TextBuffer out(4096);
+  out << "Total energy: ";
+  appendUse(out, total_);
+  out << "Electrical locomotives: "
+      << static_cast<long long>(std::llround(per_type_energy_[0]))  // NOLINT
+      << " kWh, " << per_type_trips_[0] << " trips, "
+      << static_cast<long long>(std::llround(per_type_km_[0]))  // NOLINT
+      << " km\n"
+      << "Diesel locomotives: "
+      << static_cast<long long>(std::llround(per_type_energy_[1]))  // NOLINT
+      << " l, " << per_type_trips_[1] << " trips, "
+      << static_cast<long long>(std::llround(per_type_km_[1]))  // NOLINT
+      << " km\n\nPer departure station:\n";
+  // The stations are listed by name.
+  std::vector<std::pair<const std::string *, const EnergyUse *>> stations;
+  std::for_each(per_station_.begin(), per_station_.end(),
+                [&](const std::pair<const int, EnergyUse> &entry) {
+                  stations.emplace_back(&station_names.Get(entry.first),
+                                        &entry.second);
+                });
+  std::sort(stations.begin(), stations.end(),
+            [](const std::pair<const std::string *, const EnergyUse *> &a,
+               const std::pair<const std::string *, const EnergyUse *> &b) {
+              return *a.first < *b.first;
+            });
+  std::for_each(
+      stations.begin(), stations.end(),
+      [&out](const std::pair<const std::string *, const EnergyUse *> &entry) {
+        std::size_t start = out.Size();
+        out << *entry.first;
+        out.PadFrom(start, 20);
+        appendUse(out, *entry.second);
+      });
+  out << "\nPer hour:\n";
+  for (std::size_t hour = 0; hour < per_hour_.size(); hour++) {
+    const EnergyUse &use = per_hour_[hour];
+    if (use.electric_kwh <= 0.0 && use.diesel_liters <= 0.0) continue;
+    out.AppendTime(static_cast<SimTime>(hour) * kSecondsPerHour) << ' ';
+    appendUse(out, use);
+  }
+  if (high_detail_level) {
+    out << "\nPer train:\n";
+    std::for_each(per_train_.begin(), per_train_.end(),
+                  [&out](const std::pair<const int, EnergyUse> &entry) {
+                    out << "Train: " << entry.first << ' ';
+                    appendUse(out, entry.second);
+                  });
+  }
+  return out.Str();
+}
@@ -5,74 +5,117 @@
 
 #include "event.h" // NOLINT
 
-#include <fstream>
-#include <iostream>
+#include <stdexcept>
 
+#include "profiler.h"  // NOLINT
+#include "simulation_parameters.h"  // NOLINT
 #include "simulator.h"  // NOLINT
 #include "t_s_manager.h" // NOLINT
+#include "text_buffer.h" // NOLINT
 #include "train.h" // NOLINT
 #include "train_time.h" // NOLINT
 
 void Event::Log() {
+  std::shared_ptr<Simulator> simulator = simulator_.lock();
+  PROFILE_SCOPE(simulator->GetProfiler(), ProfileSection::LOG);
+  State &state = simulator->GetLogState();
+  state.event_time_ = event_time_;
+  state.train_number_ = train_->GetTrainNumber();
   state.planed_departure_time_ = train_->GetPlanedDepartureTime();
   state.expected_arrival_time_ = train_->GetExpectedArrivalTime();
   state.average_speed_ = getAverageSpeed();
   state.train_status_ = train_->GetTrainStatus();
   state.connected_vehicles_ = train_->GetConnectedVehicles();
   state.demanded_vehicles_ = train_->GetDemandedVehicles();
-  simulator_.lock()->AddToEventLog(shared_from_this());
-
-  if (event_time_ >= simulator_.lock()->GetStartSimulationTime()) {
-    std::ostringstream oss;
-    if (simulator_.lock()->IsHighDetailLevel()) {
-      oss << "Event time: " << TrainTime::Time_tToString(event_time_) << "\n"
-          << train_->GetDataToLog(true)
-          << " Average speed: " << getAverageSpeed() << " km/h\n";
+  simulator->AddToEventLog(state);
+
+  if (event_time_ >= simulator->GetStartSimulationTime()) {
+    TextBuffer &out = simulator->BeginLogLine();
+    if (simulator->IsHighDetailLevel()) {
+      out << "Event time: ";
+      out.AppendTime(event_time_) << '\n';
+      train_->AppendDataToLog(out, true);
+      out << " Average speed: " << state.average_speed_ << " km/h\n";
     } else {
-      oss << TrainTime::Time_tToString(event_time_) << " "
-          << train_->GetDataToLog(false) << "\n";
+      out.AppendTime(event_time_) << ' ';
+      train_->AppendDataToLog(out, false);
+      out << '\n';
     }
-    std::string log = oss.str();
-    std::ofstream file("Trainsim.log", std::fstream::out | std::fstream::app);
-    if (file.is_open()) {
-      file << oss.str();
-      file.close();
-    }
-    std::cout << log;
+    simulator->CommitLogLine();
+    simulator->ExportEvent(state);
   }
 }
 
-void NotAssembled::Run() {
-  if (train_station_environment_.lock()->TryAssemble(
-          train_->GetTrainNumber())) {
-    train_->SetTrainStatus(TrainStatus::ASSEMBLED);
+void TrainLifecycle::Run() {
+  EventKind next_kind = kind_;
+  SimTime next_time = event_time_;
+  bool resume = false;
+  switch (kind_) {
+    case EventKind::NOT_ASSEMBLED:
+      resume = notAssembled(next_kind, next_time);
+      break;
+    case EventKind::INCOMPLETE:
+      resume = incomplete(next_kind, next_time);
+      break;
+    case EventKind::READY:
+      resume = ready(next_kind, next_time);
+      break;
+    case EventKind::RUNNING:
+      resume = running(next_kind, next_time);
+      break;
+    case EventKind::ARRIVED:
+      resume = arrived(next_kind, next_time);
+      break;
+    case EventKind::FINISHED:
+      resume = finished(next_kind, next_time);
+      break;
+    case EventKind::DISRUPTION:
+      // Only a DisruptionStart has this kind, a lifecycle never gets it.
+      throw std::runtime_error("A train lifecycle can not be a disruption");
+  }
+  // The step is logged with its own time before the event is moved on.
+  Log();
+  if (resume) {
+    kind_ = next_kind;
+    event_time_ = next_time;
+    simulator_.lock()->AddEvent(shared_from_this());
+  }
+}
 
-    std::shared_ptr<Event> event = std::make_shared<Ready>(
-        Ready(train_station_environment_.lock(), simulator_.lock(), train_,
-              event_time_ + (20 * 60)));
-    simulator_.lock()->AddEvent(event);
+bool TrainLifecycle::notAssembled(EventKind &next_kind, SimTime &next_time) {
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::NOT_ASSEMBLED);
+  std::shared_ptr<TrainStationManager> environment =
+      train_station_environment_.lock();
+  const SimulationParameters &parameters = environment->GetParameters();
+  if (environment->TryAssemble(*train_, event_time_)) {
+    train_->SetTrainStatus(TrainStatus::ASSEMBLED);
+    next_kind = EventKind::READY;
+    next_time = event_time_ + parameters.ready_after_s;
   } else {
-    train_->SetPlanedDepartureTime(train_->GetPlanedDepartureTime() +
-                                   (10 * 60));
+    SimTime retry = parameters.retry_interval_s;
+    environment->AddWait(*train_, event_time_, retry);
+    train_->SetPlanedDepartureTime(train_->GetPlanedDepartureTime() + retry);
     train_->SetTrainStatus(TrainStatus::INCOMPLETE);
-
-    std::shared_ptr<Event> event = std::make_shared<Incomplete>(
-        Incomplete(train_station_environment_.lock(), simulator_.lock(), train_,
-                   event_time_ + (10 * 60)));
-    simulator_.lock()->AddEvent(event);
+    next_kind = EventKind::INCOMPLETE;
+    next_time = event_time_ + retry;
   }
-  Log();
+  return true;
 }
 
-void Incomplete::Run() {
-  int potential_duration_s = getPotentialDuration();
+bool TrainLifecycle::incomplete(EventKind &next_kind, SimTime &next_time) {
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::INCOMPLETE);
+  std::shared_ptr<TrainStationManager> environment =
+      train_station_environment_.lock();
+  const SimulationParameters &parameters = environment->GetParameters();
+  int potential_duration_s = environment->GetRunTime(*train_).run_time_s;
   int original_duration_s = static_cast<int>(
       train_->GetOriginalArrivalTime() - train_->GetOriginalDepartureTime());
-  time_t potential_arrival_time =
+  SimTime potential_arrival_time =
       train_->GetPlanedDepartureTime() + potential_duration_s;
 
-  if (train_station_environment_.lock()->TryAssemble(
-          train_->GetTrainNumber())) {
+  if (environment->TryAssemble(*train_, event_time_)) {
     if (potential_arrival_time > train_->GetOriginalArrivalTime()) {
       train_->SetExpectedArrivalTime(potential_arrival_time);
     } else {
@@ -80,106 +123,115 @@ void Incomplete::Run() {
                                      original_duration_s);
     }
     train_->SetTrainStatus(TrainStatus::ASSEMBLED);
-    std::shared_ptr<Event> event = std::make_shared<Ready>(
-        Ready(train_station_environment_.lock(), simulator_.lock(), train_,
-              event_time_ + (20 * 60)));
-    simulator_.lock()->AddEvent(event);
+    next_kind = EventKind::READY;
+    next_time = event_time_ + parameters.ready_after_s;
   } else {
-    train_->SetPlanedDepartureTime(train_->GetPlanedDepartureTime() +
-                                   (10 * 60));
+    SimTime retry = parameters.retry_interval_s;
+    environment->AddWait(*train_, event_time_, retry);
+    train_->SetPlanedDepartureTime(train_->GetPlanedDepartureTime() + retry);
 
     if (potential_arrival_time >= train_->GetOriginalArrivalTime()) {
-      train_->SetExpectedArrivalTime(potential_arrival_time + (10 * 60));
+      train_->SetExpectedArrivalTime(potential_arrival_time + retry);
     } else {
       train_->SetExpectedArrivalTime(train_->GetPlanedDepartureTime() +
-                                     original_duration_s + (10 * 60));
+                                     original_duration_s + retry);
     }
     train_->SetTrainStatus(TrainStatus::INCOMPLETE);
-    std::shared_ptr<Event> event = std::make_shared<Incomplete>(
-        Incomplete(train_station_environment_.lock(), simulator_.lock(), train_,
-                   event_time_ + (10 * 60)));
-    simulator_.lock()->AddEvent(event);
+    next_kind = EventKind::INCOMPLETE;
+    next_time = event_time_ + retry;
   }
-  Log();
+  return true;
 }
 
-int Incomplete::getAccDist_Meter_Second(int max_speed, float acceleration) {
-  int avg_speed = static_cast<int>(static_cast<float>(max_speed) / 2);
-  return static_cast<int>(static_cast<float>(avg_speed) *
-                          static_cast<float>(avg_speed) / acceleration);
-}
-int Incomplete::getPotentialDuration() {
-  int max_speed = train_->GetTrainMaxSpeed();
-  if (train_->GetTrainStatus() != TrainStatus::NOT_ASSEMBLED &&
-      train_->GetTrainStatus() != TrainStatus::INCOMPLETE) {
-    int challenger = train_->GetVehicleMaxSpeed();
-    if (challenger < max_speed) max_speed = challenger;
-  }
-  int max_speed_m_s = static_cast<int>(static_cast<float>(max_speed) / 3.6);
-
-  int distance_m =
-      1000 * train_station_environment_.lock()->GetDistanceFrom(
-                 train_->GetDepartureStation(), train_->GetArrivalStation());
-  int acc_time = getAccDist_Meter_Second(max_speed_m_s, acceleration);
-  int dec_time = getAccDist_Meter_Second(max_speed_m_s, deceleration);
-  int dist_full_speed = distance_m - acc_time + dec_time;
-  return (2 * acc_time + 2 * dec_time + dist_full_speed) / max_speed_m_s;
-}
-
-void Ready::Run() {
+bool TrainLifecycle::ready(EventKind &next_kind, SimTime &next_time) {
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::READY);
+  std::shared_ptr<TrainStationManager> environment =
+      train_station_environment_.lock();
   train_->SetTrainStatus(TrainStatus::READY);
-  std::shared_ptr<Event> event = std::make_shared<Running>(
-      Running(train_station_environment_.lock(), simulator_.lock(), train_,
-              event_time_ + (10 * 60)));
-  simulator_.lock()->AddEvent(event);
-  Log();
+  next_kind = EventKind::RUNNING;
+  next_time = event_time_ + environment->GetParameters().depart_after_s;
+  // A train does not depart onto a closed route, it is held until the route
+  // opens and its arrival is planned again from there.
+  SimTime departure =
+      environment->HoldDeparture(*train_, next_time, event_time_);
+  if (departure != next_time) {
+    train_->SetPlanedDepartureTime(departure);
+    train_->SetExpectedArrivalTime(
+        environment->PlanArrival(*train_, departure));
+    next_time = departure;
+  }
+  return true;
 }
 
-void Running::Run() {
+bool TrainLifecycle::running(EventKind &next_kind, SimTime &next_time) {
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::RUNNING);
   train_->SetTrainStatus(TrainStatus::RUNNING);
+  int restricted_s;
+  if (train_station_environment_.lock()->GetRestrictedRunTime(
+          *train_, event_time_, restricted_s) &&
+      event_time_ + restricted_s > train_->GetExpectedArrivalTime()) {
+    train_->SetExpectedArrivalTime(event_time_ + restricted_s);
+  }
   if (train_->GetOriginalDepartureTime() != train_->GetPlanedDepartureTime()) {
     simulator_.lock()->AddToDepartureDelay(train_->GetPlanedDepartureTime() -
                                            train_->GetOriginalDepartureTime());
   }
-  std::shared_ptr<Event> event = std::make_shared<Arrived>(
-      train_station_environment_.lock(), simulator_.lock(), train_,
-      train_->GetExpectedArrivalTime());
-  simulator_.lock()->AddEvent(event);
-  Log();
+  next_kind = EventKind::ARRIVED;
+  next_time = train_->GetExpectedArrivalTime();
+  return true;
 }
 
-int Running::getAverageSpeed() {
+int TrainLifecycle::getAverageSpeed() {
+  if (kind_ != EventKind::RUNNING) return 0;
   int duration =
       train_->GetExpectedArrivalTime() - train_->GetPlanedDepartureTime();
   int distance_m =
-      1000 * train_station_environment_.lock()->GetDistanceFrom(
-                 train_->GetDepartureStation(), train_->GetArrivalStation());
+      train_station_environment_.lock()->GetRunTime(*train_).distance_m;
   float m_per_s = static_cast<float>(distance_m) / static_cast<float>(duration);
   return static_cast<int>(m_per_s * 3.6);
 }
 
-void Arrived::Run() {
+bool TrainLifecycle::arrived(EventKind &next_kind, SimTime &next_time) {
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::ARRIVED);
   train_->SetTrainStatus(TrainStatus::ARRIVED);
   if (train_->GetOriginalArrivalTime() != train_->GetExpectedArrivalTime()) {
     simulator_.lock()->AddToDelay(train_->GetExpectedArrivalTime() -
                                   train_->GetOriginalArrivalTime());
   }
-  std::shared_ptr<Event> event = std::make_shared<Finished>(
-      Finished(train_station_environment_.lock(), simulator_.lock(), train_,
-               event_time_ + (20 * 60)));
-  simulator_.lock()->AddEvent(event);
-  Log();
+  int distance_m =
+      train_station_environment_.lock()->GetRunTime(*train_).distance_m;
+  simulator_.lock()->GetEnergyAccount().AddTrip(
+      *train_, distance_m, train_->GetPlanedDepartureTime(), event_time_);
+  simulator_.lock()->GetThroughputAccount().AddTrip(*train_, distance_m);
+  next_kind = EventKind::FINISHED;
+  next_time = event_time_ +
+              train_station_environment_.lock()->GetParameters().turnaround_s;
+  return true;
 }
 
-void Finished::Run() {
-  train_station_environment_.lock()->DisAssemble(train_->GetTrainNumber());
+// The lifecycle ends here, so there is no next step to set.
+bool TrainLifecycle::finished(EventKind &, SimTime &) {  // NOLINT
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::FINISHED);
+  train_station_environment_.lock()->DisAssemble(*train_, event_time_);
   train_->SetTrainStatus(TrainStatus::FINISHED);
-  Log();
+  return false;
+}
+
+void DisruptionStart::Run() {
+  PROFILE_SCOPE(simulator_.lock()->GetProfiler(),
+                ProfileSection::DISRUPTION);
+  train_station_environment_.lock()->ApplyDisruption(index_, event_time_);
 }
 
+void VehicleReturn::Run() {
+  train_station_environment_.lock()->ReturnVehicle(station_, vehicle_id_);
+}
+
+void EndOfRun::Run() {}
+
 TrainStatus Event::GetTrainStatus() { return train_->GetTrainStatus(); }
 std::shared_ptr<Train> &Event::GetTrain() { return train_; }
-bool EventCompare::operator()(const std::shared_ptr<Event> &first,
-                              const std::shared_ptr<Event> &second) {
-  return first->GetEventTime() > second->GetEventTime();
-}
@@ -0,0 +1,132 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "event_log.h"  //NOLINT
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "event_sink.h"  //NOLINT
+
+EventLog::EventLog()
+    : policy_(RetentionPolicy::KEEP_ALL),
+      capacity_(0),
+      spilled_(0),
+      dropped_(0) {}
+
+EventLog::~EventLog() {
+  if (spill_) {
+    spill_.reset();
+    std::remove(spill_path_.c_str());
+  }
+}
+
+void EventLog::SetRetentionPolicy(RetentionPolicy policy,
+                                  std::size_t capacity,
+                                  const std::string &spill_path) {
+  policy_ = policy;
+  capacity_ = std::max<std::size_t>(capacity, 1);
+  if (policy_ == RetentionPolicy::SPILL_TO_DISK && !spill_) {
+    spill_path_ = spill_path;
+    spill_ = std::make_shared<BinaryEventSink>(spill_path_);
+  }
+  if (policy_ == RetentionPolicy::RING_BUFFER) {
+    while (entries_.size() > capacity_) dropOldest();
+  } else if (policy_ == RetentionPolicy::SPILL_TO_DISK &&
+             entries_.size() >= capacity_) {
+    spill();
+  }
+}
+
+void EventLog::Add(const State &state) {
+  entries_.push_back({state.event_time_, state.train_number_,
+                      state.train_status_, state.planed_departure_time_,
+                      state.expected_arrival_time_, state.average_speed_,
+                      static_cast<int>(state.connected_vehicles_.size()),
+                      static_cast<int>(state.demanded_vehicles_.size())});
+  vehicle_ids_.insert(vehicle_ids_.end(), state.connected_vehicles_.begin(),
+                      state.connected_vehicles_.end());
+  vehicle_ids_.insert(vehicle_ids_.end(), state.demanded_vehicles_.begin(),
+                      state.demanded_vehicles_.end());
+  if (policy_ == RetentionPolicy::RING_BUFFER && entries_.size() > capacity_) {
+    dropOldest();
+  } else if (policy_ == RetentionPolicy::SPILL_TO_DISK &&
+             entries_.size() >= capacity_) {
+    spill();
+  }
+}
+
+void EventLog::dropOldest() {
+  const Entry &entry = entries_.front();
+  int ids = entry.connected_vehicles + entry.demanded_vehicles;
+  vehicle_ids_.erase(vehicle_ids_.begin(), vehicle_ids_.begin() + ids);
+  entries_.pop_front();
+  dropped_++;
+}
+
+void EventLog::spill() {
+  forEachInMemory([this](const State &state) { spill_->Write(state); });
+  spill_->Flush();
+  spilled_ += entries_.size();
+  entries_.clear();
+  entries_.shrink_to_fit();
+  vehicle_ids_.clear();
+  vehicle_ids_.shrink_to_fit();
+}
+
+void EventLog::ForEach(const std::function<void(const State &)> &action) {
+  if (spilled_ > 0) forEachSpilled(action);
+  forEachInMemory(action);
+}
+
+void EventLog::forEachInMemory(
+    const std::function<void(const State &)> &action) const {
+  State state;
+  auto ids = vehicle_ids_.begin();
+  std::for_each(entries_.begin(), entries_.end(), [&](const Entry &entry) {
+    state.event_time_ = entry.event_time;
+    state.train_number_ = entry.train_number;
+    state.train_status_ = entry.train_status;
+    state.planed_departure_time_ = entry.planed_departure_time;
+    state.expected_arrival_time_ = entry.expected_arrival_time;
+    state.average_speed_ = entry.average_speed;
+    state.connected_vehicles_.assign(ids, ids + entry.connected_vehicles);
+    ids += entry.connected_vehicles;
+    state.demanded_vehicles_.assign(ids, ids + entry.demanded_vehicles);
+    ids += entry.demanded_vehicles;
+    action(state);
+  });
+}
+
+bool EventLog::forEachSpilled(
+    const std::function<void(const State &)> &action) {
+  int fd = open(spill_path_.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  std::size_t size = static_cast<std::size_t>(file_stat.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return false;
+  const char *data = static_cast<const char *>(mapping);
+  std::size_t offset = sizeof(BinaryEventSink::kMagic);
+  bool valid = size >= offset && std::memcmp(data, BinaryEventSink::kMagic,
+                                             offset) == 0;
+  State state;
+  while (valid && BinaryEventSink::Read(data, size, offset, state)) {
+    action(state);
+  }
+  munmap(mapping, size);
+  return valid;
+}
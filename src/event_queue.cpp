@@ -0,0 +1,121 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "event_queue.h"  //NOLINT
+
+#include <utility>
+
+#include "event.h"  //NOLINT
+
+EventHandle EventQueue::Push(const std::shared_ptr<Event> &event) {
+  std::uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<std::uint32_t>(slots_.size());
+    slots_.push_back(Slot{0, 0});
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  slots_[slot].generation++;
+  heap_.push_back(
+      Entry{event->GetEventTime(), event->GetSequence(), slot, event});
+  slots_[slot].index = heap_.size() - 1;
+  siftUp(heap_.size() - 1);
+  return EventHandle(slot, slots_[slot].generation);
+}
+
+std::shared_ptr<Event> EventQueue::Pop() { return remove(0).event; }
+
+bool EventQueue::Contains(EventHandle handle) const {
+  std::size_t index;
+  return find(handle, index);
+}
+
+bool EventQueue::Cancel(EventHandle handle) {
+  std::size_t index;
+  if (!find(handle, index)) return false;
+  remove(index);
+  return true;
+}
+
+bool EventQueue::Reschedule(EventHandle handle, SimTime time,
+                            std::uint64_t sequence) {
+  std::size_t index;
+  if (!find(handle, index)) return false;
+  Entry &entry = heap_[index];
+  bool earlier = time < entry.time ||
+                 (time == entry.time && sequence < entry.sequence);
+  entry.time = time;
+  entry.sequence = sequence;
+  entry.event->SetEventTime(time);
+  entry.event->SetSequence(sequence);
+  if (earlier) {
+    siftUp(index);
+  } else {
+    siftDown(index);
+  }
+  return true;
+}
+
+bool EventQueue::find(EventHandle handle, std::size_t &index_out) const {
+  if (handle.slot >= slots_.size()) return false;
+  const Slot &slot = slots_[handle.slot];
+  // An even generation is a free slot, which no handle names.
+  if (slot.generation != handle.generation || slot.generation % 2 == 0) {
+    return false;
+  }
+  index_out = slot.index;
+  return true;
+}
+
+void EventQueue::place(std::size_t index, Entry &&entry) {
+  slots_[entry.slot].index = index;
+  heap_[index] = std::move(entry);
+}
+
+void EventQueue::siftUp(std::size_t index) {
+  Entry entry = std::move(heap_[index]);
+  while (index > 0) {
+    std::size_t parent = (index - 1) / 2;
+    if (!before(entry, heap_[parent])) break;
+    place(index, std::move(heap_[parent]));
+    index = parent;
+  }
+  place(index, std::move(entry));
+}
+
+void EventQueue::siftDown(std::size_t index) {
+  Entry entry = std::move(heap_[index]);
+  std::size_t size = heap_.size();
+  while (true) {
+    std::size_t child = 2 * index + 1;
+    if (child >= size) break;
+    if (child + 1 < size && before(heap_[child + 1], heap_[child])) child++;
+    if (!before(heap_[child], entry)) break;
+    place(index, std::move(heap_[child]));
+    index = child;
+  }
+  place(index, std::move(entry));
+}
+
+EventQueue::Entry EventQueue::remove(std::size_t index) {
+  Entry entry = std::move(heap_[index]);
+  slots_[entry.slot].generation++;
+  free_slots_.push_back(entry.slot);
+  std::size_t last = heap_.size() - 1;
+  if (index != last) {
+    place(index, std::move(heap_[last]));
+    heap_.pop_back();
+    // The moved entry may belong above or below its new place.
+    if (index > 0 && before(heap_[index], heap_[(index - 1) / 2])) {
+      siftUp(index);
+    } else {
+      siftDown(index);
+    }
+  } else {
+    heap_.pop_back();
+  }
+  return entry;
+}
@@ -0,0 +1,192 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "event_sink.h"  //NOLINT
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "event.h"  //NOLINT
+#include "train.h"  //NOLINT
+
+const char BinaryEventSink::kMagic[8] = {'T', 'R', 'N', 'E', 'V', 'T', '1', 0};
+
+EventSink::EventSink(const std::string &path, bool binary)
+    : file_(path, binary ? std::fstream::out | std::fstream::binary
+                         : std::fstream::out) {
+  if (!file_.is_open()) {
+    throw std::runtime_error("Could not create file " + path);
+  }
+}
+
+std::shared_ptr<EventSink> EventSink::Create(ExportFormat format,
+                                             const std::string &path) {
+  switch (format) {
+    case ExportFormat::CSV:
+      return std::make_shared<CsvEventSink>(path);
+    case ExportFormat::JSON_LINES:
+      return std::make_shared<JsonLinesEventSink>(path);
+    case ExportFormat::BINARY:
+      return std::make_shared<BinaryEventSink>(path);
+  }
+  return nullptr;
+}
+
+bool EventSink::ParseFormat(const std::string &name,
+                            ExportFormat &format_out) {
+  if (name == "csv") {
+    format_out = ExportFormat::CSV;
+  } else if (name == "jsonl") {
+    format_out = ExportFormat::JSON_LINES;
+  } else if (name == "bin") {
+    format_out = ExportFormat::BINARY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+CsvEventSink::CsvEventSink(const std::string &path) : EventSink(path, false) {
+  file_ << "event_time,train_number,status,planed_departure_time,"
+           "expected_arrival_time,average_speed,connected_vehicles,"
+           "demanded_vehicles\n";
+}
+
+void CsvEventSink::Write(const State &state) {
+  line_.Clear();
+  line_ << state.event_time_ << ',' << state.train_number_ << ','
+        << TrainStatusName(state.train_status_) << ','
+        << state.planed_departure_time_ << ',' << state.expected_arrival_time_
+        << ',' << state.average_speed_ << ',';
+  for (std::size_t i = 0; i < state.connected_vehicles_.size(); i++) {
+    if (i != 0) line_ << ';';
+    line_ << state.connected_vehicles_[i];
+  }
+  line_ << ',';
+  for (std::size_t i = 0; i < state.demanded_vehicles_.size(); i++) {
+    if (i != 0) line_ << ';';
+    line_ << state.demanded_vehicles_[i];
+  }
+  line_ << '\n';
+  file_.write(line_.Data(), line_.Size());
+}
+
+void JsonLinesEventSink::Write(const State &state) {
+  line_.Clear();
+  line_ << "{\"event_time\":" << state.event_time_
+        << ",\"train_number\":" << state.train_number_ << ",\"status\":\""
+        << TrainStatusName(state.train_status_)
+        << "\",\"planed_departure_time\":" << state.planed_departure_time_
+        << ",\"expected_arrival_time\":" << state.expected_arrival_time_
+        << ",\"average_speed\":" << state.average_speed_
+        << ",\"connected_vehicles\":[";
+  for (std::size_t i = 0; i < state.connected_vehicles_.size(); i++) {
+    if (i != 0) line_ << ',';
+    line_ << state.connected_vehicles_[i];
+  }
+  line_ << "],\"demanded_vehicles\":[";
+  for (std::size_t i = 0; i < state.demanded_vehicles_.size(); i++) {
+    if (i != 0) line_ << ',';
+    line_ << state.demanded_vehicles_[i];
+  }
+  line_ << "]}\n";
+  file_.write(line_.Data(), line_.Size());
+}
+
+BinaryEventSink::BinaryEventSink(const std::string &path)
+    : EventSink(path, true) {
+  file_.write(kMagic, sizeof(kMagic));
+}
+
+/** Appends value as little endian, independent of the host byte order. */
+static void appendLittleEndian(TextBuffer &out, std::uint64_t value,
+                               int bytes) {
+  char data[8];
+  for (int i = 0; i < bytes; i++) {
+    data[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+  out.Append(data, bytes);
+}
+
+void BinaryEventSink::Write(const State &state) {
+  line_.Clear();
+  // Room for the length, it is filled in when the record is complete.
+  appendLittleEndian(line_, 0, 4);
+  appendLittleEndian(line_, static_cast<std::uint64_t>(state.event_time_), 8);
+  appendLittleEndian(line_, static_cast<std::uint32_t>(state.train_number_),
+                     4);
+  appendLittleEndian(line_, static_cast<std::uint8_t>(state.train_status_), 1);
+  appendLittleEndian(
+      line_, static_cast<std::uint64_t>(state.planed_departure_time_), 8);
+  appendLittleEndian(
+      line_, static_cast<std::uint64_t>(state.expected_arrival_time_), 8);
+  appendLittleEndian(line_, static_cast<std::uint32_t>(state.average_speed_),
+                     4);
+  appendLittleEndian(line_, state.connected_vehicles_.size(), 4);
+  for (std::size_t i = 0; i < state.connected_vehicles_.size(); i++) {
+    appendLittleEndian(
+        line_, static_cast<std::uint32_t>(state.connected_vehicles_[i]), 4);
+  }
+  appendLittleEndian(line_, state.demanded_vehicles_.size(), 4);
+  for (std::size_t i = 0; i < state.demanded_vehicles_.size(); i++) {
+    appendLittleEndian(
+        line_, static_cast<std::uint8_t>(state.demanded_vehicles_[i]), 1);
+  }
+  std::uint32_t length = static_cast<std::uint32_t>(line_.Size() - 4);
+  char length_data[4];
+  for (int i = 0; i < 4; i++) {
+    length_data[i] = static_cast<char>((length >> (8 * i)) & 0xff);
+  }
+  line_.Replace(0, length_data, 4);
+  file_.write(line_.Data(), line_.Size());
+}
+
+/** Reads a little endian value of the given size. */
+static std::uint64_t readLittleEndian(const char *data, int bytes) {
+  std::uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+bool BinaryEventSink::Read(const char *data, std::size_t size,
+                           std::size_t &offset, State &state_out) {
+  // Event time to number of connected vehicles, see the format description.
+  const std::size_t kFixedSize = 8 + 4 + 1 + 8 + 8 + 4 + 4;
+  if (offset + 4 > size) return false;
+  std::size_t length = readLittleEndian(data + offset, 4);
+  if (length < kFixedSize + 4 || offset + 4 + length > size) return false;
+  const char *record = data + offset + 4;
+  const char *end = record + length;
+  state_out.event_time_ = static_cast<SimTime>(readLittleEndian(record, 8));
+  state_out.train_number_ = static_cast<int>(readLittleEndian(record + 8, 4));
+  state_out.train_status_ =
+      static_cast<TrainStatus>(readLittleEndian(record + 12, 1));
+  state_out.planed_departure_time_ =
+      static_cast<SimTime>(readLittleEndian(record + 13, 8));
+  state_out.expected_arrival_time_ =
+      static_cast<SimTime>(readLittleEndian(record + 21, 8));
+  state_out.average_speed_ = static_cast<int>(readLittleEndian(record + 29, 4));
+  std::size_t connected = readLittleEndian(record + 33, 4);
+  record += kFixedSize;
+  if (static_cast<std::size_t>(end - record) < connected * 4 + 4) return false;
+  state_out.connected_vehicles_.resize(connected);
+  for (std::size_t i = 0; i < connected; i++, record += 4) {
+    state_out.connected_vehicles_[i] =
+        static_cast<int>(readLittleEndian(record, 4));
+  }
+  std::size_t demanded = readLittleEndian(record, 4);
+  record += 4;
+  if (static_cast<std::size_t>(end - record) < demanded) return false;
+  state_out.demanded_vehicles_.resize(demanded);
+  for (std::size_t i = 0; i < demanded; i++, record++) {
+    state_out.demanded_vehicles_[i] =
+        static_cast<int>(readLittleEndian(record, 1));
+  }
+  offset += 4 + length;
+  return true;
+}
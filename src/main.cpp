@@ -3,21 +3,138 @@
  * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
  */
 
+#include <cstdlib>
 #include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "app.h"  // NOLINT
+#include "event_log.h"  // NOLINT
+#include "event_sink.h"  // NOLINT
+#include "parameter_sweep.h"  // NOLINT
+#include "simulation_parameters.h"  // NOLINT
 #include "memstat.hpp"
 
-int main() {
+static const char kUsage[] =
+    "Usage: Trains [--data DIR] [--headless] [--quiet]"
+    " [--export csv|jsonl|bin FILE]... [--keep-events N | --spill-events N]"
+    " [--serve SOCKET] [--realtime SPEEDUP] [--disruptions FILE]"
+    " [--what-if TRAIN TIME]... [--set NAME=VALUE]..."
+    " [--sweep NAME=LOW:HIGH[:STEPS],... [--samples N [--seed N]] [--jobs N]]"
+    " [--optimize WINDOW [--rounds N] [--seed N] [--jobs N]]";
+
+int main(int argc, char *argv[]) {
   {
     try {
-      App app("../train-data/TrainStations.txt",
-              "../train-data/Trains.txt",
-              "../train-data/TrainMap.txt");
+      std::string data_path = "../train-data";
+      bool headless = false;
+      bool quiet = false;
+      std::list<std::pair<ExportFormat, std::string>> exports;
+      RetentionPolicy retention = RetentionPolicy::KEEP_ALL;
+      int retention_capacity = 0;
+      std::string serve_path;
+      std::string disruptions_path;
+      int real_time_speedup = 0;
+      std::vector<DepartureEdit> what_if;
+      SimulationParameters parameters;
+      std::string sweep_spec;
+      int sweep_samples = 0;
+      int sweep_jobs = 0;
+      unsigned seed = 1;
+      int optimize_window = 0;
+      int optimize_rounds = 20;
+      for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        ExportFormat format;
+        SimTime departure;
+        if (arg == "--headless") {
+          headless = true;
+        } else if (arg == "--quiet") {
+          quiet = true;
+        } else if ((arg == "--keep-events" || arg == "--spill-events") &&
+                   i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+          retention = arg == "--keep-events" ? RetentionPolicy::RING_BUFFER
+                                             : RetentionPolicy::SPILL_TO_DISK;
+          retention_capacity = std::atoi(argv[++i]);
+        } else if (arg == "--realtime" && i + 1 < argc &&
+                   std::atoi(argv[i + 1]) > 0) {
+          real_time_speedup = std::atoi(argv[++i]);
+        } else if (arg == "--serve" && i + 1 < argc) {
+          serve_path = argv[++i];
+        } else if (arg == "--disruptions" && i + 1 < argc) {
+          disruptions_path = argv[++i];
+        } else if (arg == "--what-if" && i + 2 < argc &&
+                   std::atoi(argv[i + 1]) > 0 &&
+                   TrainTime::ParseSimTime(argv[i + 2], departure)) {
+          what_if.push_back(DepartureEdit{std::atoi(argv[i + 1]), departure});
+          i += 2;
+        } else if (arg == "--set" && i + 1 < argc) {
+          parameters.SetFromText(argv[++i]);
+        } else if (arg == "--sweep" && i + 1 < argc) {
+          sweep_spec = argv[++i];
+        } else if ((arg == "--samples" || arg == "--jobs") && i + 1 < argc &&
+                   std::atoi(argv[i + 1]) > 0) {
+          (arg == "--samples" ? sweep_samples : sweep_jobs) =
+              std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc &&
+                   std::atoi(argv[i + 1]) > 0) {
+          seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if ((arg == "--optimize" || arg == "--rounds") &&
+                   i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+          (arg == "--optimize" ? optimize_window : optimize_rounds) =
+              std::atoi(argv[++i]);
+        } else if (arg == "--data" && i + 1 < argc) {
+          data_path = argv[++i];
+        } else if (arg == "--export" && i + 2 < argc &&
+                   EventSink::ParseFormat(argv[i + 1], format)) {
+          exports.emplace_back(format, argv[i + 2]);
+          i += 2;
+        } else {
+          throw std::runtime_error(kUsage);
+        }
+      }
+
+      if (!sweep_spec.empty()) {
+        ParameterSweep sweep(data_path + "/TrainStations.txt",
+                             data_path + "/Trains.txt",
+                             data_path + "/TrainMap.txt", parameters);
+        sweep.SetRanges(sweep_spec);
+        if (!disruptions_path.empty()) sweep.SetDisruptions(disruptions_path);
+        std::vector<SimulationParameters> combinations =
+            sweep_samples > 0 ? sweep.LatinHypercube(sweep_samples, seed)
+                              : sweep.Grid();
+        std::cout << ParameterSweep::FormatTable(
+            sweep.Run(combinations, static_cast<std::size_t>(sweep_jobs)));
+        return 0;
+      }
+
+      App app(data_path + "/TrainStations.txt",
+              data_path + "/Trains.txt",
+              data_path + "/TrainMap.txt");
+      app.SetConsoleLog(!quiet);
+      app.SetParameters(parameters);
+      app.SetEventLogRetention(retention, retention_capacity);
+      for (auto &e : exports) app.AddEventExport(e.first, e.second);
+      if (!serve_path.empty()) app.SetServePath(serve_path);
+      if (real_time_speedup > 0) app.SetRealTime(real_time_speedup);
+      if (!disruptions_path.empty()) app.LoadDisruptions(disruptions_path);
+      for (const DepartureEdit &edit : what_if) app.AddWhatIf(edit);
+      if (optimize_window > 0) {
+        app.SetOptimizer(optimize_window * 60, optimize_rounds,
+                         static_cast<std::size_t>(sweep_jobs), seed);
+      }
 
-      app.Run();
+      if (headless) {
+        app.RunHeadless();
+      } else {
+        app.Run();
+      }
     } catch (const std::exception& e) {
       std::cout << e.what() << "\n";
+      return EXIT_FAILURE;
     }
   }
 }
@@ -0,0 +1,88 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "paced_clock.h"  //NOLINT
+
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "text_buffer.h"  //NOLINT
+
+static const std::int64_t kNsPerSecond = 1000000000;
+
+PacedClock::PacedClock(SimTime start_time, int speedup)
+    : start_time_(start_time), speedup_(speedup), start_ns_(Now()) {}
+
+std::int64_t PacedClock::Now() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<std::int64_t>(now.tv_sec) * kNsPerSecond + now.tv_nsec;
+}
+
+void PacedClock::SleepUntil(std::int64_t ns) {
+  timespec until;
+  until.tv_sec = static_cast<time_t>(ns / kNsPerSecond);
+  until.tv_nsec = static_cast<long>(ns % kNsPerSecond);  // NOLINT
+  // An absolute wait does not drift when it is interrupted and started
+  // again, and it returns at once if the time has passed.
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) ==
+         EINTR) {
+  }
+}
+
+std::int64_t PacedClock::WallTimeOf(SimTime time) const {
+  return start_ns_ + (time - start_time_) * kNsPerSecond / speedup_;
+}
+
+SimTime PacedClock::SimTimeAt(std::int64_t ns) const {
+  return start_time_ + (ns - start_ns_) * speedup_ / kNsPerSecond;
+}
+
+std::uint64_t PacedClock::TickAt(std::int64_t ns) const {
+  if (ns <= start_ns_) return 0;
+  return static_cast<std::uint64_t>((ns - start_ns_) / kTickNs);
+}
+
+std::int64_t PacedClock::WallTimeOfTick(std::uint64_t tick) const {
+  return start_ns_ + static_cast<std::int64_t>(tick) * kTickNs;
+}
+
+std::string LagStats::GetReport(int speedup) const {
+  TextBuffer out(256);
+  out << "Paced at " << speedup << "x, " << static_cast<long long>(  // NOLINT
+                                                  lags_ns_.size())
+      << " event times";
+  if (lags_ns_.empty()) {
+    out << '\n';
+    return out.Str();
+  }
+  std::vector<std::int64_t> sorted(lags_ns_);
+  std::sort(sorted.begin(), sorted.end());
+  auto percentile = [&sorted](double fraction) {
+    std::size_t index =
+        static_cast<std::size_t>(fraction * (sorted.size() - 1));
+    return static_cast<long long>(sorted[index] / 1000);  // NOLINT
+  };
+  std::int64_t late_ns = kLateNs;
+  std::size_t late = static_cast<std::size_t>(
+      sorted.end() -
+      std::upper_bound(sorted.begin(), sorted.end(), late_ns));
+  out << ", lag p50 " << percentile(0.5) << " us, p99 " << percentile(0.99)
+      << " us, max " << percentile(1.0) << " us\n";
+  if (late > 0) {
+    // The simulation could not keep up, the lag in simulated time is how far
+    // the trains were behind the clock on the wall.
+    out << "Could not keep up: " << static_cast<long long>(late)  // NOLINT
+        << " event times more than "
+        << static_cast<long long>(late_ns / 1000000)  // NOLINT
+        << " ms late, at most "
+        << static_cast<long long>(sorted.back() * speedup /  // NOLINT
+                                  kNsPerSecond)
+        << " s of simulated time behind\n";
+  }
+  return out.Str();
+}
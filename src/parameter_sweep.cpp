@@ -0,0 +1,227 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "parameter_sweep.h"  //NOLINT
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "simulator.h"  //NOLINT
+#include "t_s_manager.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+
+ParameterSweep::ParameterSweep(const std::string &station_path,
+                               const std::string &trains_path,
+                               const std::string &map_path,
+                               const SimulationParameters &base)
+    : station_path_(station_path),
+      trains_path_(trains_path),
+      map_path_(map_path),
+      base_(base) {}
+
+static bool parseNumber(const std::string &text, double &out) {  // NOLINT
+  char *end;
+  out = std::strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+void ParameterSweep::SetRanges(const std::string &spec) {
+  std::vector<ParameterRange> ranges;
+  std::stringstream items(spec);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    std::string::size_type equals = item.find('=');
+    std::string::size_type colon = item.find(':', equals);
+    std::string::size_type second_colon =
+        colon == std::string::npos ? colon : item.find(':', colon + 1);
+    ParameterRange range = {item.substr(0, equals), 0.0, 0.0, 3};
+    double steps = range.steps;
+    SimulationParameters check;
+    bool valid =
+        equals != std::string::npos && colon != std::string::npos &&
+        parseNumber(item.substr(equals + 1, colon - equals - 1), range.low) &&
+        parseNumber(item.substr(colon + 1, second_colon - colon - 1),
+                    range.high) &&
+        (second_colon == std::string::npos ||
+         parseNumber(item.substr(second_colon + 1), steps)) &&
+        steps >= 1 && steps == static_cast<int>(steps) &&
+        range.low <= range.high && check.Set(range.name, range.low) &&
+        check.Set(range.name, range.high);
+    if (!valid) {
+      throw std::runtime_error(
+          "Invalid range " + item +
+          ", use NAME=LOW:HIGH[:STEPS] with ready, depart, retry or "
+          "turnaround in minutes or acceleration in m/s^2");
+    }
+    range.steps = static_cast<int>(steps);
+    if (std::any_of(ranges.begin(), ranges.end(),
+                    [&range](const ParameterRange &other) {
+                      return other.name == range.name;
+                    })) {
+      throw std::runtime_error("The range of " + range.name +
+                               " is given twice");
+    }
+    ranges.push_back(range);
+  }
+  if (ranges.empty()) throw std::runtime_error("No ranges in " + spec);
+  ranges_ = ranges;
+}
+
+SimulationParameters ParameterSweep::withValues(
+    const std::vector<double> &values) const {
+  SimulationParameters parameters = base_;
+  for (std::size_t i = 0; i < ranges_.size(); i++) {
+    parameters.Set(ranges_[i].name, values[i]);
+  }
+  return parameters;
+}
+
+std::vector<SimulationParameters> ParameterSweep::Grid() const {
+  std::vector<SimulationParameters> combinations;
+  std::vector<int> step(ranges_.size(), 0);
+  std::vector<double> values(ranges_.size());
+  // Counts through the steps like an odometer, the last range fastest.
+  for (;;) {
+    for (std::size_t i = 0; i < ranges_.size(); i++) {
+      const ParameterRange &range = ranges_[i];
+      values[i] = range.steps == 1
+                      ? range.low
+                      : range.low + step[i] * (range.high - range.low) /
+                                        (range.steps - 1);
+    }
+    combinations.push_back(withValues(values));
+    std::size_t i = ranges_.size();
+    while (i > 0 && ++step[i - 1] == ranges_[i - 1].steps) step[--i] = 0;
+    if (i == 0) break;
+  }
+  return combinations;
+}
+
+std::vector<SimulationParameters> ParameterSweep::LatinHypercube(
+    int samples, unsigned seed) const {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> within(0.0, 1.0);
+  std::vector<std::vector<double>> values(samples,
+                                          std::vector<double>(ranges_.size()));
+  std::vector<int> strata(samples);
+  for (std::size_t i = 0; i < ranges_.size(); i++) {
+    const ParameterRange &range = ranges_[i];
+    std::iota(strata.begin(), strata.end(), 0);
+    std::shuffle(strata.begin(), strata.end(), random);
+    for (int k = 0; k < samples; k++) {
+      values[k][i] = range.low + (strata[k] + within(random)) *
+                                     (range.high - range.low) / samples;
+    }
+  }
+  std::vector<SimulationParameters> combinations;
+  combinations.reserve(samples);
+  for (int k = 0; k < samples; k++) {
+    combinations.push_back(withValues(values[k]));
+  }
+  return combinations;
+}
+
+SweepResult ParameterSweep::runOne(
+    const SimulationParameters &parameters) const {
+  auto simulator = std::make_shared<Simulator>(false);
+  simulator->SetConsoleLog(false);
+  auto manager = std::make_shared<TrainStationManager>(
+      simulator, station_path_, trains_path_, map_path_);
+  manager->SetParameters(parameters);
+  if (!disruptions_path_.empty()) manager->LoadDisruptions(disruptions_path_);
+  manager->Setup();
+  simulator->SetCurrentTime(simulator->GetStopSimulationTime());
+  simulator->RunEventsUntilTime();
+  return SweepResult{parameters, simulator->GetTotalDelay(),
+                     manager->CountTrainsStuckAtStation(),
+                     manager->CountTrainsThatArrivedInTime(),
+                     static_cast<int>(manager->GetNumberOfTrains())};
+}
+
+std::vector<SweepResult> ParameterSweep::Run(
+    const std::vector<SimulationParameters> &combinations,
+    std::size_t jobs) const {
+  std::vector<SweepResult> results(combinations.size());
+  std::vector<std::exception_ptr> errors(combinations.size());
+  std::atomic<std::size_t> next_run(0);
+
+  auto worker = [&]() {
+    for (std::size_t i = next_run++; i < combinations.size(); i = next_run++) {
+      try {
+        results[i] = runOne(combinations[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  if (jobs == 0) {
+    unsigned cores = std::thread::hardware_concurrency();
+    jobs = cores == 0 ? 1 : cores;
+  }
+  std::vector<std::thread> pool;
+  std::size_t threads = std::min(jobs, combinations.size());
+  for (std::size_t i = 1; i < threads; i++) pool.emplace_back(worker);
+  worker();
+  std::for_each(pool.begin(), pool.end(),
+                [](std::thread &thread) { thread.join(); });
+
+  for (std::size_t i = 0; i < combinations.size(); i++) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+  }
+  return results;
+}
+
+/** Appends the seconds as minutes with one decimal, right aligned. */
+static void appendMinutes(TextBuffer &out, int seconds) {  // NOLINT
+  char buffer[32];
+  int length = std::snprintf(buffer, sizeof(buffer), "%7.1f", seconds / 60.0);
+  out.Append(buffer, static_cast<std::size_t>(length));
+}
+
+std::string ParameterSweep::FormatTable(
+    const std::vector<SweepResult> &results) {
+  TextBuffer out(128 * (results.size() + 2));
+  out << "  Ready  Depart   Retry  Return   Accel  Total delay  Stuck  "
+         "In time\n";
+  for (const SweepResult &result : results) {
+    const SimulationParameters &parameters = result.parameters;
+    appendMinutes(out, parameters.ready_after_s);
+    out << ' ';
+    appendMinutes(out, parameters.depart_after_s);
+    out << ' ';
+    appendMinutes(out, parameters.retry_interval_s);
+    out << ' ';
+    appendMinutes(out, parameters.turnaround_s);
+    char buffer[64];
+    int length;
+    if (parameters.max_acceleration > 0.0) {
+      length = std::snprintf(buffer, sizeof(buffer), " %7.2f",
+                             parameters.max_acceleration);
+    } else {
+      length = std::snprintf(buffer, sizeof(buffer), " %7s", "-");
+    }
+    out.Append(buffer, static_cast<std::size_t>(length));
+    out << "  ";
+    std::size_t start = out.Size();
+    out.AppendDuration(static_cast<int>(result.total_delay));
+    out.PadFrom(start, 11);
+    double on_time =
+        result.trains == 0 ? 0.0
+                           : 100.0 * result.on_time_trains / result.trains;
+    length = std::snprintf(buffer, sizeof(buffer), "  %5d  %6.1f%%\n",
+                           result.stuck_trains, on_time);
+    out.Append(buffer, static_cast<std::size_t>(length));
+  }
+  return out.Str();
+}
@@ -0,0 +1,175 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "profiler.h"  //NOLINT
+
+#ifdef TRAINS_PROFILING
+
+#include <algorithm>
+#include <cstring>
+
+#include "text_buffer.h"  //NOLINT
+
+Profiler::Profiler() : max_queue_depth_(0) {
+  std::memset(sections_, 0, sizeof(sections_));
+}
+
+int Profiler::bucketOf(std::uint64_t ns) {
+  if (ns < kSubBuckets) return static_cast<int>(ns);
+  int octave = 63 - __builtin_clzll(ns);
+  // The three bits below the highest set bit select the sub bucket.
+  int sub = static_cast<int>((ns >> (octave - 3)) & (kSubBuckets - 1));
+  int bucket = (octave - 2) * kSubBuckets + sub;
+  return std::min(bucket, kBuckets - 1);
+}
+
+std::uint64_t Profiler::bucketUpperBound(int bucket) {
+  if (bucket < kSubBuckets) return static_cast<std::uint64_t>(bucket);
+  int octave = bucket / kSubBuckets + 2;
+  int sub = bucket % kSubBuckets;
+  return ((static_cast<std::uint64_t>(kSubBuckets + sub + 1)) << (octave - 3)) -
+         1;
+}
+
+void Profiler::Record(ProfileSection section, std::uint64_t ns) {
+  SectionStats &stats = sections_[static_cast<int>(section)];
+  stats.count++;
+  stats.total_ns += ns;
+  stats.max_ns = std::max(stats.max_ns, ns);
+  stats.histogram[bucketOf(ns)]++;
+}
+
+void Profiler::SampleQueueDepth(SimTime time, std::size_t depth) {
+  max_queue_depth_ = std::max(max_queue_depth_, depth);
+  if (queue_depth_.empty() ||
+      time >= queue_depth_.back().first + kDepthSampleInterval) {
+    queue_depth_.emplace_back(time - time % kDepthSampleInterval, depth);
+  }
+}
+
+std::uint64_t Profiler::percentile(const SectionStats &stats,
+                                   double fraction) const {
+  if (stats.count == 0) return 0;
+  std::uint64_t target =
+      static_cast<std::uint64_t>(fraction * static_cast<double>(stats.count));
+  if (target >= stats.count) target = stats.count - 1;
+  std::uint64_t seen = 0;
+  for (int i = 0; i < kBuckets; i++) {
+    seen += stats.histogram[i];
+    if (seen > target) return std::min(bucketUpperBound(i), stats.max_ns);
+  }
+  return stats.max_ns;
+}
+
+const char *Profiler::SectionName(ProfileSection section) {
+  switch (section) {
+    case ProfileSection::NOT_ASSEMBLED:
+      return "NotAssembled";
+    case ProfileSection::INCOMPLETE:
+      return "Incomplete";
+    case ProfileSection::READY:
+      return "Ready";
+    case ProfileSection::RUNNING:
+      return "Running";
+    case ProfileSection::ARRIVED:
+      return "Arrived";
+    case ProfileSection::FINISHED:
+      return "Finished";
+    case ProfileSection::DISRUPTION:
+      return "Disruption";
+    case ProfileSection::LOG:
+      return "Log";
+    case ProfileSection::RUN_NEXT_EVENT:
+      return "RunNextEvent";
+    case ProfileSection::COUNT:
+      break;
+  }
+  return "";
+}
+
+std::string Profiler::GetReport() const {
+  TextBuffer out(4096);
+  const char *headers[] = {"Section", "Count", "Total (us)", "p50 (ns)",
+                           "p90 (ns)", "p99 (ns)", "Max (ns)"};
+  const std::size_t widths[] = {16, 10, 14, 12, 12, 12, 12};
+  for (int i = 0; i < 7; i++) {
+    std::size_t start = out.Size();
+    out << headers[i];
+    out.PadFrom(start, widths[i]);
+  }
+  out << '\n';
+  std::uint64_t event_ns = 0;
+  for (int i = 0; i < static_cast<int>(ProfileSection::COUNT); i++) {
+    const SectionStats &stats = sections_[i];
+    if (i < static_cast<int>(ProfileSection::LOG)) event_ns += stats.total_ns;
+    const std::uint64_t values[] = {stats.count, stats.total_ns / 1000,
+                                    percentile(stats, 0.5),
+                                    percentile(stats, 0.9),
+                                    percentile(stats, 0.99), stats.max_ns};
+    std::size_t start = out.Size();
+    out << SectionName(static_cast<ProfileSection>(i));
+    out.PadFrom(start, widths[0]);
+    for (int j = 0; j < 6; j++) {
+      start = out.Size();
+      out.AppendInt(static_cast<long long>(values[j]));  // NOLINT
+      out.PadFrom(start, widths[j + 1]);
+    }
+    out << '\n';
+  }
+  std::uint64_t log_ns = sections_[static_cast<int>(ProfileSection::LOG)]
+                             .total_ns;
+  // The steps are timed without their Log, see TrainLifecycle::Run.
+  out << "\nTime in event logic (us): "
+      << static_cast<long long>(event_ns / 1000)  // NOLINT
+      << "\nTime in Log (us): "
+      << static_cast<long long>(log_ns / 1000)  // NOLINT
+      << "\nMax event queue depth: "
+      << static_cast<long long>(max_queue_depth_)  // NOLINT
+      << "\n\nEvent queue depth:\n";
+  std::for_each(queue_depth_.begin(), queue_depth_.end(),
+                [&out](const std::pair<SimTime, std::size_t> &sample) {
+                  out.AppendTime(sample.first)
+                      << ' ' << static_cast<long long>(sample.second)  // NOLINT
+                      << '\n';
+                });
+  return out.Str();
+}
+
+void Profiler::AppendJson(TextBuffer &out) const {
+  out << "{\"sections\":{";
+  std::uint64_t event_ns = 0;
+  for (int i = 0; i < static_cast<int>(ProfileSection::COUNT); i++) {
+    const SectionStats &stats = sections_[i];
+    if (i < static_cast<int>(ProfileSection::LOG)) event_ns += stats.total_ns;
+    if (i != 0) out << ',';
+    out << '"' << SectionName(static_cast<ProfileSection>(i))
+        << "\":{\"count\":" << static_cast<long long>(stats.count)  // NOLINT
+        << ",\"total_ns\":" << static_cast<long long>(stats.total_ns)  // NOLINT
+        << ",\"p50_ns\":"
+        << static_cast<long long>(percentile(stats, 0.5))  // NOLINT
+        << ",\"p90_ns\":"
+        << static_cast<long long>(percentile(stats, 0.9))  // NOLINT
+        << ",\"p99_ns\":"
+        << static_cast<long long>(percentile(stats, 0.99))  // NOLINT
+        << ",\"max_ns\":" << static_cast<long long>(stats.max_ns)  // NOLINT
+        << '}';
+  }
+  std::uint64_t log_ns = sections_[static_cast<int>(ProfileSection::LOG)]
+                             .total_ns;
+  out << "},\"logic_ns\":" << static_cast<long long>(event_ns)  // NOLINT
+      << ",\"log_ns\":" << static_cast<long long>(log_ns)  // NOLINT
+      << ",\"max_queue_depth\":"
+      << static_cast<long long>(max_queue_depth_)  // NOLINT
+      << ",\"queue_depth\":[";
+  for (std::size_t i = 0; i < queue_depth_.size(); i++) {
+    if (i != 0) out << ',';
+    out << "{\"time\":" << queue_depth_[i].first << ",\"depth\":"
+        << static_cast<long long>(queue_depth_[i].second)  // NOLINT
+        << '}';
+  }
+  out << "]}\n";
+}
+
+#endif  // TRAINS_PROFILING
@@ -0,0 +1,413 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "query_server.h"  //NOLINT
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "simulation_snapshot.h"  //NOLINT
+#include "simulation_worker.h"  //NOLINT
+#include "simulator.h"  //NOLINT
+#include "t_s_manager.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+#include "train_time.h"  //NOLINT
+#include "vehicle.h"  //NOLINT
+
+// The ids of the epoll entries that are not connections.
+static const std::uint64_t kListenId = 0;
+static const std::uint64_t kStopId = 1;
+static const std::uint64_t kAnswerId = 2;
+static const std::uint64_t kFirstConnectionId = 3;
+
+static const int kMaxEvents = 64;
+static const std::size_t kReadSize = 4096;
+// A request line longer than this closes the connection.
+static const std::size_t kMaxLineLength = 1024;
+static const int kTrainsPerPage = 50;
+
+/** \brief Parses a whole argument as a number. */
+static bool parseInt(const std::string &text, int &value_out) {  // NOLINT
+  if (text.empty()) return false;
+  char *end = nullptr;
+  errno = 0;
+  long value = std::strtol(text.c_str(), &end, 10);  // NOLINT
+  if (errno != 0 || *end != '\0') return false;
+  value_out = static_cast<int>(value);
+  return true;
+}
+
+static void throwError(const std::string &what) {
+  throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+QueryServer::QueryServer(
+    const std::string &path, std::shared_ptr<Simulator> simulator,
+    std::shared_ptr<TrainStationManager> train_station_manager,
+    std::shared_ptr<SimulationWorker> simulation_worker)
+    : path_(path),
+      simulator_(simulator),
+      train_station_manager_(train_station_manager),
+      simulation_worker_(simulation_worker),
+      listen_fd_(-1),
+      epoll_fd_(-1),
+      stop_fd_(-1),
+      next_id_(kFirstConnectionId) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path_.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("The socket path is too long: " + path_);
+  }
+  std::memcpy(address.sun_path, path_.c_str(), path_.size());
+  try {
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) throwError("Could not create socket");
+    // A socket file left by an earlier run is replaced.
+    unlink(path_.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0) {
+      throwError("Could not bind " + path_);
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0) throwError("Could not listen");
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) throwError("Could not create epoll");
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ < 0) throwError("Could not create eventfd");
+    const std::pair<int, std::uint64_t> watched[] = {
+        {listen_fd_, kListenId},
+        {stop_fd_, kStopId},
+        {simulation_worker_->GetAnswerFd(), kAnswerId}};
+    for (const std::pair<int, std::uint64_t> &entry : watched) {
+      epoll_event event;
+      event.events = EPOLLIN;
+      event.data.u64 = entry.second;
+      if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, entry.first, &event) < 0) {
+        throwError("Could not watch socket");
+      }
+    }
+  } catch (const std::exception &) {
+    if (stop_fd_ >= 0) close(stop_fd_);
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+      unlink(path_.c_str());
+    }
+    throw;
+  }
+  thread_ = std::thread([this]() { run(); });
+}
+
+QueryServer::~QueryServer() {
+  std::uint64_t one = 1;
+  // The stop eventfd is only written here, so the write can not find the
+  // counter full.
+  while (write(stop_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+  thread_.join();
+  std::for_each(connections_.begin(), connections_.end(),
+                [](const std::pair<const std::uint64_t, Connection> &entry) {
+                  close(entry.second.fd);
+                });
+  close(stop_fd_);
+  close(epoll_fd_);
+  close(listen_fd_);
+  unlink(path_.c_str());
+}
+
+void QueryServer::run() {
+  epoll_event events[kMaxEvents];
+  while (true) {
+    int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    for (int i = 0; i < count; i++) {
+      std::uint64_t id = events[i].data.u64;
+      if (id == kStopId) {
+        return;
+      } else if (id == kListenId) {
+        acceptConnections();
+      } else if (id == kAnswerId) {
+        handleAnswers();
+      } else {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) continue;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          closeConnection(id);
+          continue;
+        }
+        if (events[i].events & EPOLLOUT) flush(id, it->second);
+        // flush closes the connection if the client is gone.
+        if ((events[i].events & EPOLLIN) && connections_.count(id)) {
+          readFrom(id);
+        }
+      }
+    }
+  }
+}
+
+void QueryServer::acceptConnections() {
+  while (true) {
+    int fd = accept4(listen_fd_, nullptr, nullptr,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    std::uint64_t id = next_id_++;
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+    connections_.emplace(id,
+                         Connection{fd, std::string(), std::string(), 0,
+                                    false, false});
+  }
+}
+
+void QueryServer::readFrom(std::uint64_t id) {
+  Connection &connection = connections_.at(id);
+  char buffer[kReadSize];
+  while (true) {
+    ssize_t size = read(connection.fd, buffer, sizeof(buffer));
+    if (size > 0) {
+      connection.input.append(buffer, static_cast<std::size_t>(size));
+    } else if (size < 0 && errno == EINTR) {
+      continue;
+    } else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else {
+      // The client has closed the connection or it failed.
+      closeConnection(id);
+      return;
+    }
+  }
+  handleInput(id, connection);
+}
+
+void QueryServer::handleInput(std::uint64_t id, Connection &connection) {
+  std::size_t start = 0;
+  while (!connection.waiting) {
+    std::size_t end = connection.input.find('\n', start);
+    if (end == std::string::npos) break;
+    std::string line = connection.input.substr(start, end - start);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    start = end + 1;
+    handleRequest(id, connection, line);
+  }
+  connection.input.erase(0, start);
+  if (!connection.waiting && connection.input.size() > kMaxLineLength) {
+    closeConnection(id);
+    return;
+  }
+  flush(id, connection);
+}
+
+void QueryServer::handleRequest(std::uint64_t id, Connection &connection,
+                                const std::string &line) {
+  std::vector<std::string> words;
+  std::size_t start = 0;
+  while (start < line.size()) {
+    std::size_t end = line.find(' ', start);
+    if (end == std::string::npos) end = line.size();
+    if (end > start) words.emplace_back(line, start, end - start);
+    start = end + 1;
+  }
+  if (words.empty()) {
+    appendResponse(connection, false, "Empty request");
+    return;
+  }
+  bool high = words.size() > 1 && words.back() == "high";
+  if (high) words.pop_back();
+  const std::string &command = words[0];
+  int number = 0;
+  bool has_number = words.size() == 2 && parseInt(words[1], number);
+  std::shared_ptr<TrainStationManager> manager = train_station_manager_;
+  try {
+    if (command == "STATUS" && words.size() == 1) {
+      std::shared_ptr<const SimulationSnapshot> snapshot =
+          manager->GetSnapshot();
+      TextBuffer out;
+      out << "time ";
+      out.AppendTime(snapshot->current_time)
+          << "\ntotal_delay " << static_cast<long long>(  // NOLINT
+                                     snapshot->total_delay)
+          << "\ntotal_departure_delay "
+          << static_cast<long long>(  // NOLINT
+                 snapshot->total_departure_delay)
+          << '\n';
+      appendResponse(connection, true, out.Str());
+    } else if (command == "TIMETABLE" &&
+               (words.size() == 1 || (has_number && number >= 0))) {
+      appendResponse(connection, true, timetablePage(number));
+    } else if (command == "TRAIN" && has_number) {
+      appendResponse(connection, true,
+                     manager->GetTrainDetailsByTrainNumber(number, high));
+    } else if (command == "VEHICLE_TRAIN" && has_number) {
+      appendResponse(connection, true,
+                     manager->GetTrainDetailsByVehicleId(number, high));
+    } else if (command == "VEHICLE" && has_number) {
+      std::string location;
+      std::shared_ptr<Vehicle> vehicle = manager->FindVehicle(number, location);
+      appendResponse(connection, true,
+                     vehicle->GetDetails() + " Location:" + location + "\n");
+    } else if (command == "STATION" && words.size() == 2) {
+      appendResponse(connection, true,
+                     manager->GetStationDetails(words[1], high));
+    } else if (command == "LIFECYCLE" && has_number) {
+      sendToWorker(id, connection, [manager, number, high]() {
+        std::string details;
+        if (!manager->GetTrainLifeCycleByTrainNumber(number, high, details)) {
+          throw std::runtime_error("There is no train with this number");
+        }
+        return details;
+      });
+    } else if (command == "VEHICLE_LIFECYCLE" && has_number) {
+      sendToWorker(id, connection, [manager, number, high]() {
+        std::string details;
+        if (!manager->GetTrainLifeCycleByVehicleId(number, high, details)) {
+          throw std::runtime_error("There is no train with this vehicle");
+        }
+        return details;
+      });
+    } else if (command == "STATS" && words.size() == 1) {
+      std::shared_ptr<Simulator> simulator = simulator_;
+      sendToWorker(id, connection, [manager, simulator, high]() {
+        TextBuffer out(8192);
+        out << "Total delay time: "
+            << TrainTime::SecondsToPretty(
+                   static_cast<int>(simulator->GetTotalDelay()))
+            << "\nTotal departure delay time: "
+            << TrainTime::SecondsToPretty(
+                   static_cast<int>(simulator->GetTotalDepartureDelay()))
+            << "\n\nEnergy use:\n"
+            << simulator->GetEnergyAccount().GetReport(
+                   manager->GetStationNames(), high)
+            << "\nThroughput:\n"
+            << simulator->GetThroughputAccount().GetReport(
+                   manager->GetStationNames(), high);
+        return out.Str();
+      });
+    } else {
+      appendResponse(connection, false, "Unknown request: " + line);
+    }
+  } catch (const std::exception &e) {
+    appendResponse(connection, false, e.what());
+  }
+}
+
+void QueryServer::sendToWorker(std::uint64_t id, Connection &connection,
+                               std::function<std::string()> answer) {
+  if (simulation_worker_->SendQuery(WorkerQuery{id, std::move(answer)})) {
+    connection.waiting = true;
+  } else {
+    appendResponse(connection, false, "The simulation is busy");
+  }
+}
+
+void QueryServer::handleAnswers() {
+  std::uint64_t count;
+  if (read(simulation_worker_->GetAnswerFd(), &count, sizeof(count)) < 0 &&
+      errno != EAGAIN) {
+    return;
+  }
+  WorkerAnswer answer;
+  while (simulation_worker_->TryReceiveAnswer(answer)) {
+    auto it = connections_.find(answer.id);
+    // The connection may have been closed while the worker answered.
+    if (it == connections_.end()) continue;
+    appendResponse(it->second, answer.ok, answer.text);
+    it->second.waiting = false;
+    handleInput(answer.id, it->second);
+  }
+}
+
+void QueryServer::flush(std::uint64_t id, Connection &connection) {
+  while (connection.written < connection.output.size()) {
+    ssize_t size = send(connection.fd,
+                        connection.output.data() + connection.written,
+                        connection.output.size() - connection.written,
+                        MSG_NOSIGNAL);
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (size < 0) {
+      closeConnection(id);
+      return;
+    }
+    connection.written += static_cast<std::size_t>(size);
+  }
+  if (connection.written == connection.output.size()) {
+    connection.output.clear();
+    connection.written = 0;
+  }
+  // The socket is watched for writing only while there is output left.
+  bool want_write = !connection.output.empty();
+  if (want_write != connection.want_write) {
+    epoll_event event;
+    event.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = id;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.want_write = want_write;
+  }
+}
+
+void QueryServer::closeConnection(std::uint64_t id) {
+  auto it = connections_.find(id);
+  if (it == connections_.end()) return;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+  close(it->second.fd);
+  connections_.erase(it);
+}
+
+std::string QueryServer::timetablePage(int page) {
+  std::shared_ptr<const SimulationSnapshot> snapshot =
+      train_station_manager_->GetSnapshot();
+  if (snapshot != timetable_snapshot_) {
+    // The snapshot may be replaced while the time table is made. It is then
+    // made again for the next request.
+    timetable_ = train_station_manager_->SeeTimeTable();
+    timetable_snapshot_ = snapshot;
+    timetable_lines_.clear();
+    timetable_lines_.push_back(0);
+    for (std::size_t i = 0; i < timetable_.size(); i++) {
+      if (timetable_[i] == '\n') timetable_lines_.push_back(i + 1);
+    }
+    if (timetable_lines_.back() != timetable_.size()) {
+      timetable_lines_.push_back(timetable_.size());
+    }
+  }
+  // The first line is the header, it starts every page.
+  std::size_t lines = timetable_lines_.size() - 1;
+  std::size_t first = 1 + static_cast<std::size_t>(page) * kTrainsPerPage;
+  if (lines == 0 || first >= lines) {
+    throw std::runtime_error("There is no such page");
+  }
+  std::size_t last = std::min(lines, first + kTrainsPerPage);
+  std::string text = timetable_.substr(0, timetable_lines_[1]);
+  text.append(timetable_, timetable_lines_[first],
+              timetable_lines_[last] - timetable_lines_[first]);
+  return text;
+}
+
+void QueryServer::appendResponse(Connection &connection, bool ok,
+                                 const std::string &body) {
+  connection.output.append(ok ? "OK " : "ERR ");
+  connection.output.append(std::to_string(body.size()));
+  connection.output.push_back('\n');
+  connection.output.append(body);
+}
@@ -0,0 +1,175 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "run_time_model.h"  //NOLINT
+
+#include <algorithm>
+#include <cmath>
+
+#include "vehicle.h"  //NOLINT
+
+// Empty mass in tons, indexed by vehicle type.
+static const double kTareTons[] = {45.0, 50.0, 22.0, 25.0, 85.0, 110.0};
+// Payload per seat or bed, and per cubic meter in a covered car, in tons.
+static const double kPassengerTons = 0.08;
+static const double kCoveredLoadTonsPerM3 = 0.25;
+// Davis resistance per ton, a in N and b in N per m/s.
+static const double kDavisA = 15.0;
+static const double kDavisB = 0.36;
+// Air resistance c in N per (m/s)^2 for the first and each following vehicle.
+static const double kDragLead = 4.8;
+static const double kDragPerVehicle = 0.6;
+static const double kAdhesion = 0.3;
+static const double kGravity = 9.81;
+// Service braking in m/s^2, freight trains brake softer.
+static const double kBrakingPassenger = 0.5;
+static const double kBrakingFreight = 0.35;
+
+// Work a diesel engine gets out of a liter of fuel.
+const double RunTimeModel::kDieselKwhPerLiter = 10.0 * 0.35;
+const double RunTimeModel::kRotatingMassFactor = 1.06;
+
+RunTimeModel::RunTimeModel() : max_acceleration_(0.0) {
+  std::fill(attribute_sum_, attribute_sum_ + kNumberOfTypes, 0.0);
+  std::fill(count_, count_ + kNumberOfTypes, 0);
+}
+
+double RunTimeModel::PayloadTons(const Vehicle &vehicle) {
+  int type = vehicle.GetType();
+  if (type == 0) {
+    return kPassengerTons *
+           dynamic_cast<const CoachCar &>(vehicle).GetNumberOfChairs();
+  } else if (type == 1) {
+    return kPassengerTons *
+           dynamic_cast<const SleepingCar &>(vehicle).GetNumberOfBeds();
+  } else if (type == 2) {
+    return dynamic_cast<const OpenCar &>(vehicle).GetWeightCapacity();
+  } else if (type == 3) {
+    return kCoveredLoadTonsPerM3 *
+           dynamic_cast<const CoveredCar &>(vehicle).GetVolumeCapacity();
+  }
+  return 0.0;
+}
+
+double RunTimeModel::PowerKw(const Vehicle &vehicle) {
+  int type = vehicle.GetType();
+  if (type == 4) {
+    return dynamic_cast<const Electrical &>(vehicle).GetMaxPower();
+  } else if (type == 5) {
+    return kDieselKwhPerLiter *
+           dynamic_cast<const Diesel &>(vehicle).GetFuelConsumption();
+  }
+  return 0.0;
+}
+
+double RunTimeModel::MassTons(const Vehicle &vehicle) {
+  int type = vehicle.GetType();
+  if (type < 0 || type >= kNumberOfTypes) return 0.0;
+  return kTareTons[type] + PayloadTons(vehicle);
+}
+
+double RunTimeModel::ResistanceN(double mass_tons, int vehicles,
+                                 double speed) {
+  double drag = kDragLead + kDragPerVehicle * (vehicles - 1);
+  return mass_tons * (kDavisA + kDavisB * speed) + drag * speed * speed;
+}
+
+void RunTimeModel::AddToFleet(const Vehicle &vehicle) {
+  int type = vehicle.GetType();
+  if (type < 0 || type >= kNumberOfTypes) return;
+  attribute_sum_[type] +=
+      (type == 4 || type == 5) ? PowerKw(vehicle) : PayloadTons(vehicle);
+  count_[type]++;
+}
+
+void RunTimeModel::SetMaxAcceleration(double max_acceleration) {
+  max_acceleration_ = max_acceleration;
+  table_.clear();
+  index_.clear();
+}
+
+double RunTimeModel::averageAttribute(int type) const {
+  return count_[type] == 0 ? 0.0 : attribute_sum_[type] / count_[type];
+}
+
+std::size_t RunTimeModel::AddLine(int distance_m, int max_speed_kmh,
+                                  const std::vector<int> &demanded_vehicles) {
+  std::vector<int> key(kNumberOfTypes + 2, 0);
+  key[0] = distance_m;
+  key[1] = max_speed_kmh;
+  std::for_each(demanded_vehicles.begin(), demanded_vehicles.end(),
+                [&key](int type) {
+                  if (type >= 0 && type < kNumberOfTypes) key[type + 2]++;
+                });
+  auto it = index_.find(key);
+  if (it != index_.end()) return it->second;
+
+  std::vector<int> vehicles_per_type(key.begin() + 2, key.end());
+  RunTime run_time = {
+      distance_m,
+      calculateRunTime(distance_m, max_speed_kmh, vehicles_per_type)};
+  table_.emplace_back(run_time);
+  index_.emplace(key, table_.size() - 1);
+  return table_.size() - 1;
+}
+
+int RunTimeModel::calculateRunTime(
+    int distance_m, int max_speed_kmh,
+    const std::vector<int> &vehicles_per_type) const {
+  double max_speed = max_speed_kmh / 3.6;
+  if (distance_m <= 0 || max_speed <= 0.0) return 0;
+
+  double mass_tons = 0.0;
+  double loco_tons = 0.0;
+  double power_w = 0.0;
+  int vehicles = 0;
+  for (int type = 0; type < kNumberOfTypes; type++) {
+    int count = vehicles_per_type[type];
+    vehicles += count;
+    if (type == 4 || type == 5) {
+      mass_tons += count * kTareTons[type];
+      loco_tons += count * kTareTons[type];
+      power_w += count * averageAttribute(type) * 1000.0;
+    } else {
+      mass_tons += count * (kTareTons[type] + averageAttribute(type));
+    }
+  }
+  // Without a locomotive there is nothing to model, keep the line speed.
+  if (power_w <= 0.0) {
+    return static_cast<int>(std::ceil(distance_m / max_speed));
+  }
+  bool freight = vehicles_per_type[2] > 0 || vehicles_per_type[3] > 0;
+  double braking = freight ? kBrakingFreight : kBrakingPassenger;
+  double adhesion_n = kAdhesion * loco_tons * 1000.0 * kGravity;
+  double effective_mass_kg = mass_tons * 1000.0 * kRotatingMassFactor;
+
+  // Integrates the motion one second at a time until the braking distance
+  // reaches the arrival station, then brakes the rest of the way.
+  double speed = 0.0;
+  double position = 0.0;
+  double time = 0.0;
+  while (position < distance_m) {
+    double remaining = distance_m - position;
+    if (speed > 0.0 && speed * speed / (2.0 * braking) >= remaining) {
+      time += 2.0 * remaining / speed;
+      break;
+    }
+    double traction = std::min(adhesion_n, power_w / std::max(speed, 1.0));
+    double resistance = ResistanceN(mass_tons, vehicles, speed);
+    double acceleration = (traction - resistance) / effective_mass_kg;
+    if (max_acceleration_ > 0.0 && acceleration > max_acceleration_) {
+      acceleration = max_acceleration_;
+    }
+    double next_speed = std::min(speed + acceleration, max_speed);
+    if (next_speed <= 0.0) {
+      // Too heavy to start, fall back to half the line speed.
+      return static_cast<int>(std::ceil(2.0 * distance_m / max_speed));
+    }
+    position += (speed + next_speed) / 2.0;
+    time += 1.0;
+    speed = next_speed;
+  }
+  return static_cast<int>(std::ceil(time));
+}
@@ -0,0 +1,51 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "simulation_parameters.h"  //NOLINT
+
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+bool SimulationParameters::Set(const std::string &name, double value) {
+  if (name == "acceleration") {
+    if (value < 0.0) return false;
+    max_acceleration = value;
+    return true;
+  }
+  // The timing is whole seconds, and a retry interval of 0 would try again
+  // at the same time for ever.
+  int seconds = static_cast<int>(std::lround(value * 60.0));
+  if (seconds < 1) return false;
+  if (name == "ready") {
+    ready_after_s = seconds;
+  } else if (name == "depart") {
+    depart_after_s = seconds;
+  } else if (name == "retry") {
+    retry_interval_s = seconds;
+  } else if (name == "turnaround") {
+    turnaround_s = seconds;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void SimulationParameters::SetFromText(const std::string &assignment) {
+  std::string::size_type equals = assignment.find('=');
+  if (equals != std::string::npos) {
+    const char *text = assignment.c_str() + equals + 1;
+    char *end;
+    double value = std::strtod(text, &end);
+    if (end != text && *end == '\0' &&
+        Set(assignment.substr(0, equals), value)) {
+      return;
+    }
+  }
+  throw std::runtime_error(
+      "Invalid parameter " + assignment +
+      ", use ready, depart, retry or turnaround=MINUTES or "
+      "acceleration=M/S2");
+}
@@ -0,0 +1,291 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "simulation_worker.h"  //NOLINT
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "paced_clock.h"  //NOLINT
+#include "simulator.h"  //NOLINT
+#include "t_s_manager.h"  //NOLINT
+#include "timer_wheel.h"  //NOLINT
+
+// Both queues only hold a few entries at a time, the console log is sent in
+// chunks of about kConsoleChunkSize bytes.
+static const std::size_t kCommandCapacity = 16;
+static const std::size_t kOutputCapacity = 256;
+static const std::size_t kQueryCapacity = 1024;
+static const std::size_t kConsoleChunkSize = 16 * 1024;
+// A snapshot is published every kSnapshotPeriodMs milliseconds during a
+// run. The clock is read every kEventsPerClockCheck events.
+static const int kSnapshotPeriodMs = 100;
+static const int kEventsPerClockCheck = 256;
+// A paced run looks for commands and queries every kPollPeriodMs
+// milliseconds while it sleeps.
+static const int kPollPeriodMs = 20;
+
+// The timers of a paced run.
+enum PacedTimer { kDispatchTimer, kSnapshotTimer, kPollTimer };
+
+SimulationWorker::SimulationWorker(
+    std::shared_ptr<Simulator> simulator,
+    std::shared_ptr<TrainStationManager> train_station_manager)
+    : simulator_(simulator),
+      train_station_manager_(train_station_manager),
+      commands_(kCommandCapacity),
+      outputs_(kOutputCapacity),
+      queries_(kQueryCapacity),
+      answers_(kQueryCapacity),
+      console_output_(kConsoleChunkSize * 2),
+      stopping_(false) {
+  answer_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (answer_fd_ < 0) throw std::runtime_error("Could not create an eventfd");
+  simulator_->SetConsoleOutput(&console_output_);
+  thread_ = std::thread([this]() { run(); });
+}
+
+SimulationWorker::~SimulationWorker() {
+  Send(WorkerCommandType::STOP, 0);
+  thread_.join();
+  simulator_->SetConsoleOutput(nullptr);
+  close(answer_fd_);
+}
+
+void SimulationWorker::Send(WorkerCommandType type, SimTime time,
+                            int speedup) {
+  WorkerCommand command = {type, time, speedup};
+  while (!commands_.TryPush(std::move(command))) std::this_thread::yield();
+  // Taking the lock before notifying makes sure the worker is either
+  // waiting or has not checked the queue yet, so the wake up is not lost.
+  { std::lock_guard<std::mutex> lock(wake_mutex_); }
+  command_ready_.notify_one();
+}
+
+bool SimulationWorker::TryReceive(WorkerOutput &output_out) {
+  return outputs_.TryPop(output_out);
+}
+
+void SimulationWorker::WaitForOutput(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  output_ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                         [this]() { return !outputs_.Empty(); });
+}
+
+bool SimulationWorker::SendQuery(WorkerQuery &&query) {
+  if (!queries_.TryPush(std::move(query))) return false;
+  { std::lock_guard<std::mutex> lock(wake_mutex_); }
+  command_ready_.notify_one();
+  return true;
+}
+
+bool SimulationWorker::TryReceiveAnswer(WorkerAnswer &answer_out) {
+  return answers_.TryPop(answer_out);
+}
+
+void SimulationWorker::answerQueries() {
+  WorkerQuery query;
+  while (queries_.TryPop(query)) {
+    WorkerAnswer answer = {query.id, true, std::string()};
+    try {
+      answer.text = query.answer();
+    } catch (const std::exception &e) {
+      answer.ok = false;
+      answer.text = e.what();
+    }
+    // There are as many answer slots as query slots, so this only waits if
+    // the server is slow to take the answers.
+    while (!answers_.TryPush(std::move(answer))) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  std::uint64_t one = 1;
+  // The write only fails if the counter is full. The server has not read it
+  // yet then, so it will still see the answers.
+  if (write(answer_fd_, &one, sizeof(one)) != sizeof(one)) return;
+}
+
+void SimulationWorker::send(WorkerOutput &&output) {
+  while (!outputs_.TryPush(std::move(output))) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  { std::lock_guard<std::mutex> lock(wake_mutex_); }
+  output_ready_.notify_one();
+}
+
+void SimulationWorker::sendConsoleOutput() {
+  if (console_output_.Empty()) return;
+  send(WorkerOutput{WorkerOutputType::TEXT, console_output_.Str(), 0, false,
+                    false});
+  console_output_.Clear();
+}
+
+void SimulationWorker::run() {
+  while (!stopping_) {
+    {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      command_ready_.wait(lock, [this]() {
+        return !commands_.Empty() || !queries_.Empty();
+      });
+    }
+    if (!queries_.Empty()) answerQueries();
+    WorkerCommand command;
+    if (!commands_.TryPop(command)) continue;
+    if (command.type == WorkerCommandType::STOP) break;
+    if (command.type == WorkerCommandType::PAUSE) continue;
+
+    WorkerOutput done = {WorkerOutputType::DONE, std::string(), 0, false,
+                         false};
+    try {
+      if (command.type == WorkerCommandType::RUN_TO) {
+        done.paused = !runTo(command.time);
+        done.events_left = simulator_->HasEvents();
+      } else if (command.type == WorkerCommandType::RUN_PACED) {
+        done.paused = !runPaced(command.time, command.speedup);
+        done.events_left = simulator_->HasEvents();
+      } else {
+        done.events_left = simulator_->HasEvents();
+        step();
+      }
+    } catch (const std::exception &e) {
+      done.type = WorkerOutputType::FAILED;
+      done.text = e.what();
+    }
+    train_station_manager_->PublishSnapshot();
+    sendConsoleOutput();
+    done.current_time = simulator_->GetCurrentTime();
+    send(std::move(done));
+  }
+}
+
+bool SimulationWorker::runTo(SimTime time) {
+  simulator_->SetCurrentTime(time);
+  bool reached = true;
+  int events = 0;
+  auto last_snapshot = std::chrono::steady_clock::now();
+  while (simulator_->RunEventIfTime()) {
+    if (console_output_.Size() >= kConsoleChunkSize) sendConsoleOutput();
+    if (!queries_.Empty()) answerQueries();
+    if (++events % kEventsPerClockCheck == 0) {
+      auto now = std::chrono::steady_clock::now();
+      if (now - last_snapshot >=
+          std::chrono::milliseconds(kSnapshotPeriodMs)) {
+        train_station_manager_->PublishSnapshot();
+        last_snapshot = now;
+      }
+    }
+    if (stopRequested()) {
+      // The simulation stops at the time of the next event, so it can be
+      // continued later.
+      if (simulator_->HasEvents()) {
+        simulator_->SetCurrentTime(simulator_->GetTime());
+      }
+      reached = false;
+      break;
+    }
+  }
+  simulator_->FlushLog();
+  return reached;
+}
+
+bool SimulationWorker::stopRequested() {
+  WorkerCommand command;
+  if (commands_.Empty() || !commands_.TryPop(command)) return false;
+  // Only PAUSE and STOP are sent while a command runs.
+  stopping_ = command.type == WorkerCommandType::STOP;
+  return true;
+}
+
+bool SimulationWorker::runPaced(SimTime time, int speedup) {
+  PacedClock clock(simulator_->GetCurrentTime(), speedup);
+  TimerWheel wheel;
+  LagStats lag;
+  std::vector<int> expired;
+  // The wheel wakes the run on the tick before the wall time of the next
+  // event time, and the last part is slept to the exact wall time.
+  bool dispatch_pending = false;
+  auto schedule_dispatch = [&]() {
+    dispatch_pending =
+        simulator_->HasEvents() && simulator_->GetTime() < time;
+    if (dispatch_pending) {
+      wheel.Schedule(kDispatchTimer,
+                     clock.TickAt(clock.WallTimeOf(simulator_->GetTime())));
+    }
+  };
+  // The current time follows the clock on the wall between events, but
+  // never passes an event that has not run.
+  auto follow_clock = [&](std::int64_t now) {
+    SimTime clock_time = std::min(clock.SimTimeAt(now), time);
+    if (simulator_->HasEvents()) {
+      clock_time = std::min(clock_time, simulator_->GetTime());
+    }
+    if (clock_time > simulator_->GetCurrentTime()) {
+      simulator_->SetCurrentTime(clock_time);
+    }
+  };
+  schedule_dispatch();
+  wheel.Schedule(kSnapshotTimer, kSnapshotPeriodMs);
+  wheel.Schedule(kPollTimer, kPollPeriodMs);
+  bool reached = true;
+  while (dispatch_pending) {
+    PacedClock::SleepUntil(clock.WallTimeOfTick(wheel.NextExpiry()));
+    std::int64_t now = PacedClock::Now();
+    expired.clear();
+    wheel.Advance(clock.TickAt(now), expired);
+    for (int timer : expired) {
+      if (timer == kDispatchTimer) {
+        SimTime event_time = simulator_->GetTime();
+        PacedClock::SleepUntil(clock.WallTimeOf(event_time));
+        lag.Record(PacedClock::Now() - clock.WallTimeOf(event_time));
+        // RunEventIfTime runs the events before the current time, which are
+        // the events of event_time and those they add at the same time.
+        simulator_->SetCurrentTime(event_time + 1);
+        while (simulator_->RunEventIfTime()) {
+        }
+        simulator_->SetCurrentTime(event_time);
+        if (console_output_.Size() >= kConsoleChunkSize) sendConsoleOutput();
+        schedule_dispatch();
+      } else if (timer == kSnapshotTimer) {
+        follow_clock(now);
+        simulator_->FlushLog();
+        train_station_manager_->PublishSnapshot();
+        sendConsoleOutput();
+        wheel.Schedule(kSnapshotTimer, clock.TickAt(now) + kSnapshotPeriodMs);
+      } else {
+        if (!queries_.Empty()) answerQueries();
+        wheel.Schedule(kPollTimer, clock.TickAt(now) + kPollPeriodMs);
+      }
+    }
+    if (stopRequested()) {
+      follow_clock(PacedClock::Now());
+      reached = false;
+      break;
+    }
+  }
+  // The events after the end of the simulation are run at once, as runTo
+  // does.
+  if (reached) reached = runTo(time);
+  simulator_->FlushLog();
+  sendConsoleOutput();
+  send(WorkerOutput{WorkerOutputType::TEXT, lag.GetReport(speedup), 0, false,
+                    false});
+  return reached;
+}
+
+void SimulationWorker::step() {
+  if (simulator_->HasEvents()) {
+    simulator_->SetCurrentTime(simulator_->GetTime());
+  }
+  simulator_->RunNextEvent();
+  simulator_->FlushLog();
+}
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <iostream>
 
 #include "event.h"        //NOLINT
 #include "station.h"      //NOLINT
@@ -16,149 +17,165 @@
 #include "train_time.h"   //NOLINT
 #include "vehicle.h"      //NOLINT
 
+static const char kLogPath[] = "Trainsim.log";
+static const char kSpillPath[] = "Trainsim.spill";
+
 void Simulator::setupTime() {
-  time_t now = time(nullptr);
-  std::tm t_struct{};
-  gmtime_r(&now, &t_struct);
-  t_struct.tm_hour = 0;
-  t_struct.tm_min = 0;
-  t_struct.tm_sec = 0;
-  SetCurrentTime(mktime(&t_struct));
+  SetCurrentTime(0);
   SetStartSimulationTime(GetCurrentTime());
-  SetStopSimulationTime(GetCurrentTime() +
-                        static_cast<time_t>((24 * 60 * 60) - 60));
+  SetStopSimulationTime(GetCurrentTime() + TrainTime::kSecondsPerDay - 60);
   SetStopTime(GetStopSimulationTime());
-  std::ifstream file("Trainsim.log");
+  if (!log_to_file_) return;
+  std::ifstream file(kLogPath);
   if (file.is_open()) {
     file.close();
-    std::remove("Trainsim.log");
+    std::remove(kLogPath);
+  }
+}
+
+TextBuffer &Simulator::BeginLogLine() {
+  log_line_.Clear();
+  return log_line_;
+}
+
+void Simulator::CommitLogLine() {
+  if (log_to_file_ && !log_file_.is_open()) {
+    log_file_.open(kLogPath, std::fstream::out | std::fstream::app);
+  }
+  if (log_file_.is_open()) {
+    log_file_.write(log_line_.Data(), log_line_.Size());
+  }
+  if (!console_log_) return;
+  if (console_output_ != nullptr) {
+    console_output_->Append(log_line_.Data(), log_line_.Size());
+  } else {
+    std::cout.write(log_line_.Data(), log_line_.Size());
+  }
+}
+
+void Simulator::ExportEvent(const State &state) {
+  std::for_each(
+      event_sinks_.begin(), event_sinks_.end(),
+      [&state](std::shared_ptr<EventSink> &sink) { sink->Write(state); });
+}
+
+void Simulator::FlushLog() {
+  if (log_file_.is_open()) log_file_.flush();
+  std::for_each(event_sinks_.begin(), event_sinks_.end(),
+                [](std::shared_ptr<EventSink> &sink) { sink->Flush(); });
+}
+
+EventHandle Simulator::AddEvent(const std::shared_ptr<Event> &event) {
+  event->SetSequence(next_sequence_++);
+  EventHandle handle = event_queue_.Push(event);
+  event->SetHandle(handle);
+  return handle;
+}
+
+std::size_t Simulator::findInBatch(EventHandle handle) const {
+  for (std::size_t i = batch_next_; i < batch_.size(); i++) {
+    if (batch_[i]->GetHandle() == handle) return i;
   }
+  return batch_.size();
 }
 
-void Simulator::AddEvent(const std::shared_ptr<Event> &event) {
-  event_queue_.push(event);
+bool Simulator::CancelEvent(EventHandle handle) {
+  if (event_queue_.Cancel(handle)) return true;
+  // The events of the time that is run have left the queue, but they are
+  // still looked up by their handle until they run.
+  std::size_t index = findInBatch(handle);
+  if (index == batch_.size()) return false;
+  batch_.erase(batch_.begin() + static_cast<std::ptrdiff_t>(index));
+  return true;
 }
 
-void Simulator::AddToEventLog(const std::shared_ptr<Event> &event) {
-  event_log_.emplace_back(event);
+bool Simulator::RescheduleEvent(EventHandle handle, SimTime time) {
+  std::shared_ptr<Event> event;
+  std::size_t index = findInBatch(handle);
+  if (index != batch_.size()) {
+    event = std::move(batch_[index]);
+    batch_.erase(batch_.begin() + static_cast<std::ptrdiff_t>(index));
+    event->SetEventTime(time);
+    AddEvent(event);
+    return true;
+  }
+  if (!event_queue_.Contains(handle)) return false;
+  return event_queue_.Reschedule(handle, time, next_sequence_++);
+}
+
+void Simulator::SetEventLogRetention(RetentionPolicy policy,
+                                     std::size_t capacity) {
+  event_log_.SetRetentionPolicy(policy, capacity, kSpillPath);
+}
+
+SimTime Simulator::GetTime() const {
+  if (batch_next_ < batch_.size()) return batch_[batch_next_]->GetEventTime();
+  return event_queue_.TopTime();
+}
+
+bool Simulator::HasEvents() const {
+  return batch_next_ < batch_.size() || !event_queue_.Empty();
 }
 
-time_t Simulator::GetTime() const { return event_queue_.top()->GetEventTime(); }
+bool Simulator::fillBatch() {
+  if (batch_next_ < batch_.size()) return true;
+  batch_.clear();
+  batch_next_ = 0;
+  if (event_queue_.Empty()) return false;
+  SimTime time = event_queue_.TopTime();
+  while (!event_queue_.Empty() && event_queue_.TopTime() == time) {
+    batch_.emplace_back(event_queue_.Pop());
+  }
+  // The queue hands out events with the same time in the order they were
+  // added, and the stable sort keeps that order within each kind.
+  std::stable_sort(batch_.begin(), batch_.end(),
+                   [](const std::shared_ptr<Event> &first,
+                      const std::shared_ptr<Event> &second) {
+                     return first->GetKind() < second->GetKind();
+                   });
+  return true;
+}
 
 bool Simulator::RunEventsUntilTime() {
-  while (!event_queue_.empty() &&
-         ((event_queue_.top()->GetEventTime() < GetCurrentTime()) ||
-          (GetCurrentTime() >= GetStopSimulationTime()))) {
-    RunNextEvent();
+  while (RunEventIfTime()) {
   }
-  return !event_queue_.empty();
+  FlushLog();
+  return HasEvents();
+}
+
+bool Simulator::RunEventIfTime() {
+  if (!HasEvents() || ((GetTime() >= GetCurrentTime()) &&
+                       (GetCurrentTime() < GetStopSimulationTime()))) {
+    return false;
+  }
+  RunNextEvent();
+  return true;
 }
 
 bool Simulator::RunNextEvent() {
-  if (!event_queue_.empty()) {
-    auto next_event = event_queue_.top();
-    event_queue_.pop();
-    if (!event_queue_.empty() &&
-        event_queue_.top()->GetEventTime() < GetStopSimulationTime()) {
+  PROFILE_SCOPE(profiler_, ProfileSection::RUN_NEXT_EVENT);
+  if (fillBatch()) {
+#ifdef TRAINS_PROFILING
+    profiler_.SampleQueueDepth(
+        GetTime(), event_queue_.Size() + batch_.size() - batch_next_);
+#endif
+    std::shared_ptr<Event> next_event = std::move(batch_[batch_next_++]);
+    if (next_event->GetTrain() &&
+        next_event->GetEventTime() < GetStopSimulationTime()) {
+      next_event->GetTrain()->SetLastEventTime(next_event->GetEventTime());
+    }
+    if (HasEvents() && GetTime() < GetStopSimulationTime()) {
       next_event->Run();
-    } else if (next_event->GetTrainStatus() == TrainStatus::RUNNING ||
-               next_event->GetTrainStatus() == TrainStatus::ARRIVED) {
+    } else if (next_event->GetTrain() &&
+               (next_event->GetTrainStatus() == TrainStatus::RUNNING ||
+                next_event->GetTrainStatus() == TrainStatus::ARRIVED)) {
       next_event->Run();
-      SetCurrentTime(next_event->GetEventTime());
+      // The event can be before the stop time when the one after it is
+      // not, and the run must not end there.
+      SetCurrentTime(std::max(GetCurrentTime(), next_event->GetEventTime()));
     }
     return true;
   } else {
     return false;
   }
 }
-
-bool Simulator::GetTrainLifeCycleByTrainNumber(int train_number,
-                                               std::string &details_out,
-                                               bool high_detail_level) {
-  std::ostringstream oss;
-  int i = 0;
-  std::for_each(
-      event_log_.begin(), event_log_.end(), [&](std::shared_ptr<Event> &event) {
-        if (event->GetTrain()->GetTrainNumber() == train_number) {
-          oss << TrainTime::Time_tToString(event->GetEventTime()) << " "
-              << "Train: " << event->GetTrain()->GetTrainNumber() << " from "
-              << event->GetTrain()->GetDepartureStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalDepartureTime())
-              << ") to " << event->GetTrain()->GetArrivalStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalArrivalTime())
-              << ") Train status: " << event->GetState().train_status_ << "\n";
-          if (high_detail_level) {
-            auto connected_vehicles = event->GetState().connected_vehicles_;
-            std::for_each(connected_vehicles.begin(), connected_vehicles.end(),
-                          [&](int &vehicle_id) {
-                            std::shared_ptr<Vehicle> vehicle_out;
-
-                            event->GetTrain()->GetVehicleById(vehicle_id,
-                                                              vehicle_out);
-                            oss << vehicle_out->GetDetails() << "\n";
-                          });
-            oss << event->GetTrain()->ListDemandedVehiclesFromState(
-                       event->GetState().demanded_vehicles_)
-                << "\n";
-          }
-          i++;
-        }
-      });
-  details_out = oss.str();
-  return i != 0;
-}
-
-bool Simulator::GetTrainLifeCycleByVehicleId(int vehicle_id,
-                                             std::string &details_out,
-                                             bool high_detail_level) {
-  std::ostringstream oss;
-  int i = 0;
-  std::for_each(
-      event_log_.begin(), event_log_.end(), [&](std::shared_ptr<Event> &event) {
-        // if (event->GetTrain()->GetTrainNumber() == train_number) {
-        auto vehicles = event->GetState().connected_vehicles_;
-        auto hit = std::find_if(vehicles.begin(), vehicles.end(),
-                                [&](int id) { return vehicle_id == id; });
-        if (hit != vehicles.end()) {
-          oss << TrainTime::Time_tToString(event->GetEventTime()) << " "
-              << "Train: " << event->GetTrain()->GetTrainNumber() << " from "
-              << event->GetTrain()->GetDepartureStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalDepartureTime())
-              << ") to " << event->GetTrain()->GetArrivalStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalArrivalTime())
-              << ") Train status: " << event->GetState().train_status_ << "\n";
-          if (high_detail_level) {
-            auto connected_vehicles = event->GetState().connected_vehicles_;
-            std::for_each(connected_vehicles.begin(), connected_vehicles.end(),
-                          [&](int &vehicle_id) {
-                            std::shared_ptr<Vehicle> vehicle_out;
-                            event->GetTrain()->GetVehicleById(vehicle_id,
-                                                              vehicle_out);
-                            oss << vehicle_out->GetDetails() << "\n";
-                          });
-            oss << event->GetTrain()->ListDemandedVehiclesFromState(
-                       event->GetState().demanded_vehicles_)
-                << "\n";
-          }
-          i++;
-        }
-      });
-  details_out = oss.str();
-  return i != 0;
-}
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "vehicle.h"  //NOLINT
 
@@ -51,6 +52,13 @@ bool Station::GetVehicleById(int id,
 
 int Station::GetNumberOfVehicles() { return vehicle_pool_.size(); }
 
+void Station::AppendVehicleIds(std::vector<int> &ids_out) const {
+  std::for_each(vehicle_pool_.begin(), vehicle_pool_.end(),
+                [&ids_out](const std::shared_ptr<Vehicle> &vehicle) {
+                  ids_out.emplace_back(vehicle->GetId());
+                });
+}
+
 bool operator==(std::shared_ptr<Station> &lhs, //NOLINT
                 std::shared_ptr<Station> &rhs) {  // NOLINT
   return lhs->GetId() == rhs->GetId();
@@ -0,0 +1,19 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "string_table.h"  //NOLINT
+
+int StringTable::Intern(const std::string &text) {
+  auto inserted = ids_.emplace(text, static_cast<int>(strings_.size()));
+  if (inserted.second) strings_.emplace_back(text);
+  return inserted.first->second;
+}
+
+bool StringTable::Find(const std::string &text, int &id_out) const {
+  auto it = ids_.find(text);
+  if (it == ids_.end()) return false;
+  id_out = it->second;
+  return true;
+}
@@ -6,15 +6,20 @@
 #include "t_s_manager.h" //NOLINT
 
 #include <algorithm>
-#include <ctime>
+#include <chrono>
 #include <fstream>
-#include <iomanip>
+#include <limits>
 #include <memory>
 #include <queue>
+#include <sstream>
 #include <vector>
 
+#include "data_loader.h" //NOLINT
+#include "event.h" //NOLINT
+#include "simulation_snapshot.h" //NOLINT
 #include "simulator.h" //NOLINT
 #include "station.h" //NOLINT
+#include "text_buffer.h" //NOLINT
 #include "train.h" //NOLINT
 #include "train_map.h" //NOLINT
 #include "train_time.h" //NOLINT
@@ -29,218 +34,527 @@ TrainStationManager::TrainStationManager(std::shared_ptr<Simulator> simulator,
       high_log_level_train_(false),
       high_log_level_stats_(false),
       high_log_level_vehicle_(false) {
-  loadStations(station_path);
-  loadTrains(trains_path);
-  loadMap(map_path);
+  DataLoader loader(station_path, trains_path, map_path);
+  addStations(loader.GetStations());
+  addTrains(loader.GetTrains());
+  addDistances(loader.GetDistances());
+  setRunTimes();
+  setSimulationHorizon();
   setVehicleDistributionFromStart();
 }
 
-void TrainStationManager::loadStations(const std::string &path) {
-  std::ifstream file(path);
-  if (file.is_open()) {
-    int station_id = 1;
-    while (file.peek() != EOF) {
-      std::string line;
-      std::getline(file, line);
-      std::istringstream iss(line);
-      std::string name;
-      iss >> name;
-      auto station = std::make_shared<Station>(station_id, name);
-      station_id++;
-      while (iss.peek() != EOF) {
-        std::string dummy, line1;
-        std::getline(iss, dummy, '(');
-        std::getline(iss, line1, ')');
-        std::istringstream isss(line1);
-        int id, type, param_0, param_1;
-        isss >> id >> type >> param_0;
-        if (type == 0) {
-          isss >> param_1;
-          station->AddToPool(std::make_shared<CoachCar>(id, param_0, param_1));
-        } else if (type == 1) {
-          station->AddToPool(std::make_shared<SleepingCar>(id, param_0));
-        } else if (type == 2) {
-          isss >> param_1;
-          station->AddToPool(std::make_shared<OpenCar>(id, param_0, param_1));
-        } else if (type == 3) {
-          station->AddToPool(std::make_shared<CoveredCar>(id, param_0));
-        } else if (type == 4) {
-          isss >> param_1;
-          station->AddToPool(
-              std::make_shared<Electrical>(id, param_0, param_1));
-        } else if (type == 5) {
-          isss >> param_1;
-          station->AddToPool(std::make_shared<Diesel>(id, param_0, param_1));
-        }
-      }
-      stations_.emplace_back(station);
+TrainStationManager::TrainStationManager(
+    std::shared_ptr<Simulator> simulator, const TrainStationManager &base,
+    const std::vector<std::size_t> &trains,
+    const std::vector<DepartureEdit> &edits)
+    : distances_(base.distances_),
+      station_names_(base.station_names_),
+      distance_by_route_(base.distance_by_route_),
+      vehicle_by_id_(base.vehicle_by_id_),
+      simulator_(simulator),
+      run_time_model_(base.run_time_model_),
+      parameters_(base.parameters_),
+      disruptions_(base.disruptions_),
+      high_log_level_vehicle_(false),
+      high_log_level_station_(false),
+      high_log_level_train_(false),
+      high_log_level_stats_(false) {
+  stations_.reserve(base.stations_.size());
+  std::for_each(base.stations_.begin(), base.stations_.end(),
+                [this](const std::shared_ptr<Station> &station) {
+                  stations_.emplace_back(std::make_shared<Station>(
+                      station->GetId(), station->GetName()));
+                });
+  trains_.reserve(trains.size());
+  for (std::size_t index : trains) {
+    const Train &train = *base.trains_[index];
+    const TrainLine &line = train.GetTrainLine();
+    auto edit = std::find_if(edits.begin(), edits.end(),
+                             [&train](const DepartureEdit &e) {
+                               return e.train_number == train.GetTrainNumber();
+                             });
+    std::shared_ptr<Train> copy;
+    if (edit == edits.end()) {
+      copy = std::make_shared<Train>(line);
+    } else {
+      SimTime shift = edit->departure_time - line.GetDepartureTime();
+      copy = std::make_shared<Train>(TrainLine(
+          line.GetMaxSpeed(), line.GetTrainNumber(),
+          line.GetDemandedVehicles(), line.GetDepartureStationId(),
+          line.GetArrivalStationId(), edit->departure_time,
+          line.GetArrivalTime() + shift, &station_names_));
     }
-    file.close();
-  } else {
-    throw std::runtime_error("Could not open file " + path);
-  }
-}
-
-void TrainStationManager::loadTrains(const std::string &path) {
-  std::ifstream file(path);
-  if (file.is_open()) {
-    while (file.peek() != EOF) {
-      std::string line;
-      std::getline(file, line);
-      std::istringstream iss(line);
-      std::string dep_st, arr_st;
-      std::tm time1{}, time2{};
-      int id, max_speed;
-      iss >> id >> dep_st >> arr_st >> std::get_time(&time1, "%H:%M") >>
-          std::get_time(&time2, "%H:%M") >> max_speed;
-      time_t today = time(nullptr);
-      std::tm todayStruct{};
-      gmtime_r(&today,&todayStruct);
-      todayStruct.tm_hour = time1.tm_hour;
-      todayStruct.tm_min = time1.tm_min;
-      todayStruct.tm_sec = 0;
-      time_t departure_time = mktime(&todayStruct);
-      todayStruct.tm_hour = time2.tm_hour;
-      todayStruct.tm_min = time2.tm_min;
-      time_t arrival_time = mktime(&todayStruct);
-      std::vector<int> vehicle_types;
-      while (iss.peek() != EOF) {
-        int type;
-        iss >> type;
-        vehicle_types.emplace_back(type);
+    copy->SetRunTimeIndex(train.GetRunTimeIndex());
+    train_index_by_number_.emplace(copy->GetTrainNumber(), trains_.size());
+    trains_.emplace_back(copy);
+  }
+  indexClosedRoutes();
+}
+
+void TrainStationManager::addStations(
+    const std::vector<StationRecord> &records) {
+  stations_.reserve(records.size());
+  for (const StationRecord &record : records) {
+    int name_id = station_names_.Intern(record.name);
+    auto station = std::make_shared<Station>(name_id + 1, record.name);
+    for (const std::shared_ptr<Vehicle> &vehicle : record.vehicles) {
+      run_time_model_.AddToFleet(*vehicle);
+      vehicle_by_id_.emplace(vehicle->GetId(), vehicle);
+      station->AddToPool(vehicle);
+    }
+    stations_.emplace_back(station);
+  }
+}
+
+void TrainStationManager::addTrains(const std::vector<TrainRecord> &records) {
+  trains_.reserve(records.size());
+  train_index_by_number_.reserve(records.size());
+  std::for_each(records.begin(), records.end(),
+                [this](const TrainRecord &record) {
+                  auto train = std::make_shared<Train>(TrainLine(
+                      record.max_speed, record.number, record.vehicle_types,
+                      station_names_.Intern(record.departure_station),
+                      station_names_.Intern(record.arrival_station),
+                      record.departure_time, record.arrival_time,
+                      &station_names_));
+                  train_index_by_number_.emplace(train->GetTrainNumber(),
+                                                 trains_.size());
+                  trains_.emplace_back(train);
+                });
+}
+
+void TrainStationManager::addDistances(
+    const std::vector<DistanceRecord> &records) {
+  distances_.reserve(records.size());
+  distance_by_route_.reserve(records.size());
+  std::for_each(records.begin(), records.end(),
+                [this](const DistanceRecord &record) {
+                  int station_1 = station_names_.Intern(record.station_1);
+                  int station_2 = station_names_.Intern(record.station_2);
+                  distances_.emplace_back(station_1, station_2,
+                                          record.distance);
+                  distance_by_route_.emplace(routeKey(station_1, station_2),
+                                             record.distance);
+                });
+}
+
+std::uint64_t TrainStationManager::routeKey(int station_1, int station_2) {
+  if (station_1 > station_2) std::swap(station_1, station_2);
+  return static_cast<std::uint64_t>(station_1) << 32 |
+         static_cast<std::uint32_t>(station_2);
+}
+
+std::uint64_t TrainStationManager::routeKey(const Train &train) {
+  return routeKey(train.GetDepartureStationId(), train.GetArrivalStationId());
+}
+
+void TrainStationManager::LoadDisruptions(const std::string &path) {
+  std::vector<DisruptionRecord> records = DataLoader::LoadDisruptions(path);
+  std::vector<std::string> problems;
+  auto find_station = [&](const DisruptionRecord &record,
+                          const std::string &name, int &id_out) {
+    if (station_names_.Find(name, id_out) &&
+        static_cast<std::size_t>(id_out) < stations_.size()) {
+      return true;
+    }
+    problems.emplace_back(path + ":" + std::to_string(record.line) +
+                          ": unknown station " + name);
+    return false;
+  };
+  for (const DisruptionRecord &record : records) {
+    std::string at = path + ":" + std::to_string(record.line) + ": ";
+    Disruption disruption = {record.type, -1,        -1,
+                             record.from, record.to, record.max_speed};
+    bool valid = find_station(record, record.station_1, disruption.station_1);
+    if (record.type != DisruptionType::POOL_FREEZE) {
+      valid = find_station(record, record.station_2, disruption.station_2) &&
+              valid;
+      if (valid && distance_by_route_.count(routeKey(
+                       disruption.station_1, disruption.station_2)) == 0) {
+        problems.emplace_back(at + "no distance from " + record.station_1 +
+                              " to " + record.station_2);
+        valid = false;
       }
-      TrainLine train_template(max_speed, id, vehicle_types, dep_st, arr_st,
-                               departure_time, arrival_time);
-      trains_.emplace_back(std::make_shared<Train>(train_template));
     }
-    file.close();
-  } else {
-    throw std::runtime_error("Could not open file " + path);
+    if (record.to <= record.from) {
+      problems.emplace_back(at + "the disruption ends before it starts");
+      valid = false;
+    }
+    if (record.type == DisruptionType::SPEED_RESTRICTION &&
+        record.max_speed <= 0) {
+      problems.emplace_back(at + "the speed limit has to be positive");
+      valid = false;
+    }
+    if (valid) {
+      disruptions_.Add(disruption, routeKey(disruption.station_1,
+                                            disruption.station_2));
+    }
+  }
+  if (!problems.empty()) {
+    std::string message = "Invalid disruptions:";
+    for (const std::string &problem : problems) message += "\n" + problem;
+    throw std::runtime_error(message);
   }
+
+  indexClosedRoutes();
 }
 
-void TrainStationManager::loadMap(const std::string &path) {
-  std::ifstream file(path);
-  if (file.is_open()) {
-    while (file.peek() != EOF) {
-      std::string line;
-      std::getline(file, line);
-      std::istringstream iss(line);
-      std::string st_1, st_2;
-      int dist;
-      iss >> st_1 >> st_2 >> dist;
-      distances_.emplace_back(std::make_shared<Distance>(st_1, st_2, dist));
+void TrainStationManager::indexClosedRoutes() {
+  // Only the routes with a closure are indexed, that is where
+  // ApplyDisruption looks for trains.
+  trains_by_route_.clear();
+  for (std::size_t i = 0; i < disruptions_.Size(); i++) {
+    const Disruption &disruption = disruptions_.Get(i);
+    if (disruption.type == DisruptionType::CLOSURE) {
+      trains_by_route_[routeKey(disruption.station_1, disruption.station_2)];
     }
-    file.close();
+  }
+  if (trains_by_route_.empty()) return;
+  for (std::size_t i = 0; i < trains_.size(); i++) {
+    auto it = trains_by_route_.find(routeKey(*trains_[i]));
+    if (it != trains_by_route_.end()) it->second.push_back(i);
+  }
+}
+
+void TrainStationManager::setSimulationHorizon() {
+  SimTime last_time = 0;
+  std::for_each(trains_.begin(), trains_.end(),
+                [&last_time](std::shared_ptr<Train> &train) {
+                  last_time =
+                      std::max(last_time, train->GetOriginalArrivalTime());
+                });
+  std::shared_ptr<Simulator> simulator = simulator_.lock();
+  SimTime stop_time = stopTimeFor(last_time);
+  if (stop_time > simulator->GetStopTime()) {
+    simulator->SetStopSimulationTime(stop_time);
+    simulator->SetStopTime(stop_time);
+  }
+}
+
+SimTime TrainStationManager::stopTimeFor(SimTime last_arrival) {
+  SimTime days = last_arrival / TrainTime::kSecondsPerDay + 1;
+  return days * TrainTime::kSecondsPerDay - 60;
+}
+
+void TrainStationManager::Setup() {
+  std::vector<std::vector<int>> start_pools(stations_.size());
+  for (std::size_t i = 0; i < stations_.size(); i++) {
+    stations_[i]->AppendVehicleIds(start_pools[i]);
+  }
+  vehicle_flow_.Start(std::move(start_pools), trains_.size());
+  delay_attribution_.Start(trains_.size());
+  indexArrivals();
+  loadEvents();
+  PublishSnapshot();
+}
+
+void TrainStationManager::PublishSnapshot() {
+  std::shared_ptr<SimulationSnapshot> snapshot;
+  if (retired_snapshot_ && retired_snapshot_.use_count() == 1) {
+    // The last reader has let go of it. The fence orders the reads of that
+    // reader before the writes below.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    snapshot = std::move(retired_snapshot_);
   } else {
-    throw std::runtime_error("Could not open file " + path);
+    snapshot = std::make_shared<SimulationSnapshot>();
   }
+  std::shared_ptr<Simulator> simulator = simulator_.lock();
+  snapshot->current_time = simulator->GetCurrentTime();
+  snapshot->total_delay = simulator->GetTotalDelay();
+  snapshot->total_departure_delay = simulator->GetTotalDepartureDelay();
+  snapshot->trains.clear();
+  snapshot->vehicle_ids.clear();
+  snapshot->demanded_vehicles.clear();
+  std::for_each(trains_.begin(), trains_.end(),
+                [&snapshot](const std::shared_ptr<Train> &train) {
+                  const std::vector<int> &vehicles =
+                      train->GetConnectedVehicles();
+                  const std::vector<int> &demanded =
+                      train->GetDemandedVehicles();
+                  snapshot->trains.push_back(
+                      {train->GetTrainStatus(),
+                       train->GetPlanedDepartureTime(),
+                       train->GetExpectedArrivalTime(),
+                       snapshot->vehicle_ids.size(), vehicles.size(),
+                       snapshot->demanded_vehicles.size(), demanded.size()});
+                  snapshot->vehicle_ids.insert(snapshot->vehicle_ids.end(),
+                                               vehicles.begin(),
+                                               vehicles.end());
+                  snapshot->demanded_vehicles.insert(
+                      snapshot->demanded_vehicles.end(), demanded.begin(),
+                      demanded.end());
+                });
+  snapshot->station_first_vehicle.clear();
+  snapshot->parked_vehicle_ids.clear();
+  std::for_each(stations_.begin(), stations_.end(),
+                [&snapshot](const std::shared_ptr<Station> &station) {
+                  snapshot->station_first_vehicle.push_back(
+                      snapshot->parked_vehicle_ids.size());
+                  station->AppendVehicleIds(snapshot->parked_vehicle_ids);
+                });
+  snapshot->station_first_vehicle.push_back(
+      snapshot->parked_vehicle_ids.size());
+
+  std::atomic_store(&snapshot_,
+                    std::shared_ptr<const SimulationSnapshot>(snapshot));
+  retired_snapshot_ = std::move(published_snapshot_);
+  published_snapshot_ = std::move(snapshot);
+}
+
+std::shared_ptr<const SimulationSnapshot> TrainStationManager::GetSnapshot()
+    const {
+  return std::atomic_load(&snapshot_);
 }
 
 void TrainStationManager::loadEvents() {
   if (!trains_.empty()) {
+    // The lifecycles are only kept for the trains a closure can re-plan,
+    // the others are freed when they finish.
+    if (!trains_by_route_.empty()) lifecycles_.resize(trains_.size());
+    std::size_t index = 0;
     std::for_each(
         trains_.begin(), trains_.end(), [&](std::shared_ptr<Train> &train) {
           train->SetTrainStatus(TrainStatus::NOT_ASSEMBLED);
           train->SetPlanedDepartureTime(train->GetPlanedDepartureTime());
-          std::shared_ptr<Event> e = std::make_shared<NotAssembled>(
-              NotAssembled(shared_from_this(), simulator_.lock(), train,
-                           train->GetOriginalDepartureTime() - (30 * 60)));
+          std::shared_ptr<Event> e = std::make_shared<TrainLifecycle>(
+              shared_from_this(), simulator_.lock(), train,
+              train->GetOriginalDepartureTime() -
+                  parameters_.GetAssembleBefore());
           simulator_.lock()->AddEvent(e);
+          if (!lifecycles_.empty() &&
+              trains_by_route_.count(routeKey(*train)) != 0) {
+            lifecycles_[index] = e;
+          }
+          index++;
         });
+    for (std::size_t i = 0; i < disruptions_.Size(); i++) {
+      simulator_.lock()->AddEvent(std::make_shared<DisruptionStart>(
+          shared_from_this(), simulator_.lock(), i, disruptions_.Get(i).from));
+    }
   } else {
     throw std::runtime_error("Trains list is empty!");
   }
 }
 
+Train TrainStationManager::snapshotTrain(const SimulationSnapshot &snapshot,
+                                         std::size_t index) const {
+  const TrainSnapshot &state = snapshot.trains[index];
+  Train train(trains_[index]->GetTrainLine());
+  train.SetTrainStatus(state.train_status);
+  train.SetPlanedDepartureTime(state.planed_departure_time);
+  train.SetExpectedArrivalTime(state.expected_arrival_time);
+  auto demanded = snapshot.demanded_vehicles.begin() + state.first_demanded;
+  train.GetDemandedVehicles().assign(demanded,
+                                     demanded + state.demanded_count);
+  for (std::size_t i = state.first_vehicle;
+       i < state.first_vehicle + state.vehicle_count; i++) {
+    std::shared_ptr<Vehicle> vehicle =
+        vehicle_by_id_.at(snapshot.vehicle_ids[i]);
+    train.AddVehicle(vehicle);
+  }
+  return train;
+}
+
+/** Returns the index of the train the vehicle is connected to in the
+ * snapshot, or the number of trains if it is not connected. */
+static std::size_t findTrainWithVehicle(const SimulationSnapshot &snapshot,
+                                        int vehicle_id) {
+  auto it = std::find_if(
+      snapshot.trains.begin(), snapshot.trains.end(),
+      [&](const TrainSnapshot &train) {
+        auto begin = snapshot.vehicle_ids.begin() + train.first_vehicle;
+        auto end = begin + train.vehicle_count;
+        return std::find(begin, end, vehicle_id) != end;
+      });
+  return static_cast<std::size_t>(it - snapshot.trains.begin());
+}
+
 std::string TrainStationManager::SeeTimeTable() {
-  std::priority_queue<std::shared_ptr<Train>,
-                      std::vector<std::shared_ptr<Train>>, SortOnDepartureTime>
+  std::shared_ptr<const SimulationSnapshot> snapshot = GetSnapshot();
+  std::vector<Train> trains;
+  trains.reserve(snapshot->trains.size());
+  for (std::size_t i = 0; i < snapshot->trains.size(); i++) {
+    trains.emplace_back(snapshotTrain(*snapshot, i));
+  }
+  std::priority_queue<const Train *, std::vector<const Train *>,
+                      SortOnDepartureTime>
       train_pri_list;
-  std::for_each(
-      trains_.begin(), trains_.end(),
-      [&](std::shared_ptr<Train> &train) { train_pri_list.push(train); });
-  std::ostringstream oss;
-  oss << std::left << std::setw(16) << "Time" << std::setw(8) << "Number"
-      << std::setw(20) << "Origin" << std::setw(16) << "Time" << std::setw(20)
-      << "Destination"
-      << "Delay\n";
+  std::for_each(trains.begin(), trains.end(),
+                [&](const Train &train) { train_pri_list.push(&train); });
+  TextBuffer out(128 * (trains.size() + 4));
+  out << "Time                  Number  Origin              "
+         "Time                  Destination         Delay\n";
   while (!train_pri_list.empty()) {
-    oss << train_pri_list.top()->GetTimeTableData() << "\n";
+    train_pri_list.top()->AppendTimeTableData(out);
+    out << '\n';
     train_pri_list.pop();
   }
-  if (simulator_.lock()->GetTotalDelay() > 0) {
-    oss << std::setw(80) << "Total delay so far:"
-        << std::string("+" + TrainTime::SecondsToPretty(static_cast<int>(
-                                 simulator_.lock()->GetTotalDelay())))
-        << "\n";
+  if (snapshot->total_delay > 0) {
+    std::size_t start = out.Size();
+    out << "Total delay so far:";
+    out.PadFrom(start, 80) << '+';
+    out.AppendDuration(static_cast<int>(snapshot->total_delay)) << '\n';
   }
-  if (simulator_.lock()->GetTotalDepartureDelay() > 0) {
-    oss << std::setw(80) << "Total departure delay so far:"
-        << std::string("+" + TrainTime::SecondsToPretty(static_cast<int>(
-                                 simulator_.lock()->GetTotalDepartureDelay())));
+  if (snapshot->total_departure_delay > 0) {
+    std::size_t start = out.Size();
+    out << "Total departure delay so far:";
+    out.PadFrom(start, 80) << '+';
+    out.AppendDuration(static_cast<int>(snapshot->total_departure_delay));
   }
-  return oss.str();
+  return out.Str();
 }
 
-bool TrainStationManager::TryAssemble(int id) {
-  std::shared_ptr<Train> train = GetTrainByTrainNumber(id);
-  int size = train->GetDemandedVehicles().size();
-  std::shared_ptr<Station> station =
-      GetStationByName(train->GetDepartureStation());
+bool TrainStationManager::TryAssemble(Train &train, SimTime time) {
+  if (disruptions_.IsFrozen(train.GetDepartureStationId(), time)) {
+    return false;
+  }
+  int size = train.GetDemandedVehicles().size();
+  Station &station = *stations_[train.GetDepartureStationId()];
+  std::size_t train_index = trainIndex(train);
   int index = 0;
   while (size != 0 && index < size) {
     std::shared_ptr<Vehicle> vehicle;
-    if (station->GetVehicleByType(
-            *(train->GetDemandedVehicles().begin() + index), vehicle)) {
-      train->GetDemandedVehicles().erase(train->GetDemandedVehicles().begin() +
-                                         index);
-      train->AddVehicle(vehicle);
+    if (station.GetVehicleByType(
+            *(train.GetDemandedVehicles().begin() + index), vehicle)) {
+      train.GetDemandedVehicles().erase(train.GetDemandedVehicles().begin() +
+                                        index);
+      vehicle_flow_.AddTaken(time, train.GetDepartureStationId(), train_index,
+                             vehicle->GetId());
+      train.AddVehicle(vehicle);
       size--;
     } else {
       index++;
     }
   }
-  if (size == 0)
+  if (size == 0) {
+    vehicle_flow_.SetAssembled(train_index, time);
     return true;
-  else
+  } else {
     return false;
+  }
 }
 
-void TrainStationManager::DisAssemble(int id) {
-  std::shared_ptr<Train> train = GetTrainByTrainNumber(id);
-  std::shared_ptr<Station> station =
-      GetStationByName(train->GetArrivalStation());
+void TrainStationManager::DisAssemble(Train &train, SimTime time) {
+  Station &station = *stations_[train.GetArrivalStationId()];
+  std::size_t train_index = trainIndex(train);
   std::shared_ptr<Vehicle> vehicle_out;
-  while (train->PopVehicle(vehicle_out)) {
-    station->AddToPool(std::move(vehicle_out));
+  while (train.PopVehicle(vehicle_out)) {
+    vehicle_flow_.AddReturned(time, train.GetArrivalStationId(), train_index,
+                              vehicle_out->GetId());
+    station.AddToPool(std::move(vehicle_out));
+  }
+}
+
+void TrainStationManager::ReturnVehicle(int station, int vehicle_id) {
+  stations_[station]->AddToPool(vehicle_by_id_.at(vehicle_id));
+}
+
+std::size_t TrainStationManager::trainIndex(const Train &train) const {
+  return train_index_by_number_.at(train.GetTrainNumber());
+}
+
+void TrainStationManager::indexArrivals() {
+  arriving_.assign(stations_.size(), std::vector<std::size_t>());
+  for (std::size_t i = 0; i < trains_.size(); i++) {
+    arriving_[trains_[i]->GetArrivalStationId()].push_back(i);
+  }
+  for (std::vector<std::size_t> &trains : arriving_) {
+    std::stable_sort(trains.begin(), trains.end(),
+                     [this](std::size_t first, std::size_t second) {
+                       return trains_[first]->GetOriginalArrivalTime() <
+                              trains_[second]->GetOriginalArrivalTime();
+                     });
+  }
+  first_unfinished_.assign(stations_.size(), 0);
+}
+
+DelayCause TrainStationManager::findLateSupplier(int station,
+                                                 int vehicle_type,
+                                                 SimTime time,
+                                                 std::size_t waiting_train,
+                                                 SimTime &lateness_out) {
+  const std::vector<std::size_t> &arriving = arriving_[station];
+  std::size_t &first = first_unfinished_[station];
+  while (first < arriving.size() &&
+         trains_[arriving[first]]->GetTrainStatus() == TrainStatus::FINISHED) {
+    first++;
+  }
+  // A train on time has returned its vehicles a turnaround after it
+  // arrived, so the unfinished trains that should have done that by now are
+  // late.
+  for (std::size_t i = first; i < arriving.size(); i++) {
+    const Train &supplier = *trains_[arriving[i]];
+    SimTime returned =
+        supplier.GetOriginalArrivalTime() + parameters_.turnaround_s;
+    if (returned > time) break;
+    if (arriving[i] == waiting_train ||
+        supplier.GetTrainStatus() == TrainStatus::FINISHED) {
+      continue;
+    }
+    const std::vector<int> &types =
+        supplier.GetTrainLine().GetDemandedVehicles();
+    if (std::find(types.begin(), types.end(), vehicle_type) != types.end()) {
+      lateness_out = time - returned;
+      return DelayCause{DelayCauseType::LATE_TRAIN, arriving[i]};
+    }
+  }
+  lateness_out = 0;
+  return DelayCause{DelayCauseType::SHORTAGE,
+                    static_cast<std::size_t>(station)};
+}
+
+void TrainStationManager::AddWait(const Train &train, SimTime time,
+                                  SimTime seconds) {
+  std::size_t train_index = trainIndex(train);
+  int station = train.GetDepartureStationId();
+  if (disruptions_.IsFrozen(station, time)) {
+    delay_attribution_.AddWait(
+        time, train_index, -1, seconds,
+        DelayCause{DelayCauseType::FROZEN_POOL,
+                   static_cast<std::size_t>(station)},
+        0);
+    return;
+  }
+  // The wait is split evenly over the missing types, the first one gets
+  // what does not divide evenly.
+  const std::vector<int> &missing = train.GetDemandedVehicles();
+  auto first_of_type = [&missing](std::size_t i) {
+    return std::find(missing.begin(), missing.end(), missing[i]) ==
+           missing.begin() + i;
+  };
+  SimTime types = 0;
+  for (std::size_t i = 0; i < missing.size(); i++) {
+    if (first_of_type(i)) types++;
+  }
+  if (types == 0) return;
+  SimTime share = seconds / types;
+  SimTime rest = seconds - share * types;
+  for (std::size_t i = 0; i < missing.size(); i++) {
+    if (!first_of_type(i)) continue;
+    SimTime lateness;
+    DelayCause cause =
+        findLateSupplier(station, missing[i], time, train_index, lateness);
+    delay_attribution_.AddWait(time, train_index, missing[i], share + rest,
+                               cause, lateness);
+    rest = 0;
   }
 }
 
 std::shared_ptr<Station> TrainStationManager::GetStationByName(
     const std::string &name) {
-  auto it = std::find_if(stations_.begin(), stations_.end(),
-                         [&name](std::shared_ptr<Station> &station) {
-                           return station->GetName() == name;
-                         });
-  if (it != stations_.end()) {
-    return *it;
+  int id;
+  if (station_names_.Find(name, id) &&
+      static_cast<std::size_t>(id) < stations_.size()) {
+    return stations_[id];
   } else {
     throw std::runtime_error("There is no station with that name");
   }
 }
 
 std::shared_ptr<Train> TrainStationManager::GetTrainByTrainNumber(int number) {
-  auto it = std::find_if(trains_.begin(), trains_.end(),
-                         [number](std::shared_ptr<Train> &train) {
-                           if (train->GetTrainNumber() == number) {
-                             return true;
-                           } else {
-                             return false;
-                           }
-                         });
-  if (it != trains_.end()) {
-    return *it;
+  auto it = train_index_by_number_.find(number);
+  if (it != train_index_by_number_.end()) {
+    return trains_[it->second];
   } else {
     throw std::runtime_error("There is no train with that name");
   }
@@ -279,167 +593,128 @@ void TrainStationManager::SetHighLogLevelStats(bool high_log_level_stats) {
 }
 
 std::string TrainStationManager::GetTrainDetailsByTrainNumber(
-    int train_number) {
-  std::string details;
-  auto it = std::find_if(
-      trains_.begin(), trains_.end(), [&](std::shared_ptr<Train> &train) {
-        if (train->GetTrainNumber() == train_number) {
-          details = train->GetTrainDetails(IsHighLogLevelTrain());
-          return true;
-        } else {
-          return false;
-        }
-      });
-  if (it != trains_.end()) {
-    return details;
+    int train_number, bool high_detail_level) {
+  auto it = train_index_by_number_.find(train_number);
+  if (it != train_index_by_number_.end()) {
+    return snapshotTrain(*GetSnapshot(), it->second)
+        .GetTrainDetails(high_detail_level);
   } else {
     throw std::runtime_error("There is no train with this number");
   }
 }
 
 std::string TrainStationManager::ListAllStationNames() {
-  std::ostringstream oss;
-  oss << "Names:\n";
+  TextBuffer out;
+  out << "Names:\n";
   std::for_each(stations_.begin(), stations_.end(),
-                [&oss](std::shared_ptr<Station> &station) {
-                  oss << station->GetName() << "\n";
+                [&out](std::shared_ptr<Station> &station) {
+                  out << station->GetName() << '\n';
                 });
-  return oss.str();
+  return out.Str();
 }
 
 std::shared_ptr<Vehicle> TrainStationManager::FindVehicle(
     int id, std::string &location) {
   std::shared_ptr<Vehicle> vehicle_out;
-  auto it1 = std::find_if(
-      stations_.begin(), stations_.end(),
-      [&](std::shared_ptr<Station> &station) {
-        location = std::string(" Parked at: " + station->GetName());
-        return station->GetVehicleById(id, vehicle_out);
-      });
-  if (it1 != stations_.end()) {
-    return vehicle_out;
-  }
-  auto it2 = std::find_if(
-      trains_.begin(), trains_.end(), [&](std::shared_ptr<Train> &train) {
-        std::ostringstream oss;
-        oss << " connected to train: " << train->GetTrainNumber();
-        location = oss.str();
-        return train->GetVehicleById(id, vehicle_out);
-      });
-  if (it2 != trains_.end()) {
-    return vehicle_out;
-  } else {
+  if (!findVehicle(id, vehicle_out, &location)) {
     throw std::runtime_error("This vehicle id does not exists");
   }
+  return vehicle_out;
+}
+
+bool TrainStationManager::findVehicle(int id,
+                                      std::shared_ptr<Vehicle> &vehicle_out,
+                                      std::string *location) {
+  auto it = vehicle_by_id_.find(id);
+  if (it == vehicle_by_id_.end()) return false;
+  vehicle_out = it->second;
+  if (!location) return true;
+  std::shared_ptr<const SimulationSnapshot> snapshot = GetSnapshot();
+  const std::vector<std::size_t> &first = snapshot->station_first_vehicle;
+  for (std::size_t station = 0; station + 1 < first.size(); station++) {
+    auto begin = snapshot->parked_vehicle_ids.begin() + first[station];
+    auto end = snapshot->parked_vehicle_ids.begin() + first[station + 1];
+    if (std::find(begin, end, id) != end) {
+      *location =
+          " Parked at: " + station_names_.Get(static_cast<int>(station));
+      return true;
+    }
+  }
+  std::size_t index = findTrainWithVehicle(*snapshot, id);
+  if (index < trains_.size()) {
+    *location = " connected to train: " +
+                std::to_string(trains_[index]->GetTrainNumber());
+    return true;
+  }
+  return false;
+}
+
+void TrainStationManager::appendLifeCycleEvent(TextBuffer &out,
+                                               const State &state,
+                                               bool high_detail_level) {
+  out.AppendTime(state.event_time_) << ' ';
+  GetTrainByTrainNumber(state.train_number_)
+      ->AppendDataToLogLow(out, state.planed_departure_time_,
+                           state.expected_arrival_time_, state.train_status_);
+  out << '\n';
+  if (high_detail_level) {
+    std::for_each(state.connected_vehicles_.begin(),
+                  state.connected_vehicles_.end(), [&](const int &vehicle_id) {
+                    std::shared_ptr<Vehicle> vehicle_out;
+                    if (findVehicle(vehicle_id, vehicle_out, nullptr)) {
+                      vehicle_out->AppendDetails(out);
+                      out << '\n';
+                    }
+                  });
+    Train::AppendDemandedVehicles(state.demanded_vehicles_, out);
+    out << '\n';
+  }
 }
 
 bool TrainStationManager::GetTrainLifeCycleByTrainNumber(
-    int train_number, std::string &details_out) {
-  std::ostringstream oss;
+    int train_number, bool high_detail_level, std::string &details_out) {
+  TextBuffer out(4096);
   int i = 0;
-  std::list<std::shared_ptr<Event>> event_log_ =
-      simulator_.lock()->GetEventLog();
-  std::for_each(
-      event_log_.begin(), event_log_.end(), [&](std::shared_ptr<Event> &event) {
-        if (event->GetTrain()->GetTrainNumber() == train_number) {
-          oss << TrainTime::Time_tToString(event->GetEventTime()) << " "
-              << "Train: " << event->GetTrain()->GetTrainNumber() << " from "
-              << event->GetTrain()->GetDepartureStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalDepartureTime())
-              << ") to " << event->GetTrain()->GetArrivalStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalArrivalTime())
-              << ") Train status: " << event->GetState().train_status_ << "\n";
-          if (high_log_level_stats_) {
-            auto connected_vehicles = event->GetState().connected_vehicles_;
-            std::for_each(connected_vehicles.begin(), connected_vehicles.end(),
-                          [&](int &vehicle_id) {
-                            std::string location;
-                            std::shared_ptr<Vehicle> vehicle_out =
-                                FindVehicle(vehicle_id, location);
-                            event->GetTrain()->GetVehicleById(vehicle_id,
-                                                              vehicle_out);
-                            oss << vehicle_out->GetDetails() << "\n";
-                          });
-            oss << event->GetTrain()->ListDemandedVehiclesFromState(
-                       event->GetState().demanded_vehicles_)
-                << "\n";
-          }
-          i++;
-        }
-      });
-  details_out = oss.str();
+  simulator_.lock()->GetEventLog().ForEach([&](const State &state) {
+    if (state.train_number_ == train_number) {
+      appendLifeCycleEvent(out, state, high_detail_level);
+      i++;
+    }
+  });
+  details_out = out.Str();
   return i != 0;
 }
 
 bool TrainStationManager::GetTrainLifeCycleByVehicleId(
-    int vehicle_id, std::string &details_out) {
-  std::ostringstream oss;
+    int vehicle_id, bool high_detail_level, std::string &details_out) {
+  TextBuffer out(4096);
   int i = 0;
-  std::list<std::shared_ptr<Event>> event_log_ =
-      simulator_.lock()->GetEventLog();
-  std::for_each(
-      event_log_.begin(), event_log_.end(), [&](std::shared_ptr<Event> &event) {
-        auto vehicles = event->GetState().connected_vehicles_;
-        auto hit = std::find_if(vehicles.begin(), vehicles.end(),
-                                [&](int id) { return vehicle_id == id; });
-        if (hit != vehicles.end()) {
-          oss << TrainTime::Time_tToString(event->GetEventTime()) << " "
-              << "Train: " << event->GetTrain()->GetTrainNumber() << " from "
-              << event->GetTrain()->GetDepartureStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalDepartureTime())
-              << ") to " << event->GetTrain()->GetArrivalStation() << " "
-              << TrainTime::Time_tToString(
-                     event->GetState().planed_departure_time_)
-              << " ("
-              << TrainTime::Time_tToString(
-                     event->GetTrain()->GetOriginalArrivalTime())
-              << ") Train status: " << event->GetState().train_status_ << "\n";
-          if (high_log_level_stats_) {
-            auto connected_vehicles = event->GetState().connected_vehicles_;
-            std::for_each(connected_vehicles.begin(), connected_vehicles.end(),
-                          [&](int &vehicle_id) {
-                            std::string location;
-                            std::shared_ptr<Vehicle> vehicle_out =
-                                FindVehicle(vehicle_id, location);
-                            event->GetTrain()->GetVehicleById(vehicle_id,
-                                                              vehicle_out);
-                            oss << vehicle_out->GetDetails() << "\n";
-                          });
-            oss << event->GetTrain()->ListDemandedVehiclesFromState(
-                       event->GetState().demanded_vehicles_)
-                << "\n";
-          }
-          i++;
-        }
-      });
-  details_out = oss.str();
+  simulator_.lock()->GetEventLog().ForEach([&](const State &state) {
+    if (std::find(state.connected_vehicles_.begin(),
+                  state.connected_vehicles_.end(),
+                  vehicle_id) != state.connected_vehicles_.end()) {
+      appendLifeCycleEvent(out, state, high_detail_level);
+      i++;
+    }
+  });
+  details_out = out.Str();
   return i != 0;
 }
 
 std::string TrainStationManager::GetVehicleDistributionStart() {
-  std::ostringstream oss;
+  TextBuffer out;
   std::for_each(
       vehicle_distribution_start.begin(), vehicle_distribution_start.end(),
-      [&oss](std::pair<std::shared_ptr<Station>, int> &pair) {
-        oss << std::left << std::setw(20)
-            << std::string(pair.first->GetName() + ":") << pair.second << "\n";
+      [&out](std::pair<std::shared_ptr<Station>, int> &pair) {
+        std::size_t start = out.Size();
+        out << pair.first->GetName() << ':';
+        out.PadFrom(start, 20) << pair.second << '\n';
       });
-  return oss.str();
+  return out.Str();
 }
 
 void TrainStationManager::setVehicleDistributionFromStart() {
+  vehicle_distribution_start.reserve(stations_.size());
   std::for_each(stations_.begin(), stations_.end(),
                 [&](std::shared_ptr<Station> &station) {
                   vehicle_distribution_start.emplace_back(
@@ -448,93 +723,553 @@ void TrainStationManager::setVehicleDistributionFromStart() {
 }
 
 std::string TrainStationManager::GetTrainsStuckAtStation() {
-  std::ostringstream oss;
+  TextBuffer out(4096);
   std::for_each(trains_.begin(), trains_.end(),
                 [&](std::shared_ptr<Train> &train) {
                   if (train->GetTrainStatus() == TrainStatus::INCOMPLETE) {
-                    oss << train->GetTrainDetails(high_log_level_stats_);
+                    train->AppendTrainDetails(out, high_log_level_stats_);
+                    out << '\n';
                   }
                 });
-  return oss.str();
+  return out.Str();
 }
 
 std::string TrainStationManager::GetTrainsThatArrivedInTime() {
-  std::ostringstream oss;
+  TextBuffer out(4096);
   std::for_each(
       trains_.begin(), trains_.end(), [&](std::shared_ptr<Train> &train) {
         if (train->GetTrainStatus() == TrainStatus::FINISHED &&
             train->GetExpectedArrivalTime() ==
                 train->GetOriginalArrivalTime()) {
-          oss << train->GetTrainDetails(high_log_level_stats_) << "\n";
+          train->AppendTrainDetails(out, high_log_level_stats_);
+          out << '\n';
         }
       });
-  return oss.str();
+  return out.Str();
+}
+
+int TrainStationManager::CountTrainsStuckAtStation() const {
+  return static_cast<int>(
+      std::count_if(trains_.begin(), trains_.end(),
+                    [](const std::shared_ptr<Train> &train) {
+                      return train->GetTrainStatus() == TrainStatus::INCOMPLETE;
+                    }));
+}
+
+int TrainStationManager::CountTrainsThatArrivedInTime() const {
+  return static_cast<int>(std::count_if(
+      trains_.begin(), trains_.end(), [](const std::shared_ptr<Train> &train) {
+        return train->GetTrainStatus() == TrainStatus::FINISHED &&
+               train->GetExpectedArrivalTime() ==
+                   train->GetOriginalArrivalTime();
+      }));
 }
 
 std::string TrainStationManager::GetDelayedTrains() {
-  std::ostringstream oss;
+  TextBuffer out(4096);
   std::for_each(
       trains_.begin(), trains_.end(), [&](std::shared_ptr<Train> &train) {
         if (train->GetExpectedArrivalTime() > train->GetOriginalArrivalTime() &&
             train->GetTrainStatus() != TrainStatus::INCOMPLETE) {
-          oss << train->GetTrainDetails(high_log_level_stats_) << "\n";
+          train->AppendTrainDetails(out, high_log_level_stats_);
+          out << '\n';
         }
       });
-  return oss.str();
+  return out.Str();
+}
+
+bool TrainStationManager::GetVehicleFlowByTrainNumber(
+    int train_number, std::string &details_out) {
+  auto it = train_index_by_number_.find(train_number);
+  if (it == train_index_by_number_.end()) return false;
+  TextBuffer out(1024);
+  out << "Train " << train_number << " got vehicles from:\n";
+  std::vector<FlowEdge> fed_by = vehicle_flow_.GetFedBy(it->second);
+  if (fed_by.empty()) out << "  None\n";
+  std::for_each(fed_by.begin(), fed_by.end(), [&](const FlowEdge &edge) {
+    if (edge.from == VehicleFlowGraph::kStartPool) {
+      out << "  The pool at the start";
+    } else {
+      out << "  Train " << trains_[edge.from]->GetTrainNumber();
+    }
+    out << ", " << edge.vehicles << " vehicles\n";
+  });
+  out << "Its vehicles were taken by:\n";
+  std::vector<FlowEdge> feeds = vehicle_flow_.GetFeeds(it->second);
+  if (feeds.empty()) out << "  None\n";
+  std::for_each(feeds.begin(), feeds.end(), [&](const FlowEdge &edge) {
+    out << "  Train " << trains_[edge.to]->GetTrainNumber() << ", "
+        << edge.vehicles << " vehicles\n";
+  });
+  if (delay_attribution_.GetWaited(it->second) != 0) {
+    // The retries are shown per type and cause, with the first and the last
+    // time it was missing.
+    out << "It waited for:\n";
+    std::vector<WaitRecord> waits;
+    std::vector<SimTime> last_times;
+    for (const WaitRecord &wait : delay_attribution_.GetWaits()) {
+      if (wait.train != it->second) continue;
+      auto same = std::find_if(
+          waits.begin(), waits.end(), [&wait](const WaitRecord &other) {
+            return other.vehicle_type == wait.vehicle_type &&
+                   other.cause == wait.cause;
+          });
+      if (same == waits.end()) {
+        waits.push_back(wait);
+        last_times.push_back(wait.time);
+      } else {
+        same->seconds += wait.seconds;
+        last_times[same - waits.begin()] = wait.time;
+      }
+    }
+    for (std::size_t i = 0; i < waits.size(); i++) {
+      out << "  ";
+      out.AppendTime(waits[i].time) << " - ";
+      out.AppendTime(last_times[i]) << "  ";
+      out.AppendDuration(static_cast<int>(waits[i].seconds)) << "  "
+          << (waits[i].vehicle_type < 0
+                  ? "Vehicles"
+                  : VehicleTypeName(waits[i].vehicle_type))
+          << ", ";
+      appendDelayCause(out, waits[i].cause);
+      out << '\n';
+    }
+  }
+  details_out = out.Str();
+  return true;
+}
+
+void TrainStationManager::appendDelayCause(TextBuffer &out,
+                                           const DelayCause &cause) const {
+  switch (cause.type) {
+    case DelayCauseType::LATE_TRAIN:
+      out << "train " << trains_[cause.index]->GetTrainNumber()
+          << " was late";
+      break;
+    case DelayCauseType::SHORTAGE:
+      out << "too few vehicles at "
+          << station_names_.Get(static_cast<int>(cause.index));
+      break;
+    case DelayCauseType::FROZEN_POOL:
+      out << "frozen pool at "
+          << station_names_.Get(static_cast<int>(cause.index));
+      break;
+  }
+}
+
+std::string TrainStationManager::GetDelayRootCauses() {
+  TextBuffer out(4096);
+  int trains = 0;
+  SimTime waited = 0;
+  for (std::size_t i = 0; i < trains_.size(); i++) {
+    if (delay_attribution_.GetWaited(i) != 0) {
+      trains++;
+      waited += delay_attribution_.GetWaited(i);
+    }
+  }
+  if (trains == 0) {
+    out << "No train waited for vehicles.\n";
+    return out.Str();
+  }
+  out << "Waiting for vehicles delayed " << trains << " trains by ";
+  out.AppendDuration(static_cast<int>(waited)) << ".\n";
+  std::vector<RootShare> totals = delay_attribution_.GetRootTotals();
+  const std::size_t kShown = 10;
+  for (std::size_t i = 0; i < totals.size() && i < kShown; i++) {
+    out << "  ";
+    std::size_t start = out.Size();
+    out.AppendDuration(static_cast<int>(totals[i].seconds));
+    out.PadFrom(start, 8);
+    start = out.Size();
+    out << totals[i].trains << (totals[i].trains == 1 ? " train," : " trains,");
+    out.PadFrom(start, 12);
+    appendDelayCause(out, totals[i].root);
+    out << '\n';
+  }
+  if (totals.size() > kShown) {
+    out << "  and " << static_cast<long long>(totals.size() - kShown)  // NOLINT
+        << " more\n";
+  }
+  return out.Str();
+}
+
+static bool hasArrived(const Train &train) {
+  return train.GetTrainStatus() == TrainStatus::ARRIVED ||
+         train.GetTrainStatus() == TrainStatus::FINISHED;
+}
+
+/** The delay a train adds to the total delay of the simulator. */
+static SimTime arrivalDelay(const Train &train) {
+  if (!hasArrived(train)) return 0;
+  return train.GetExpectedArrivalTime() - train.GetOriginalArrivalTime();
+}
+
+WhatIfRun TrainStationManager::RunWhatIf(
+    const std::vector<DepartureEdit> &edits, SimTime not_arrived_penalty,
+    SimTime cost_limit) const {
+  // A train first tries to assemble before it departs and returns its
+  // vehicles a turnaround after it arrives, and it never arrives before the
+  // time table says.
+  std::vector<TrainWindow> windows;
+  windows.reserve(trains_.size());
+  std::for_each(trains_.begin(), trains_.end(),
+                [this, &windows](const std::shared_ptr<Train> &train) {
+                  windows.push_back(TrainWindow{
+                      train->GetDepartureStationId(),
+                      train->GetArrivalStationId(),
+                      train->GetOriginalDepartureTime() -
+                          parameters_.GetAssembleBefore(),
+                      train->GetOriginalArrivalTime() +
+                          parameters_.turnaround_s});
+                });
+  std::shared_ptr<Simulator> base_simulator = simulator_.lock();
+  SimTime stop_time = base_simulator->GetStopSimulationTime();
+  WhatIfRun run;
+  std::vector<std::size_t> &changed = run.changed;
+  for (const DepartureEdit &edit : edits) {
+    auto it = train_index_by_number_.find(edit.train_number);
+    if (it == train_index_by_number_.end()) {
+      throw std::runtime_error("There is no train with number " +
+                               std::to_string(edit.train_number));
+    }
+    TrainWindow &window = windows[it->second];
+    SimTime shift =
+        edit.departure_time - trains_[it->second]->GetOriginalDepartureTime();
+    window.first_attempt = std::min(window.first_attempt,
+                                    window.first_attempt + shift);
+    window.earliest_return = std::min(window.earliest_return,
+                                      window.earliest_return + shift);
+    changed.push_back(it->second);
+    stop_time = std::max(
+        stop_time,
+        stopTimeFor(trains_[it->second]->GetOriginalArrivalTime() + shift));
+  }
+  // The run is extended as the time table would extend it. The trains that
+  // were not finished at the old stop time then run further.
+  std::vector<std::size_t> seeds(changed);
+  if (stop_time > base_simulator->GetStopSimulationTime()) {
+    for (std::size_t i = 0; i < trains_.size(); i++) {
+      if (trains_[i]->GetTrainStatus() != TrainStatus::FINISHED) {
+        seeds.push_back(i);
+      }
+    }
+  }
+  std::vector<SimTime> affected_from;
+  run.cone = vehicle_flow_.Cone(windows, seeds, affected_from);
+  const std::vector<std::size_t> &cone = run.cone;
+
+  auto simulator = std::make_shared<Simulator>(false);
+  simulator->SetConsoleLog(false);
+  simulator->SetStartSimulationTime(base_simulator->GetStartSimulationTime());
+  simulator->SetStopSimulationTime(stop_time);
+  simulator->SetStopTime(std::max(stop_time, base_simulator->GetStopTime()));
+  auto scenario =
+      std::make_shared<TrainStationManager>(simulator, *this, cone, edits);
+  std::vector<char> in_cone(trains_.size(), 0);
+  for (std::size_t index : cone) in_cone[index] = 1;
+  for (std::size_t station = 0; station < stations_.size(); station++) {
+    SimTime from = affected_from[station];
+    if (from == VehicleFlowGraph::kNever) continue;
+    int id = static_cast<int>(station);
+    std::vector<int> pool = vehicle_flow_.PoolBefore(id, from);
+    for (int vehicle_id : pool) scenario->ReturnVehicle(id, vehicle_id);
+    // The trains outside of the cone do not assemble here after from, but
+    // they still bring vehicles.
+    for (const PoolChange &change : vehicle_flow_.GetChanges(id)) {
+      if (change.time >= from && !change.taken && !in_cone[change.train]) {
+        simulator->AddEvent(std::make_shared<VehicleReturn>(
+            scenario, simulator, id, change.vehicle_id, change.time));
+      }
+    }
+  }
+  // The trains of the cone run their steps while the trains outside of it
+  // still have events queued, as in a full run.
+  SimTime last_event_time = -1;
+  for (std::size_t i = 0; i < trains_.size(); i++) {
+    if (!in_cone[i]) {
+      last_event_time =
+          std::max(last_event_time, trains_[i]->GetLastEventTime());
+    }
+  }
+  if (last_event_time >= 0) {
+    simulator->AddEvent(
+        std::make_shared<EndOfRun>(scenario, simulator, last_event_time));
+  }
+  run.scenario = scenario;
+
+  // The trains outside of the cone keep their result.
+  SimTime kept_delay = 0;
+  int kept_not_arrived = 0;
+  for (std::size_t i = 0; i < trains_.size(); i++) {
+    if (in_cone[i]) continue;
+    kept_delay += arrivalDelay(*trains_[i]);
+    if (!hasArrived(*trains_[i])) kept_not_arrived++;
+  }
+  SimTime kept_cost = kept_delay + not_arrived_penalty * kept_not_arrived;
+  run.total_delay = kept_delay;
+  run.not_arrived_trains = kept_not_arrived;
+  run.cost = kept_cost;
+  run.complete = cone.empty();
+  if (run.complete) return run;
+  scenario->Setup();
+  // A train never arrives before the time table says, so the delay only
+  // grows during the run. A train that has not arrived yet will cost at
+  // least the delay of its earliest arrival: the expected arrival if it
+  // runs, else its running time from now. With the cost of the trains
+  // outside of the cone that is a lower bound of the cost, and the run is
+  // stopped as soon as it passes cost_limit. It is looked at every
+  // simulated hour.
+  const SimTime kCheckInterval = 60 * 60;
+  SimTime time = simulator->GetStartSimulationTime();
+  do {
+    time = std::min(time + kCheckInterval, stop_time);
+    simulator->SetCurrentTime(time);
+    simulator->RunEventsUntilTime();
+    run.total_delay = kept_delay;
+    run.cost = kept_cost;
+    for (const std::shared_ptr<Train> &train : scenario->trains_) {
+      if (hasArrived(*train)) {
+        run.total_delay += arrivalDelay(*train);
+        run.cost += arrivalDelay(*train);
+      } else {
+        SimTime earliest =
+            train->GetTrainStatus() == TrainStatus::RUNNING
+                ? train->GetExpectedArrivalTime()
+                : time + scenario->GetRunTime(*train).run_time_s;
+        if (earliest > train->GetOriginalArrivalTime()) {
+          run.cost += std::min(not_arrived_penalty,
+                               earliest - train->GetOriginalArrivalTime());
+        }
+      }
+    }
+    if (run.cost > cost_limit) return run;
+  } while (time < stop_time);
+  run.complete = true;
+  int not_arrived = static_cast<int>(
+      std::count_if(scenario->trains_.begin(), scenario->trains_.end(),
+                    [](const std::shared_ptr<Train> &train) {
+                      return !hasArrived(*train);
+                    }));
+  run.not_arrived_trains += not_arrived;
+  run.cost = kept_cost + run.total_delay - kept_delay +
+             not_arrived_penalty * not_arrived;
+  return run;
+}
+
+std::string TrainStationManager::WhatIf(
+    const std::vector<DepartureEdit> &edits) {
+  std::chrono::steady_clock::time_point started =
+      std::chrono::steady_clock::now();
+  WhatIfRun run =
+      RunWhatIf(edits, 0, std::numeric_limits<SimTime>::max());
+  long long elapsed_ms =  // NOLINT
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count();
+  const std::vector<std::size_t> &changed = run.changed;
+  const std::vector<std::size_t> &cone = run.cone;
+
+  SimTime delay_before = 0;
+  std::for_each(trains_.begin(), trains_.end(),
+                [&delay_before](const std::shared_ptr<Train> &train) {
+                  delay_before += arrivalDelay(*train);
+                });
+  TextBuffer out(256 * (cone.size() + 4));
+  out << "What if";
+  for (std::size_t i = 0; i < edits.size(); i++) {
+    out << (i == 0 ? " train " : ", train ") << edits[i].train_number
+        << " departs at ";
+    out.AppendTime(edits[i].departure_time) << " (";
+    out.AppendTime(trains_[changed[i]]->GetOriginalDepartureTime()) << ')';
+  }
+  out << "\nSimulated " << static_cast<long long>(cone.size())  // NOLINT
+      << " of " << static_cast<long long>(trains_.size())  // NOLINT
+      << " trains again in " << elapsed_ms
+      << " ms, the rest of the run is reused.\n";
+  TextBuffer rows(256 * cone.size());
+  for (std::size_t k = 0; k < cone.size(); k++) {
+    const Train &before = *trains_[cone[k]];
+    const Train &after = *run.scenario->trains_[k];
+    if (before.GetPlanedDepartureTime() == after.GetPlanedDepartureTime() &&
+        before.GetExpectedArrivalTime() == after.GetExpectedArrivalTime() &&
+        before.GetTrainStatus() == after.GetTrainStatus()) {
+      continue;
+    }
+    rows << "Was   ";
+    before.AppendTimeTableData(rows);
+    rows << "  " << TrainStatusName(before.GetTrainStatus()) << "\nNow   ";
+    after.AppendTimeTableData(rows);
+    rows << "  " << TrainStatusName(after.GetTrainStatus()) << '\n';
+  }
+  if (rows.Empty()) {
+    out << "No train gets another result.\n";
+  } else {
+    out << "      Time                  Number  Origin              "
+           "Time                  Destination         Delay, status\n";
+    out.Append(rows.Data(), rows.Size());
+  }
+  out << "Total delay: ";
+  out.AppendDuration(static_cast<int>(delay_before)) << " -> ";
+  out.AppendDuration(static_cast<int>(run.total_delay)) << '\n';
+  return out.Str();
 }
 
 std::string TrainStationManager::GetStationDetails(const std::string &name,
                                                    bool high_detail_level) {
-  std::ostringstream oss;
+  TextBuffer out(4096);
   std::shared_ptr<Station> station_out = GetStationByName(name);
-  oss << station_out->GetName() << "\n\n"
+  int station_id = station_out->GetId() - 1;
+  std::shared_ptr<const SimulationSnapshot> snapshot = GetSnapshot();
+  out << station_out->GetName() << "\n\n"
       << "Train:\n";
-  std::for_each(trains_.begin(), trains_.end(),
-                [&](std::shared_ptr<Train> &train) {
-                  if (train->GetDepartureStation() == station_out->GetName()) {
-                    oss << train->GetTrainDetails(high_detail_level) << "\n";
-                  }
-                });
+  for (std::size_t i = 0; i < trains_.size(); i++) {
+    if (trains_[i]->GetDepartureStationId() == station_id) {
+      snapshotTrain(*snapshot, i).AppendTrainDetails(out, high_detail_level);
+      out << '\n';
+    }
+  }
   if (high_detail_level) {
-    oss << "Available vehicles:\n";
+    out << "Available vehicles:\n";
     // oss << station_out->PrintVehiclePool();
   }
 
-  return oss.str();
+  return out.Str();
 }
 
-std::string TrainStationManager::GetTrainDetailsByVehicleId(int vehicle_id) {
-  std::string details;
-  auto it = std::find_if(
-      trains_.begin(), trains_.end(), [&](std::shared_ptr<Train> &train) {
-        std::shared_ptr<Vehicle> vehicle_out;
-        if (train->GetVehicleById(vehicle_id, vehicle_out)) {
-          details = train->GetTrainDetails(IsHighLogLevelTrain());
-          return true;
-        } else {
-          return false;
-        }
-      });
-  if (it != trains_.end()) {
-    return details;
+std::string TrainStationManager::GetTrainDetailsByVehicleId(
+    int vehicle_id, bool high_detail_level) {
+  std::shared_ptr<const SimulationSnapshot> snapshot = GetSnapshot();
+  std::size_t index = findTrainWithVehicle(*snapshot, vehicle_id);
+  if (index < trains_.size()) {
+    return snapshotTrain(*snapshot, index).GetTrainDetails(high_detail_level);
   } else {
     throw std::runtime_error("Could not find a train containing this vehicle.");
   }
 }
 
-int TrainStationManager::GetDistanceFrom(const std::string &station1,
-                                         const std::string &station2) {
-  auto it =
-      find_if(distances_.begin(), distances_.end(),
-              [&station1, &station2](std::shared_ptr<Distance> &distance) {
-                if ((station1 == distance->GetStation1() &&
-                     station2 == distance->GetStation2()) ||
-                    (station1 == distance->GetStation2() &&
-                     station2 == distance->GetStation1())) {
-                  return true;
-                } else {
-                  return false;
-                }
-              });
-  return (*it)->GetDistance();
+void TrainStationManager::setRunTimes() {
+  std::for_each(trains_.begin(), trains_.end(),
+                [this](std::shared_ptr<Train> &train) {
+                  int distance_m = 1000 * GetDistanceFrom(
+                                              train->GetDepartureStationId(),
+                                              train->GetArrivalStationId());
+                  train->SetRunTimeIndex(run_time_model_.AddLine(
+                      distance_m, train->GetTrainMaxSpeed(),
+                      train->GetDemandedVehicles()));
+                });
+}
+
+void TrainStationManager::SetParameters(
+    const SimulationParameters &parameters) {
+  bool recalculate =
+      parameters.max_acceleration != parameters_.max_acceleration;
+  parameters_ = parameters;
+  if (recalculate) {
+    run_time_model_.SetMaxAcceleration(parameters_.max_acceleration);
+    setRunTimes();
+  }
+}
+
+const RunTime &TrainStationManager::GetRunTime(const Train &train) const {
+  return run_time_model_.Get(train.GetRunTimeIndex());
+}
+
+bool TrainStationManager::GetRestrictedRunTime(const Train &train,
+                                               SimTime departure,
+                                               int &run_time_s_out) {
+  const TrainLine &line = train.GetTrainLine();
+  int max_speed = disruptions_.MaxSpeedAt(routeKey(train), departure);
+  if (max_speed == 0 || max_speed >= line.GetMaxSpeed()) return false;
+  // The line is added to the model the first time it is run at this limit,
+  // after that it is looked up like the lines of the time table.
+  run_time_s_out = run_time_model_
+                       .Get(run_time_model_.AddLine(
+                           GetRunTime(train).distance_m, max_speed,
+                           line.GetDemandedVehicles()))
+                       .run_time_s;
+  return true;
+}
+
+SimTime TrainStationManager::HoldDeparture(const Train &train,
+                                           SimTime departure,
+                                           SimTime now) const {
+  return disruptions_.OpenAt(routeKey(train), departure, now);
+}
+
+SimTime TrainStationManager::PlanArrival(const Train &train,
+                                         SimTime departure) const {
+  SimTime potential_arrival_time = departure + GetRunTime(train).run_time_s;
+  if (potential_arrival_time > train.GetOriginalArrivalTime()) {
+    return potential_arrival_time;
+  }
+  return departure + (train.GetOriginalArrivalTime() -
+                      train.GetOriginalDepartureTime());
+}
+
+bool TrainStationManager::replan(std::size_t index,
+                                 const Disruption &closure) {
+  Train &train = *trains_[index];
+  // The lifecycle of a ready train waits for the departure, the one of a
+  // running train for the arrival.
+  EventHandle handle = lifecycles_[index]->GetHandle();
+  if (train.GetTrainStatus() == TrainStatus::READY) {
+    SimTime departure = train.GetPlanedDepartureTime();
+    SimTime held = HoldDeparture(train, departure, closure.from);
+    if (held == departure) return false;
+    train.SetPlanedDepartureTime(held);
+    train.SetExpectedArrivalTime(PlanArrival(train, held));
+    return simulator_.lock()->RescheduleEvent(handle, held);
+  }
+  if (train.GetTrainStatus() == TrainStatus::RUNNING &&
+      train.GetExpectedArrivalTime() > closure.from) {
+    SimTime arrival =
+        train.GetExpectedArrivalTime() + (closure.to - closure.from);
+    train.SetExpectedArrivalTime(arrival);
+    return simulator_.lock()->RescheduleEvent(handle, arrival);
+  }
+  return false;
+}
+
+void TrainStationManager::ApplyDisruption(std::size_t index, SimTime time) {
+  const Disruption &disruption = disruptions_.Get(index);
+  int replanned = 0;
+  if (disruption.type == DisruptionType::CLOSURE) {
+    const std::vector<std::size_t> &trains = trains_by_route_.at(
+        routeKey(disruption.station_1, disruption.station_2));
+    replanned = static_cast<int>(
+        std::count_if(trains.begin(), trains.end(), [&](std::size_t i) {
+          return replan(i, disruption);
+        }));
+  }
+
+  std::shared_ptr<Simulator> simulator = simulator_.lock();
+  if (time < simulator->GetStartSimulationTime()) return;
+  TextBuffer &out = simulator->BeginLogLine();
+  out.AppendTime(time) << " Disruption: ";
+  switch (disruption.type) {
+    case DisruptionType::CLOSURE:
+      out << "Closed ";
+      break;
+    case DisruptionType::SPEED_RESTRICTION:
+      out << "Max speed " << disruption.max_speed << " km/h ";
+      break;
+    case DisruptionType::POOL_FREEZE:
+      out << "Vehicle pool frozen at ";
+      break;
+  }
+  out << station_names_.Get(disruption.station_1);
+  if (disruption.type != DisruptionType::POOL_FREEZE) {
+    out << " - " << station_names_.Get(disruption.station_2);
+  }
+  out << " until ";
+  out.AppendTime(disruption.to);
+  if (disruption.type == DisruptionType::CLOSURE) {
+    out << ", " << replanned << " trains re-planned";
+  }
+  out << '\n';
+  simulator->CommitLogLine();
+}
+
+int TrainStationManager::GetDistanceFrom(int station_1, int station_2) const {
+  return distance_by_route_.at(routeKey(station_1, station_2));
 }
@@ -0,0 +1,98 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "throughput_account.h"  //NOLINT
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "string_table.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
+#include "train.h"  //NOLINT
+
+ThroughputAccount::ThroughputAccount() : total_({0.0, 0.0, 0.0, 0.0}) {}
+
+void ThroughputAccount::AddTrip(const Train &train, int distance_m) {
+  const Consist &consist = train.GetConsist();
+  double km = distance_m / 1000.0;
+  Throughput trip = {consist.seats * km, consist.beds * km,
+                     consist.ton_capacity * km,
+                     consist.cubic_meter_capacity * km};
+  Throughput *targets[] = {
+      &total_, &per_train_[train.GetTrainNumber()],
+      &per_corridor_[std::minmax(train.GetDepartureStationId(),
+                                 train.GetArrivalStationId())]};
+  std::for_each(std::begin(targets), std::end(targets),
+                [&trip](Throughput *target) {
+                  target->seat_km += trip.seat_km;
+                  target->bed_km += trip.bed_km;
+                  target->ton_km += trip.ton_km;
+                  target->cubic_meter_km += trip.cubic_meter_km;
+                });
+}
+
+bool ThroughputAccount::GetTrainThroughput(int train_number,
+                                           Throughput &throughput_out) const {
+  auto it = per_train_.find(train_number);
+  if (it == per_train_.end()) return false;
+  throughput_out = it->second;
+  return true;
+}
+
+static void appendThroughput(TextBuffer &out, const Throughput &throughput) {
+  out << static_cast<long long>(std::llround(throughput.seat_km))  // NOLINT
+      << " seat-km, "
+      << static_cast<long long>(std::llround(throughput.bed_km))  // NOLINT
+      << " bed-km, "
+      << static_cast<long long>(std::llround(throughput.ton_km))  // NOLINT
+      << " ton-km, "
+      << static_cast<long long>(  // NOLINT
+             std::llround(throughput.cubic_meter_km))
+      << " m3-km\n";
+}
+
+std::string ThroughputAccount::GetReport(const StringTable &station_names,
+                                         bool high_detail_level) const {
+  TextBuffer out(4096);
+  out << "Total throughput: ";
+  appendThroughput(out, total_);
+  out << "\nPer corridor:\n";
+  // The corridors are named and listed in the order of the station names.
+  std::vector<std::pair<std::string, const Throughput *>> corridors;
+  std::for_each(
+      per_corridor_.begin(), per_corridor_.end(),
+      [&](const std::pair<const std::pair<int, int>, Throughput> &entry) {
+        std::pair<std::string, std::string> names =
+            std::minmax(station_names.Get(entry.first.first),
+                        station_names.Get(entry.first.second));
+        corridors.emplace_back(names.first + " - " + names.second,
+                               &entry.second);
+      });
+  std::sort(corridors.begin(), corridors.end(),
+            [](const std::pair<std::string, const Throughput *> &a,
+               const std::pair<std::string, const Throughput *> &b) {
+              return a.first < b.first;
+            });
+  std::for_each(
+      corridors.begin(), corridors.end(),
+      [&out](const std::pair<std::string, const Throughput *> &entry) {
+        std::size_t start = out.Size();
+        out << entry.first;
+        out.PadFrom(start, 36);
+        appendThroughput(out, *entry.second);
+      });
+  if (high_detail_level) {
+    out << "\nPer train:\n";
+    std::for_each(per_train_.begin(), per_train_.end(),
+                  [&out](const std::pair<const int, Throughput> &entry) {
+                    out << "Train: " << entry.first << ' ';
+                    appendThroughput(out, entry.second);
+                  });
+  }
+  return out.Str();
+}
@@ -0,0 +1,90 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "timer_wheel.h"  //NOLINT
+
+#include <limits>
+
+static const int kWheelBits = 24;
+
+TimerWheel::TimerWheel(std::uint64_t now) : now_(now), size_(0) {
+  for (int level = 0; level < kLevels; level++) occupied_[level] = 0;
+}
+
+void TimerWheel::Schedule(int id, std::uint64_t tick) {
+  insert(Timer{id, tick});
+  size_++;
+}
+
+void TimerWheel::insert(const Timer &timer) {
+  if (timer.expiry <= now_) {
+    due_.push_back(timer);
+    return;
+  }
+  for (int level = 0; level < kLevels; level++) {
+    int above = kSlotBits * (level + 1);
+    if ((timer.expiry >> above) == (now_ >> above)) {
+      int slot = static_cast<int>(timer.expiry >> (kSlotBits * level)) &
+                 (kSlots - 1);
+      slots_[level][slot].push_back(timer);
+      occupied_[level] |= std::uint64_t(1) << slot;
+      return;
+    }
+  }
+  overflow_.push_back(timer);
+}
+
+std::uint64_t TimerWheel::NextExpiry() const {
+  if (!due_.empty()) return now_;
+  // A timer on a level is always in a later slot than the current one, and
+  // every slot on a level starts before the slots of the level above.
+  for (int level = 0; level < kLevels; level++) {
+    int shift = kSlotBits * level;
+    int current = static_cast<int>(now_ >> shift) & (kSlots - 1);
+    std::uint64_t later =
+        current == kSlots - 1 ? 0 : ~((std::uint64_t(2) << current) - 1);
+    std::uint64_t mask = occupied_[level] & later;
+    if (mask == 0) continue;
+    int slot = __builtin_ctzll(mask);
+    int above = shift + kSlotBits;
+    return ((now_ >> above) << above) | (std::uint64_t(slot) << shift);
+  }
+  if (!overflow_.empty()) return ((now_ >> kWheelBits) + 1) << kWheelBits;
+  return std::numeric_limits<std::uint64_t>::max();
+}
+
+void TimerWheel::cascade(int level) {
+  int slot = static_cast<int>(now_ >> (kSlotBits * level)) & (kSlots - 1);
+  if (!(occupied_[level] & (std::uint64_t(1) << slot))) return;
+  moving_.swap(slots_[level][slot]);
+  occupied_[level] &= ~(std::uint64_t(1) << slot);
+  for (const Timer &timer : moving_) insert(timer);
+  moving_.clear();
+}
+
+void TimerWheel::Advance(std::uint64_t tick,
+                         std::vector<int> &expired_out) {
+  while (true) {
+    for (const Timer &timer : due_) expired_out.push_back(timer.id);
+    size_ -= due_.size();
+    due_.clear();
+    std::uint64_t next = NextExpiry();
+    if (next > tick) break;
+    now_ = next;
+    // Higher levels first, a timer moved down from level 2 may land in the
+    // level 1 slot that starts at the same tick.
+    if ((now_ & ((std::uint64_t(1) << kWheelBits) - 1)) == 0) {
+      moving_.swap(overflow_);
+      for (const Timer &timer : moving_) insert(timer);
+      moving_.clear();
+    }
+    for (int level = kLevels - 1; level >= 0; level--) {
+      if ((now_ & ((std::uint64_t(1) << (kSlotBits * level)) - 1)) == 0) {
+        cascade(level);
+      }
+    }
+  }
+  if (tick > now_) now_ = tick;
+}
@@ -0,0 +1,194 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "timetable_optimizer.h"  //NOLINT
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <thread>
+
+#include "text_buffer.h"  //NOLINT
+#include "train.h"  //NOLINT
+
+const SimTime TimetableOptimizer::kStuckPenalty = 6 * 60 * 60;
+const SimTime TimetableOptimizer::kStep = 5 * 60;
+const int TimetableOptimizer::kCandidatesPerRound = 16;
+
+TimetableOptimizer::TimetableOptimizer(
+    std::shared_ptr<TrainStationManager> base, SimTime window_s,
+    std::size_t jobs, unsigned seed)
+    : base_(base),
+      window_s_(window_s),
+      jobs_(jobs),
+      random_(seed),
+      runs_(0),
+      stopped_runs_(0),
+      cache_hits_(0) {
+  if (jobs_ == 0) {
+    unsigned cores = std::thread::hardware_concurrency();
+    jobs_ = cores == 0 ? 1 : cores;
+  }
+  const std::vector<std::shared_ptr<Train>> &trains = base_->GetTrains();
+  std::for_each(trains.begin(), trains.end(),
+                [this](const std::shared_ptr<Train> &train) {
+                  train_numbers_.push_back(train->GetTrainNumber());
+                  departures_.push_back(train->GetOriginalDepartureTime());
+                });
+}
+
+std::vector<DepartureEdit> TimetableOptimizer::toEdits(
+    const Candidate &candidate) {
+  std::vector<DepartureEdit> edits;
+  for (const auto &move : candidate) {
+    edits.push_back(DepartureEdit{move.first, move.second});
+  }
+  return edits;
+}
+
+bool TimetableOptimizer::neighbour(const Candidate &best,
+                                   Candidate &candidate_out) {
+  const std::vector<std::shared_ptr<Train>> &trains = base_->GetTrains();
+  // Half of the moves are of a train that was late, stuck or is moved
+  // already, since those are the ones most likely to gain.
+  std::vector<std::size_t> focus;
+  for (std::size_t i = 0; i < trains.size(); i++) {
+    const Train &train = *trains[i];
+    if (train.GetTrainStatus() == TrainStatus::INCOMPLETE ||
+        train.GetExpectedArrivalTime() != train.GetOriginalArrivalTime() ||
+        best.count(train.GetTrainNumber()) != 0) {
+      focus.push_back(i);
+    }
+  }
+  std::size_t index;
+  if (!focus.empty() && random_() % 2 == 0) {
+    index = focus[random_() % focus.size()];
+  } else {
+    index = random_() % trains.size();
+  }
+  SimTime steps = window_s_ / kStep;
+  std::uniform_int_distribution<SimTime> step(-steps, steps);
+  SimTime departure = departures_[index] + step(random_) * kStep;
+  // The train must not be assembled before the start of the simulation.
+  if (departure < base_->GetParameters().GetAssembleBefore()) return false;
+  candidate_out = best;
+  if (departure == departures_[index]) {
+    candidate_out.erase(train_numbers_[index]);
+  } else {
+    candidate_out[train_numbers_[index]] = departure;
+  }
+  return candidate_out != best;
+}
+
+void TimetableOptimizer::evaluate(const std::vector<Candidate> &candidates,
+                                  SimTime cost_limit) {
+  std::vector<Candidate> runs;
+  for (const Candidate &candidate : candidates) {
+    if (cache_.count(candidate) != 0 ||
+        std::find(runs.begin(), runs.end(), candidate) != runs.end()) {
+      cache_hits_++;
+    } else {
+      runs.push_back(candidate);
+    }
+  }
+  std::vector<Evaluation> results(runs.size());
+  std::vector<std::exception_ptr> errors(runs.size());
+  std::atomic<std::size_t> next_run(0);
+
+  auto worker = [&]() {
+    for (std::size_t i = next_run++; i < runs.size(); i = next_run++) {
+      try {
+        WhatIfRun run =
+            base_->RunWhatIf(toEdits(runs[i]), kStuckPenalty, cost_limit);
+        results[i].cost = run.cost;
+        results[i].complete = run.complete;
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  std::size_t threads = std::min(jobs_, runs.size());
+  for (std::size_t i = 1; i < threads; i++) pool.emplace_back(worker);
+  worker();
+  std::for_each(pool.begin(), pool.end(),
+                [](std::thread &thread) { thread.join(); });
+
+  for (std::size_t i = 0; i < runs.size(); i++) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+    cache_.emplace(runs[i], results[i]);
+    runs_++;
+    if (!results[i].complete) stopped_runs_++;
+  }
+}
+
+std::string TimetableOptimizer::Optimize(int rounds) {
+  std::chrono::steady_clock::time_point started =
+      std::chrono::steady_clock::now();
+  Candidate best;
+  evaluate(std::vector<Candidate>(1, best),
+           std::numeric_limits<SimTime>::max());
+  SimTime start_cost = cache_[best].cost;
+  SimTime best_cost = start_cost;
+  int improvements = 0;
+  for (int round = 0; round < rounds; round++) {
+    std::vector<Candidate> candidates;
+    Candidate candidate;
+    for (int tries = 0; tries < 4 * kCandidatesPerRound &&
+                        static_cast<int>(candidates.size()) <
+                            kCandidatesPerRound;
+         tries++) {
+      if (neighbour(best, candidate)) candidates.push_back(candidate);
+    }
+    evaluate(candidates, best_cost);
+    // The first of equally good candidates is kept, so the search does not
+    // depend on the order the threads finish in.
+    const Candidate *better = nullptr;
+    for (const Candidate &other : candidates) {
+      const Evaluation &evaluation = cache_[other];
+      if (evaluation.complete && evaluation.cost < best_cost) {
+        best_cost = evaluation.cost;
+        better = &other;
+      }
+    }
+    if (better != nullptr) {
+      best = *better;
+      improvements++;
+    }
+  }
+  long long elapsed_ms =  // NOLINT
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count();
+
+  TextBuffer out(4096);
+  out << "Optimized the time table in " << rounds << " rounds, "
+      << runs_ << " runs (" << stopped_runs_ << " stopped early, "
+      << cache_hits_ << " found in the cache) in " << elapsed_ms
+      << " ms.\n";
+  out << "Cost: ";
+  out.AppendDuration(static_cast<int>(start_cost)) << " -> ";
+  out.AppendDuration(static_cast<int>(best_cost))
+      << ", the total delay plus ";
+  out.AppendDuration(static_cast<int>(kStuckPenalty))
+      << " per train that did not arrive.\n";
+  if (best.empty()) {
+    out << "No better time table was found.\n";
+    return out.Str();
+  }
+  out << "Found in " << improvements << " steps, the moved trains:\n";
+  for (const auto &move : best) {
+    std::size_t index = static_cast<std::size_t>(
+        std::find(train_numbers_.begin(), train_numbers_.end(), move.first) -
+        train_numbers_.begin());
+    out << "  Train " << move.first << "  ";
+    out.AppendTime(departures_[index]) << " -> ";
+    out.AppendTime(move.second) << '\n';
+  }
+  out << base_->WhatIf(toEdits(best));
+  return out.Str();
+}
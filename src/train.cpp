@@ -11,140 +11,135 @@
 #include <queue>
 #include <sstream>
 
+#include "run_time_model.h"  //NOLINT
+#include "text_buffer.h"  //NOLINT
 #include "train_time.h"  //NOLINT
 #include "vehicle.h"     //NOLINT
 
-std::ostream &operator<<(std::ostream &os, const TrainStatus &train_status) {
+const char *TrainStatusName(TrainStatus train_status) {
   switch (train_status) {
     case TrainStatus::NOT_ASSEMBLED:
-      os << "Not assembled";
-      break;
+      return "Not assembled";
     case TrainStatus::INCOMPLETE:
-      os << "Incomplete";
-      break;
+      return "Incomplete";
     case TrainStatus::ASSEMBLED:
-      os << "Assembled";
-      break;
+      return "Assembled";
     case TrainStatus::READY:
-      os << "Ready";
-      break;
+      return "Ready";
     case TrainStatus::RUNNING:
-      os << "Running";
-      break;
+      return "Running";
     case TrainStatus::ARRIVED:
-      os << "Arrived";
-      break;
+      return "Arrived";
     case TrainStatus::FINISHED:
-      os << "Finished";
-      break;
+      return "Finished";
   }
+  return "";
+}
+
+std::ostream &operator<<(std::ostream &os, const TrainStatus &train_status) {
+  os << TrainStatusName(train_status);
   return os;
 }
 
-int Train::GetVehicleMaxSpeed() {
-  int max_speed = -1;
-  std::for_each(
-      vehicles_.begin(), vehicles_.end(),
-      [&](std::shared_ptr<Vehicle> &vehicle) {
-        if (vehicle->GetType() == 4 || vehicle->GetType() == 5) {
-          int new_max_speed =
-              std::dynamic_pointer_cast<Locomotive>(vehicle)->GetMaxSpeed();
-          if (max_speed == -1) {
-            max_speed = new_max_speed;
-          } else if (max_speed > new_max_speed) {
-            max_speed = new_max_speed;
-          }
-        }
-      });
-  return max_speed;
-}
-
-std::string Train::GetTimeTableData() {
-  std::ostringstream oss;
-  oss << std::left << std::setw(6)
-      << TrainTime::Time_tToString(planed_departure_time_) << std::left
-      << std::setw(10)
-      << std::string(
-             "(" + TrainTime::Time_tToString(GetOriginalDepartureTime()) + ")")
-      << std::setw(8) << GetTrainNumber() << std::setw(20)
-      << GetDepartureStation() << std::left << std::setw(6)
-      << TrainTime::Time_tToString(expected_arrival_time_) << std::setw(10)
-      << std::string("(" + TrainTime::Time_tToString(GetOriginalArrivalTime()) +
-                     ")")
-      << std::setw(20) << GetArrivalStation();
+// The time columns fit "ddd+hh:mm", so a time table can span weeks and the
+// columns still line up.
+static const std::size_t kTimeWidth = 10;
+static const std::size_t kOriginalTimeWidth = 12;
+
+void Train::AppendTimeTableData(TextBuffer &out) const {
+  std::size_t start = out.Size();
+  out.AppendTime(planed_departure_time_).PadFrom(start, kTimeWidth);
+  start = out.Size();
+  out << '(';
+  out.AppendTime(GetOriginalDepartureTime()) << ')';
+  out.PadFrom(start, kOriginalTimeWidth);
+  start = out.Size();
+  out << GetTrainNumber();
+  out.PadFrom(start, 8);
+  start = out.Size();
+  out << GetDepartureStation();
+  out.PadFrom(start, 20);
+  start = out.Size();
+  out.AppendTime(expected_arrival_time_).PadFrom(start, kTimeWidth);
+  start = out.Size();
+  out << '(';
+  out.AppendTime(GetOriginalArrivalTime()) << ')';
+  out.PadFrom(start, kOriginalTimeWidth);
+  start = out.Size();
+  out << GetArrivalStation();
+  out.PadFrom(start, 20);
   if (planed_departure_time_ != GetOriginalDepartureTime() ||
       expected_arrival_time_ != GetOriginalArrivalTime()) {
-    oss << "+"
-        << TrainTime::SecondsToPretty(static_cast<int>(
-               expected_arrival_time_ - GetOriginalArrivalTime()));
+    out << '+';
+    out.AppendDuration(
+        static_cast<int>(expected_arrival_time_ - GetOriginalArrivalTime()));
   }
-  return oss.str();
 }
 
-std::string Train::GetDataToLog(bool high_log_level) {
-  std::ostringstream oss;
+void Train::AppendDataToLog(TextBuffer &out, bool high_log_level) const {
+  AppendDataToLogLow(out);
   if (high_log_level) {
-    oss << GetDataToLogLow() << "\n"
-        << ListDemandedVehicles() << "\n"
-        << ListConnectedVehicles() << "\n";
-  } else {
-    oss << GetDataToLogLow();
+    out << '\n';
+    AppendDemandedVehicles(demanded_vehicles_, out);
+    out << '\n';
+    AppendConnectedVehicles(out);
+    out << '\n';
   }
-  return oss.str();
 }
 
-std::string Train::GetDataToLogLow() {
-  std::ostringstream oss;
-  oss << "Train: " << GetTrainNumber() << " from " << GetDepartureStation()
-      << " " << TrainTime::Time_tToString(GetPlanedDepartureTime()) << " ("
-      << TrainTime::Time_tToString(GetOriginalDepartureTime()) << ") to "
-      << GetArrivalStation() << " "
-      << TrainTime::Time_tToString(GetExpectedArrivalTime()) << " ("
-      << TrainTime::Time_tToString(GetOriginalArrivalTime())
-      << ") Train status: " << GetTrainStatus();
-  return oss.str();
+void Train::AppendDataToLogLow(TextBuffer &out) const {
+  AppendDataToLogLow(out, GetPlanedDepartureTime(), GetExpectedArrivalTime(),
+                     GetTrainStatus());
 }
 
-std::string Train::GetTrainDetails(bool high_detail) {
-  std::ostringstream oss;
+void Train::AppendDataToLogLow(TextBuffer &out, SimTime planed_departure_time,
+                               SimTime expected_arrival_time,
+                               TrainStatus train_status) const {
+  out << "Train: " << GetTrainNumber() << " from " << GetDepartureStation()
+      << ' ';
+  out.AppendTime(planed_departure_time) << " (";
+  out.AppendTime(GetOriginalDepartureTime()) << ") to " << GetArrivalStation()
+                                             << ' ';
+  out.AppendTime(expected_arrival_time) << " (";
+  out.AppendTime(GetOriginalArrivalTime())
+      << ") Train status: " << TrainStatusName(train_status);
+}
+
+void Train::AppendTrainDetails(TextBuffer &out, bool high_detail) const {
+  AppendTimeTableData(out);
   if (high_detail) {
-    oss << GetTimeTableData() << "\n";
-    if (!vehicles_.empty()) oss << ListConnectedVehicles();
-    if (!demanded_vehicles_.empty()) oss << ListDemandedVehicles();
-  } else {
-    oss << GetTimeTableData();
+    out << '\n';
+    AppendConnectedVehicles(out);
+    AppendDemandedVehicles(demanded_vehicles_, out);
   }
-  return oss.str();
 }
 
-std::string Train::ListConnectedVehicles() {
-  std::ostringstream oss;
+std::string Train::GetTrainDetails(bool high_detail) const {
+  TextBuffer out;
+  AppendTrainDetails(out, high_detail);
+  return out.Str();
+}
+
+void Train::AppendConnectedVehicles(TextBuffer &out) const {
   if (!vehicles_.empty()) {
-    oss << "Connected vehicles:\n";
+    out << "Connected vehicles:\n";
     std::for_each(vehicles_.begin(), vehicles_.end(),
-                  [&](std::shared_ptr<Vehicle> &vehicle) {
-                    oss << vehicle->GetDetails() << "\n";
+                  [&](const std::shared_ptr<Vehicle> &vehicle) {
+                    vehicle->AppendDetails(out);
+                    out << '\n';
                   });
-    oss << "\n";
+    out << '\n';
   }
-  return oss.str();
 }
 
-std::string Train::ListDemandedVehicles() {
-  std::ostringstream oss;
-  oss << ListDemandedVehiclesFromState(demanded_vehicles_);
-  return oss.str();
-}
-
-std::string Train::ListDemandedVehiclesFromState(
-    std::vector<int> demanded_vehicles) {
-  std::ostringstream oss;
+void Train::AppendDemandedVehicles(const std::vector<int> &demanded_vehicles,
+                                   TextBuffer &out) {
   if (!demanded_vehicles.empty()) {
-    oss << "Demanded vehicles:\n";
+    out << "Demanded vehicles:\n";
     int coach = 0, sleeping = 0, open = 0, covered = 0, electrical = 0,
         diesel = 0;
     std::for_each(demanded_vehicles.begin(), demanded_vehicles.end(),
-                  [&](int &type) {
+                  [&](const int &type) {
                     switch (type) {
                       case 0:
                         coach++;
@@ -168,18 +163,17 @@ std::string Train::ListDemandedVehiclesFromState(
                         break;
                     }
                   });
-    if (electrical > 0) oss << electrical << " Electrical engine\n";
-    if (diesel > 0) oss << diesel << " Diesel engine\n";
-    if (coach > 0) oss << coach << " Coach car\n";
-    if (sleeping > 0) oss << sleeping << " Sleeping car\n";
-    if (open > 0) oss << open << " Open car\n";
-    if (covered > 0) oss << covered << " Covered car\n";
+    if (electrical > 0) out << electrical << " Electrical engine\n";
+    if (diesel > 0) out << diesel << " Diesel engine\n";
+    if (coach > 0) out << coach << " Coach car\n";
+    if (sleeping > 0) out << sleeping << " Sleeping car\n";
+    if (open > 0) out << open << " Open car\n";
+    if (covered > 0) out << covered << " Covered car\n";
   }
-  return oss.str();
 }
 
 std::string Train::GetLocation() {
-  std::ostringstream oss;
+  TextBuffer oss;
   oss << "Connected to train: " << GetTrainNumber();
   if (train_status_ == TrainStatus::INCOMPLETE ||
       train_status_ == TrainStatus::ASSEMBLED ||
@@ -192,10 +186,49 @@ std::string Train::GetLocation() {
   } else {
     oss << " running to " << GetArrivalStation();
   }
-  return oss.str();
+  return oss.Str();
+}
+
+/** \brief Adds (sign 1) or removes (sign -1) the capacity, mass and power
+ * of the vehicle to the totals of the consist. */
+static void addToTotals(Consist &consist, const Vehicle &vehicle,  // NOLINT
+                        int sign) {
+  int type = vehicle.GetType();
+  if (type < 0 || type >= Consist::kNumberOfTypes) return;
+  consist.vehicles_per_type[type] += sign;
+  if (type == 0) {
+    consist.seats +=
+        sign * dynamic_cast<const CoachCar &>(vehicle).GetNumberOfChairs();
+  } else if (type == 1) {
+    consist.beds +=
+        sign * dynamic_cast<const SleepingCar &>(vehicle).GetNumberOfBeds();
+  } else if (type == 2) {
+    consist.ton_capacity +=
+        sign * dynamic_cast<const OpenCar &>(vehicle).GetWeightCapacity();
+  } else if (type == 3) {
+    consist.cubic_meter_capacity +=
+        sign * dynamic_cast<const CoveredCar &>(vehicle).GetVolumeCapacity();
+  }
+  consist.mass_tons += sign * RunTimeModel::MassTons(vehicle);
+  consist.power_kw += sign * RunTimeModel::PowerKw(vehicle);
+}
+
+/** \brief Lowers the min locomotive speed of the consist if the vehicle is
+ * a slower locomotive. */
+static void addLocomotiveSpeed(Consist &consist,  // NOLINT
+                               const Vehicle &vehicle) {
+  if (vehicle.GetType() != 4 && vehicle.GetType() != 5) return;
+  int speed = dynamic_cast<const Locomotive &>(vehicle).GetMaxSpeed();
+  if (consist.min_locomotive_speed == -1 ||
+      consist.min_locomotive_speed > speed) {
+    consist.min_locomotive_speed = speed;
+  }
 }
 
 void Train::AddVehicle(std::shared_ptr<Vehicle> &vehicle) {
+  addToTotals(consist_, *vehicle, 1);
+  addLocomotiveSpeed(consist_, *vehicle);
+  consist_.vehicle_ids.emplace_back(vehicle->GetId());
   vehicles_.emplace_back(std::move(vehicle));
 }
 
@@ -203,6 +236,22 @@ bool Train::PopVehicle(std::shared_ptr<Vehicle> &vehicle_out) {
   if (!vehicles_.empty()) {
     vehicle_out = std::move(*(vehicles_.begin()));
     vehicles_.erase(vehicles_.begin());
+    consist_.vehicle_ids.erase(consist_.vehicle_ids.begin());
+    if (vehicles_.empty()) {
+      // Start from zero so that rounding errors do not pile up.
+      consist_ = Consist();
+      return true;
+    }
+    addToTotals(consist_, *vehicle_out, -1);
+    if (vehicle_out->GetType() == 4 || vehicle_out->GetType() == 5) {
+      // The slowest locomotive may have left, so the remaining ones are
+      // checked again.
+      consist_.min_locomotive_speed = -1;
+      std::for_each(vehicles_.begin(), vehicles_.end(),
+                    [this](const std::shared_ptr<Vehicle> &vehicle) {
+                      addLocomotiveSpeed(consist_, *vehicle);
+                    });
+    }
     return true;
   }
   return false;
@@ -220,11 +269,3 @@ bool Train::GetVehicleById(int id, std::shared_ptr<Vehicle> &out_vehicle) {
   return false;
 }
 
-std::vector<int> Train::GetConnectedVehicles() {
-  std::vector<int> connected_vehicles;
-  std::for_each(vehicles_.begin(), vehicles_.end(),
-                [&connected_vehicles](std::shared_ptr<Vehicle> &vehicle) {
-                  connected_vehicles.emplace_back(vehicle->GetId());
-                });
-  return connected_vehicles;
-}
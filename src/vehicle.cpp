@@ -5,60 +5,71 @@
 
 #include "vehicle.h"  //NOLINT
 
-#include <iomanip>
-#include <sstream>
+#include "text_buffer.h"  //NOLINT
+
+const char *VehicleTypeName(int type) {
+  switch (type) {
+    case 0:
+      return "Coach car";
+    case 1:
+      return "Sleeping car";
+    case 2:
+      return "Open car";
+    case 3:
+      return "Covered car";
+    case 4:
+      return "Electrical engine";
+    case 5:
+      return "Diesel engine";
+  }
+  return "";
+}
 
 Vehicle::Vehicle(int id) : id_(id) {}
 Vehicle::~Vehicle() {}
 
-std::string Vehicle::GetDetailsLow() {
-  std::ostringstream oss;
-  oss << "Id: " << GetId() << " Type: " << GetType();
-  return oss.str();
+std::string Vehicle::GetDetails() const {
+  TextBuffer out(128);
+  AppendDetails(out);
+  return out.Str();
+}
+
+std::string Vehicle::GetDetailsLow() const {
+  TextBuffer out(32);
+  out << "Id: " << GetId() << " Type: " << GetType();
+  return out.Str();
 }
 
-std::string Diesel::GetDetails() {
-  std::ostringstream oss;
-  oss << " Id: " << GetId() << " Diesel "
+void Diesel::AppendDetails(TextBuffer &out) const {
+  out << " Id: " << GetId() << " Diesel "
       << " Max speed (km/h): " << GetMaxSpeed()
       << " Fuel consumption (l/h): " << GetFuelConsumption();
-  return oss.str();
 }
 
-std::string Electrical::GetDetails() {
-  std::ostringstream oss;
-  oss << " Id: " << GetId() << " Electrical "
+void Electrical::AppendDetails(TextBuffer &out) const {
+  out << " Id: " << GetId() << " Electrical "
       << " Max speed (km/h): " << GetMaxSpeed()
       << " Max power (kW): " << GetMaxPower();
-  return oss.str();
 }
 
-std::string CoachCar::GetDetails() {
-  std::ostringstream oss;
-  oss << "Id: " << GetId() << " Coach car"
+void CoachCar::AppendDetails(TextBuffer &out) const {
+  out << "Id: " << GetId() << " Coach car"
       << " Number of seats: " << GetNumberOfChairs()
       << " Has internet: " << ((IsHasInternet()) ? "Yes" : "No");
-  return oss.str();
 }
 
-std::string SleepingCar::GetDetails() {
-  std::ostringstream oss;
-  oss << " Id: " << GetId() << " Sleeping car "
+void SleepingCar::AppendDetails(TextBuffer &out) const {
+  out << " Id: " << GetId() << " Sleeping car "
       << " Number of beds: " << GetNumberOfBeds();
-  return oss.str();
 }
 
-std::string OpenCar::GetDetails() {
-  std::ostringstream oss;
-  oss << " Id: " << GetId() << " Open car "
+void OpenCar::AppendDetails(TextBuffer &out) const {
+  out << " Id: " << GetId() << " Open car "
       << " Weight capacity (ton): " << GetWeightCapacity()
       << " Floor area (m2): " << GetFloorArea();
-  return oss.str();
 }
 
-std::string CoveredCar::GetDetails() {
-  std::ostringstream oss;
-  oss << " Id: " << GetId() << " Covered car "
+void CoveredCar::AppendDetails(TextBuffer &out) const {
+  out << " Id: " << GetId() << " Covered car "
       << " Volume capacity (m3): " << GetVolumeCapacity();
-  return oss.str();
 }
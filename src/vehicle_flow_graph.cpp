@@ -0,0 +1,138 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+#include "vehicle_flow_graph.h"  //NOLINT
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+const SimTime VehicleFlowGraph::kNever = std::numeric_limits<SimTime>::max();
+const std::size_t VehicleFlowGraph::kStartPool =
+    std::numeric_limits<std::size_t>::max();
+
+void VehicleFlowGraph::Start(std::vector<std::vector<int>> start_pools,
+                             std::size_t number_of_trains) {
+  changes_.assign(start_pools.size(), std::vector<PoolChange>());
+  start_pools_ = std::move(start_pools);
+  assembled_at_.assign(number_of_trains, kNever);
+  edges_.clear();
+  returned_by_.clear();
+}
+
+void VehicleFlowGraph::AddTaken(SimTime time, int station, std::size_t train,
+                                int vehicle_id) {
+  changes_[station].push_back(PoolChange{time, train, vehicle_id, true});
+  std::size_t id = static_cast<std::size_t>(vehicle_id);
+  std::size_t from = id < returned_by_.size() ? returned_by_[id] : kStartPool;
+  // A train takes all its vehicles at once, so its edges are the last ones.
+  for (auto edge = edges_.rbegin(); edge != edges_.rend() && edge->to == train;
+       ++edge) {
+    if (edge->from == from) {
+      edge->vehicles++;
+      return;
+    }
+  }
+  edges_.push_back(FlowEdge{from, train, 1});
+}
+
+void VehicleFlowGraph::AddReturned(SimTime time, int station,
+                                   std::size_t train, int vehicle_id) {
+  changes_[station].push_back(PoolChange{time, train, vehicle_id, false});
+  std::size_t id = static_cast<std::size_t>(vehicle_id);
+  if (id >= returned_by_.size()) returned_by_.resize(id + 1, kStartPool);
+  returned_by_[id] = train;
+}
+
+std::vector<FlowEdge> VehicleFlowGraph::GetFedBy(std::size_t train) const {
+  std::vector<FlowEdge> fed_by;
+  std::copy_if(edges_.begin(), edges_.end(), std::back_inserter(fed_by),
+               [train](const FlowEdge &edge) { return edge.to == train; });
+  return fed_by;
+}
+
+std::vector<FlowEdge> VehicleFlowGraph::GetFeeds(std::size_t train) const {
+  std::vector<FlowEdge> feeds;
+  std::copy_if(edges_.begin(), edges_.end(), std::back_inserter(feeds),
+               [train](const FlowEdge &edge) { return edge.from == train; });
+  return feeds;
+}
+
+std::vector<int> VehicleFlowGraph::PoolBefore(int station,
+                                              SimTime time) const {
+  std::vector<int> pool(start_pools_[station]);
+  for (const PoolChange &change : changes_[station]) {
+    if (change.time >= time) break;
+    if (change.taken) {
+      pool.erase(std::find(pool.begin(), pool.end(), change.vehicle_id));
+    } else {
+      pool.push_back(change.vehicle_id);
+    }
+  }
+  return pool;
+}
+
+std::vector<std::size_t> VehicleFlowGraph::Cone(
+    const std::vector<TrainWindow> &windows,
+    const std::vector<std::size_t> &changed,
+    std::vector<SimTime> &affected_from_out) const {
+  // The trains of every departure station in the order they assembled.
+  std::vector<std::vector<std::size_t>> departing(start_pools_.size());
+  for (std::size_t i = 0; i < windows.size(); i++) {
+    departing[windows[i].departure_station].push_back(i);
+  }
+  for (std::vector<std::size_t> &trains : departing) {
+    std::stable_sort(trains.begin(), trains.end(),
+                     [this](std::size_t first, std::size_t second) {
+                       return assembled_at_[first] < assembled_at_[second];
+                     });
+  }
+  // The trains from added_from to the end of departing are in the cone.
+  std::vector<std::size_t> added_from(departing.size());
+  for (std::size_t i = 0; i < departing.size(); i++) {
+    added_from[i] = departing[i].size();
+  }
+
+  affected_from_out.assign(start_pools_.size(), kNever);
+  std::vector<char> in_cone(windows.size(), 0);
+  std::vector<int> reached;
+  auto reach = [&](int station, SimTime time) {
+    if (time < affected_from_out[station]) {
+      affected_from_out[station] = time;
+      reached.push_back(station);
+    }
+  };
+  auto add = [&](std::size_t train) {
+    if (in_cone[train]) return;
+    in_cone[train] = 1;
+    reach(windows[train].departure_station, windows[train].first_attempt);
+    reach(windows[train].arrival_station, windows[train].earliest_return);
+  };
+  std::for_each(changed.begin(), changed.end(), add);
+  // A station is reached again when its time goes down, so every train is
+  // looked at once per station time and the loop ends.
+  while (!reached.empty()) {
+    int station = reached.back();
+    reached.pop_back();
+    const std::vector<std::size_t> &trains = departing[station];
+    SimTime time = affected_from_out[station];
+    std::size_t first = static_cast<std::size_t>(
+        std::lower_bound(trains.begin(), trains.end(), time,
+                         [this](std::size_t train, SimTime t) {
+                           return assembled_at_[train] < t;
+                         }) -
+        trains.begin());
+    for (std::size_t i = first; i < added_from[station]; i++) {
+      add(trains[i]);
+    }
+    added_from[station] = std::min(added_from[station], first);
+  }
+
+  std::vector<std::size_t> cone;
+  for (std::size_t i = 0; i < windows.size(); i++) {
+    if (in_cone[i]) cone.push_back(i);
+  }
+  return cone;
+}
@@ -0,0 +1,169 @@
+/**
+ * \author [Ola Karlsson](mailto:olka0600@student.miun.se)
+ * \copyright Copyright 2020 Ola Karlsson. All rights reserved.
+ */
+
+// A small client for the query server of Trains, see include/query_server.h.
+//
+//   TrainsQuery SOCKET [REQUEST]...
+//   TrainsQuery SOCKET --bench N REQUEST...
+//
+// Without requests they are read from stdin, one per line. Every answer is
+// printed after an "OK" or "ERR" line. The bench mode sends the requests N
+// times in turn and prints queries per second and the latency percentiles.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const char kUsage[] =
+    "Usage: TrainsQuery SOCKET [REQUEST]... | SOCKET --bench N REQUEST...";
+
+/** \brief A blocking connection to the query server. */
+class QueryClient {
+  int fd_;
+  std::string input_;
+
+  void readMore() {
+    char buffer[4096];
+    ssize_t size;
+    do {
+      size = read(fd_, buffer, sizeof(buffer));
+    } while (size < 0 && errno == EINTR);
+    if (size <= 0) throw std::runtime_error("The server closed the connection");
+    input_.append(buffer, static_cast<std::size_t>(size));
+  }
+
+ public:
+  explicit QueryClient(const std::string &path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+      throw std::runtime_error("The socket path is too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) throw std::runtime_error("Could not create socket");
+    if (connect(fd_, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) < 0) {
+      close(fd_);
+      throw std::runtime_error("Could not connect to " + path + ": " +
+                               std::strerror(errno));
+    }
+  }
+  ~QueryClient() { close(fd_); }
+  QueryClient(const QueryClient &) = delete;
+  QueryClient &operator=(const QueryClient &) = delete;
+
+  void Send(const std::string &request) {
+    std::string line = request + "\n";
+    std::size_t written = 0;
+    while (written < line.size()) {
+      ssize_t size = send(fd_, line.data() + written, line.size() - written,
+                          MSG_NOSIGNAL);
+      if (size < 0 && errno == EINTR) continue;
+      if (size < 0) throw std::runtime_error("Could not send the request");
+      written += static_cast<std::size_t>(size);
+    }
+  }
+
+  /** \brief Reads one answer. Returns false if it was an ERR answer. */
+  bool Receive(std::string &body_out) {  // NOLINT
+    std::size_t end;
+    while ((end = input_.find('\n')) == std::string::npos) readMore();
+    std::string header = input_.substr(0, end);
+    input_.erase(0, end + 1);
+    std::size_t space = header.find(' ');
+    if (space == std::string::npos) {
+      throw std::runtime_error("Bad answer header: " + header);
+    }
+    std::size_t length = std::strtoul(header.c_str() + space + 1, nullptr, 10);
+    while (input_.size() < length) readMore();
+    body_out = input_.substr(0, length);
+    input_.erase(0, length);
+    return header.compare(0, space, "OK") == 0;
+  }
+};
+
+static int runRequests(QueryClient &client,  // NOLINT
+                       const std::vector<std::string> &requests) {
+  int failed = 0;
+  for (const std::string &request : requests) {
+    client.Send(request);
+    std::string body;
+    bool ok = client.Receive(body);
+    if (!ok) failed++;
+    std::cout << (ok ? "OK" : "ERR") << '\n' << body;
+    if (!body.empty() && body.back() != '\n') std::cout << '\n';
+  }
+  return failed == 0 ? 0 : 1;
+}
+
+static int runBench(QueryClient &client, int count,  // NOLINT
+                    const std::vector<std::string> &requests) {
+  std::vector<double> latencies;
+  latencies.reserve(static_cast<std::size_t>(count));
+  int failed = 0;
+  std::string body;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; i++) {
+    auto sent = std::chrono::steady_clock::now();
+    client.Send(requests[static_cast<std::size_t>(i) % requests.size()]);
+    if (!client.Receive(body)) failed++;
+    std::chrono::duration<double, std::micro> latency =
+        std::chrono::steady_clock::now() - sent;
+    latencies.push_back(latency.count());
+  }
+  std::chrono::duration<double> total =
+      std::chrono::steady_clock::now() - start;
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+  };
+  std::cout << count << " queries, " << failed << " failed, "
+            << static_cast<long>(count / total.count())  // NOLINT
+            << " queries/s\n"
+            << "latency us p50 " << percentile(0.5) << " p99 "
+            << percentile(0.99) << " max " << latencies.back() << '\n';
+  return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) throw std::runtime_error(kUsage);
+    int bench_count = 0;
+    std::vector<std::string> requests;
+    for (int i = 2; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--bench" && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+        bench_count = std::atoi(argv[++i]);
+      } else {
+        requests.push_back(arg);
+      }
+    }
+    if (requests.empty()) {
+      if (bench_count > 0) throw std::runtime_error(kUsage);
+      std::string line;
+      while (std::getline(std::cin, line)) {
+        if (!line.empty()) requests.push_back(line);
+      }
+    }
+    QueryClient client(argv[1]);
+    return bench_count > 0 ? runBench(client, bench_count, requests)
+                           : runRequests(client, requests);
+  } catch (const std::exception &e) {
+    std::cout << e.what() << "\n";
+    return 1;
+  }
+}